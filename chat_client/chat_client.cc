@@ -23,8 +23,14 @@ using ::spdlog::error;
 namespace chatclient {
 
   ChatClient::ChatClient(const string_t chat_server_url)
+      : ChatClient(chat_server_url, string_t()) {
+  }
+
+  ChatClient::ChatClient(const string_t chat_server_url,
+                         const string_t websocket_url)
       : current_client_status_(kBeforeLogin),
-        chat_server_url_(chat_server_url) {
+        chat_server_url_(chat_server_url),
+        websocket_url_(websocket_url) {
     http_requester_ = make_unique<HttpRequester>(
         web::http::uri_builder(chat_server_url).to_uri().to_string());
     chat_client_view_ = make_unique<ChatClientView>();
@@ -106,9 +112,10 @@ namespace chatclient {
   }
 
   void ChatClient::InChatRoom() {
-    chat_room_ = make_unique<ChatRoom>(chat_server_url_,
-                                       session_id_,
-                                       current_chat_room_);
+    chat_room_ = make_unique<ChatRoom>(
+        chat_server_url_, session_id_, current_chat_room_,
+        websocket_url_.empty() ? ChatRoom::kPolling : ChatRoom::kWebSocket,
+        websocket_url_);
     chat_room_->RunChatRoom();
     current_client_status_ = kAfterLogin;
   }
@@ -30,6 +30,11 @@ namespace chatclient {
     // a chat server using chat_server_url.
     ChatClient(utility::string_t chat_server_url);
 
+    // Same as the above, and receive chat messages in a chat room from the
+    // WebSocket server of websocket_url (ws://host:port/).
+    ChatClient(utility::string_t chat_server_url,
+               utility::string_t websocket_url);
+
     // Starts a chat client. This function acts as a router that calls the
 	  // appropriate function based on the command received from the user.
 	  // It uses stdinput/stdoutput to process user input. The user interface
@@ -109,6 +114,9 @@ namespace chatclient {
 
     // Chat server URL
     utility::string_t chat_server_url_;
+
+    // WebSocket server URL. Chat rooms use polling if it is empty.
+    utility::string_t websocket_url_;
   };
 
 } // namespace chatclient
@@ -15,8 +15,14 @@ using ::web::http::http_response;
 using ::web::http::status_codes;
 using ::web::json::value;
 using ::web::json::array;
+using ::web::websockets::client::websocket_callback_client;
+using ::web::websockets::client::websocket_incoming_message;
+using ::web::websockets::client::websocket_message_type;
+using ::web::websockets::client::websocket_outgoing_message;
 using ::utility::string_t;
 using ::utility::ostringstream_t;
+using ::utility::conversions::to_string_t;
+using ::utility::conversions::to_utf8string;
 using ::spdlog::error;
 using chrono::duration;
 
@@ -32,8 +38,19 @@ namespace chatclient {
   ChatRoom::ChatRoom(string_t chat_server_url,
                      string_t session_id, 
                      string_t current_chat_room)
+                     : ChatRoom(chat_server_url, session_id,
+                                current_chat_room, kPolling, string_t()) {
+  }
+
+  ChatRoom::ChatRoom(string_t chat_server_url,
+                     string_t session_id,
+                     string_t current_chat_room,
+                     ReceiveMode receive_mode,
+                     string_t websocket_url)
                      : session_id_(session_id),
-                       current_chat_room_(current_chat_room) {
+                       current_chat_room_(current_chat_room),
+                       receive_mode_(receive_mode),
+                       websocket_url_(websocket_url) {
     http_requester_ = make_unique<HttpRequester>(
         web::http::uri_builder(chat_server_url).to_uri().to_string());
     // ToDo: Use chat_room_view to get a user input and display messages.
@@ -42,17 +59,23 @@ namespace chatclient {
 
   ChatRoom::~ChatRoom() {
     run_display_thread_ = false;
+    if (websocket_client_ != nullptr) {
+      websocket_client_->close().wait();
+    }
   }
 
   void ChatRoom::RunChatRoom() {
     chat_room_view_->ClearConsole();
     chat_room_view_->SetCursorPosition(0, kInputLine);
     run_display_thread_ = true;
-    // Run polling thread to receive chat messages from the chat server.
-    // Getting return value is necessary to run async thread
-    // but the value is not used.
-    async_thread_result_ = async(launch::async, 
-                                 &ChatRoom::PollingChatMessageFromServer, this);
+    if (receive_mode_ != kWebSocket || !ConnectWebSocket()) {
+      // Run polling thread to receive chat messages from the chat server.
+      // Getting return value is necessary to run async thread
+      // but the value is not used.
+      async_thread_result_ = async(launch::async,
+                                   &ChatRoom::PollingChatMessageFromServer,
+                                   this);
+    }
     // Run receiving chat messages from the user through C++ Standard input.
     ProcessChatMessageInput();
   }
@@ -75,6 +98,8 @@ namespace chatclient {
       string_t chat_message;
 
       if (StoreChatMessagesToServer(chat_message)) {
+        // The WebSocket handler adds messages on another thread.
+        lock_guard<mutex> lock(mutex_display_chat_message_);
         chat_room_view_->
             DisplayChatMessages(display_chat_message_, 
                                 current_chat_room_, 
@@ -91,8 +116,92 @@ namespace chatclient {
   }
 
   bool ChatRoom::StoreChatMessagesToServer(const string_t chat_message) const {
+    // Nothing is sent until there is an input.
+    if (chat_message.empty()) {
+      return false;
+    }
+    if (websocket_client_ != nullptr) {
+      value request = value::object();
+      request[UU("type")] = value::string(UU("chat_message"));
+      request[UU("chat_room")] = value::string(current_chat_room_);
+      request[UU("chat_message")] = value::string(chat_message);
+      websocket_outgoing_message outgoing_message;
+      outgoing_message.set_utf8_message(to_utf8string(request.serialize()));
+      try {
+        websocket_client_->send(outgoing_message).wait();
+      } catch (const exception& e) {
+        error("Fail to send the chat message: {}", e.what());
+        return false;
+      }
+      return true;
+    }
     // ToDo: Send the chat_message to chat server.
     return false;
   }
 
+  bool ChatRoom::ConnectWebSocket() {
+    ostringstream_t stream_url;
+    stream_url << websocket_url_ << UU("chatstream?session_id=")
+               << web::uri::encode_data_string(session_id_);
+    websocket_client_ = make_unique<websocket_callback_client>();
+    websocket_client_->set_message_handler(
+        [this](const websocket_incoming_message& message) {
+          ProcessWebSocketMessage(message);
+        });
+
+    value request = value::object();
+    request[UU("type")] = value::string(UU("subscribe"));
+    request[UU("chat_room")] = value::string(current_chat_room_);
+    websocket_outgoing_message subscribe_message;
+    subscribe_message.set_utf8_message(to_utf8string(request.serialize()));
+    try {
+      websocket_client_->connect(web::uri(stream_url.str())).wait();
+      websocket_client_->send(subscribe_message).wait();
+    } catch (const exception& e) {
+      error("Fail to connect the WebSocket server: {}", e.what());
+      websocket_client_.reset();
+      return false;
+    }
+    return true;
+  }
+
+  void ChatRoom::ProcessWebSocketMessage(
+      const websocket_incoming_message& message) {
+    if (message.message_type() != websocket_message_type::text_message) {
+      return;
+    }
+    value push;
+    try {
+      push = value::parse(to_string_t(message.extract_string().get()));
+    } catch (const exception& e) {
+      error("Wrong WebSocket message: {}", e.what());
+      return;
+    }
+    if (!push.has_string_field(UU("type")) ||
+        push.at(UU("type")).as_string() != UU("chat_message")) {
+      return;
+    }
+    // A push missing a field is dropped; at() would throw on this thread.
+    if (!push.has_number_field(UU("date")) ||
+        !push.has_string_field(UU("user_id")) ||
+        !push.has_string_field(UU("chat_room")) ||
+        !push.has_string_field(UU("chat_message"))) {
+      error("Wrong chat message push");
+      return;
+    }
+
+    lock_guard<mutex> lock(mutex_display_chat_message_);
+    display_chat_message_.push_back(ChatMessage(
+        static_cast<time_t>(push.at(UU("date")).as_number().to_int64()),
+        push.at(UU("user_id")).as_string(),
+        push.at(UU("chat_room")).as_string(),
+        push.at(UU("chat_message")).as_string()));
+    while (display_chat_message_.size() > kMaxDisplayChatMessages) {
+      display_chat_message_.pop_front();
+    }
+    chat_room_view_->DisplayChatMessages(display_chat_message_,
+                                         current_chat_room_,
+                                         kMaxDisplayChatMessages);
+  }
+
 } // namespace chatclient
\ No newline at end of file
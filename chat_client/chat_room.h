@@ -6,8 +6,12 @@
 #define CHATCLIENT_CHATROOM_H_
 
 #include <future>
+#include <list>
+#include <memory>
+#include <mutex>
 
 #include "cpprest/http_client.h"
+#include "cpprest/ws_client.h"
 #include "chat_message.h"
 #include "chat_room_view.h"
 #include "http_requester.h"
@@ -19,23 +23,46 @@
 //   2) Receives chat messages from the user through C++ Standard input,
 //      delivers it to the chat server, and displays it on the screen.
 // It uses "asynchronous threads" to run polling thread to get a chat message.
+// In the kWebSocket mode, chat messages are pushed by the WebSocket server of
+// the chat server instead, and typed messages are sent on the same socket.
+// It falls back to polling if the WebSocket connection fails.
 // It removes the message on the console screen and manipulates the location
 // of the console input cursor.
 // Example:
 //   ChatRoom chat_room(chat_server_url_, session_id_, current_chat_room_);
 //   chat_room.run()
+//
+//   ChatRoom chat_room(chat_server_url_, session_id_, current_chat_room_,
+//                      ChatRoom::kWebSocket, UU("ws://localhost:34569/"));
 
 namespace chatclient {
 
   class ChatRoom {
    public:
+    // How the chat room receives new chat messages.
+    enum ReceiveMode {
+      // Make a chat message request every kPollingInterval.
+      kPolling,
+      // Receive chat messages pushed through a WebSocket connection.
+      kWebSocket
+    };
+
     // Initialize the http_requester that can make HTTP requests to the chat
     // server using chat_server_url.
     ChatRoom(utility::string_t chat_server_url, 
              utility::string_t session_id, 
              utility::string_t current_chat_room);
 
-    // Stop polling thread.
+    // Same as the above, and receive chat messages in receive_mode. In the
+    // kWebSocket mode, websocket_url is the WebSocket server of the chat
+    // server (ws://host:port/).
+    ChatRoom(utility::string_t chat_server_url,
+             utility::string_t session_id,
+             utility::string_t current_chat_room,
+             ReceiveMode receive_mode,
+             utility::string_t websocket_url);
+
+    // Stop polling thread and close the WebSocket connection.
     ~ChatRoom();
 
     // Please call this function to start a chat room. It runs two functions:
@@ -60,9 +87,17 @@ namespace chatclient {
         std::vector<chatserver::ChatMessage>& chat_messages) const;
 
     // Store chat message to the chat server. The chat message sends to the
-    // chat server via an HTTP request.
+    // chat server via an HTTP request. An empty message is not sent.
     bool StoreChatMessagesToServer(utility::string_t chat_message) const;
 
+    // Connect to the chat stream of the WebSocket server and subscribe to
+    // the current chat room.
+    bool ConnectWebSocket();
+
+    // Display the chat message pushed through the WebSocket connection.
+    void ProcessWebSocketMessage(
+        const web::websockets::client::websocket_incoming_message& message);
+
     
     // HttpRequester: can make an HTTP request to the chat server. All requests
     // to the chat server are made through this variable.
@@ -83,6 +118,19 @@ namespace chatclient {
     // Chat messages currently displayed on the console screen.
     std::list<chatserver::ChatMessage> display_chat_message_;
 
+    // Mutex for member variables: display_chat_message_
+    std::mutex mutex_display_chat_message_;
+
+    // How the chat room receives new chat messages.
+    ReceiveMode receive_mode_;
+
+    // WebSocket server URL of the kWebSocket mode.
+    utility::string_t websocket_url_;
+
+    // WebSocket connection of the kWebSocket mode.
+    std::unique_ptr<web::websockets::client::websocket_callback_client>
+        websocket_client_;
+
     // It controls the async thread to be stopped and start.
     bool run_display_thread_;
 
@@ -11,6 +11,8 @@ using ::utility::string_t;
 
 int main(int argc, char* argv[]) {
   const string_t port = UU("34568");
+  // The chat server listens to WebSocket connections on port + 1.
+  const string_t websocket_port = UU("34569");
   
   string_t address = UU("http://localhost:");
   address.append(port);
@@ -20,7 +22,10 @@ int main(int argc, char* argv[]) {
 
   const string_t chat_server_address = uri.to_uri().to_string();
 
-  ChatClient chat_client(chat_server_address);
+  const string_t websocket_address =
+      UU("ws://localhost:") + websocket_port + UU("/");
+
+  ChatClient chat_client(chat_server_address, websocket_address);
   chat_client.RunChatClient();
 	return 0;
 }
\ No newline at end of file
@@ -19,6 +19,14 @@ namespace chatserver {
   string_t kParsingDelimeterAccount = UU(",");
   // Delimiter in the chat message file database.
   string_t kParsingDelimeterChatDb = UU("|");
+  // Time to remember a used login nonce (second).
+  const int64_t kNonceReplayWindow = 30;
+  // Maximum number of remembered nonces in a replay cache shard.
+  const size_t kMaxNoncesPerShard = 32768;
+
+  AccountDatabase::AccountDatabase()
+      : nonce_replay_cache_(kNonceReplayWindow, kMaxNoncesPerShard) {
+  }
 
   bool AccountDatabase::Initialize(string_t account_file) {
     account_file_ = account_file;
@@ -26,16 +34,39 @@ namespace chatserver {
       error("Error to open account file: {}", to_utf8string(account_file_));
       return false;
     }
+
+    account_writer_ = make_unique<AccountWriter>();
+    if (!account_writer_->Open(account_file_)) {
+      error("Error to open account writer: {}", to_utf8string(account_file_));
+      return false;
+    }
     return true;
   }
 
   AccountDatabase::AuthResult AccountDatabase::Login(string_t id, 
                                                      string_t password,
                                                      string_t nonce) {
-   // ToDo: Implement login function. Check if the given account information
-   // ToDo: exists in db. Compare the given password by hashing the stored
-   // ToDo: password and nonce together.
-   return AuthResult::kPasswordError;
+    // Hashing is done without the shard lock.
+    string_t stored_password;
+    if (!GetPassword(id, &stored_password)) {
+      return kIDNotExist;
+    }
+
+    // The client sends hash(hash(pwd) + nonce) and the database holds
+    // hash(pwd).
+    if (HashString(stored_password + nonce) != password) {
+      return kPasswordError;
+    }
+
+    // A captured login request must not be accepted again.
+    const NonceReplayCache::Result nonce_result =
+        nonce_replay_cache_.CheckAndInsert(id, nonce);
+    if (nonce_result == NonceReplayCache::kReplayed) {
+      return kNonceReplayed;
+    } else if (nonce_result == NonceReplayCache::kFull) {
+      return kLoginBusy;
+    }
+    return kAuthSuccess;
   }
 
   AccountDatabase::AuthResult AccountDatabase::SignUp(string_t id,
@@ -45,13 +76,26 @@ namespace chatserver {
       return kProhibitedCharInID;
     } else if (password.find(kParsingDelimeterAccount) != string_t::npos) {
       return kProhibitedCharInPassword;
-    } else if (IsExistAccount(id)) {
-      return kDuplicateID;
-    } else if (!StoreAccountInformation(id, password)) {
+    }
+
+    // Reserve the ID, so a concurrent signup with the same ID fails while
+    // this account is written to the file database.
+    AccountShard& account_shard = GetAccountShard(id);
+    {
+      lock_guard<shared_timed_mutex> lock(account_shard.mutex_accounts);
+      if (account_shard.accounts.count(id) != 0 ||
+          account_shard.pending_ids.count(id) != 0) {
+        return kDuplicateID;
+      }
+      account_shard.pending_ids.insert(id);
+    }
+
+    if (!StoreAccountInformation(id, password)) {
+      lock_guard<shared_timed_mutex> lock(account_shard.mutex_accounts);
+      account_shard.pending_ids.erase(id);
       return kAccountWriteError;
-    } else {
-      return kAuthSuccess;
     }
+    return kAuthSuccess;
   }
 
   bool AccountDatabase::ReadAccountFile(string_t account_file) {
@@ -71,6 +115,7 @@ namespace chatserver {
   }
 
   bool AccountDatabase::ParseAccountFile(wifstream file) {
+    array<AccountMap, kAccountShardCount> shard_accounts;
     string_t line;
     while (file.good()) {
       getline(file, line);
@@ -82,38 +127,79 @@ namespace chatserver {
           index == string_t::npos ||
           line.find(kParsingDelimeterAccount, index + 1) != string_t::npos) {
         error("Account file parsing error");
-        accounts_.clear();
         return false;
       }
 
       const auto account_name = line.substr(0, index);
       const auto password = line.substr(index + 1);
-      accounts_[account_name] = password;
+      shard_accounts[hash<string_t>{}(account_name) % kAccountShardCount]
+          [account_name] = password;
+    }
+
+    for (size_t i = 0; i < kAccountShardCount; ++i) {
+      AccountShard& account_shard = account_shards_[i];
+      lock_guard<shared_timed_mutex> lock(account_shard.mutex_accounts);
+      account_shard.accounts.swap(shard_accounts[i]);
     }
     return true;
   }
 
   bool AccountDatabase::StoreAccountInformation(string_t id,
                                                 string_t password) {
-    // If the file exists, work with it, if no, create it
-    wofstream file(account_file_, wofstream::out | wofstream::app);
-    if (file.is_open()) {
-      file << id << kParsingDelimeterAccount << password << endl;
-      file.close();
-      accounts_[id] = password;
-    } else {
-      error("Can't open account file");
+    if (account_writer_ == nullptr) {
+      error("Account writer is not initialized");
+      return false;
+    }
+
+    // Concurrent signups are coalesced into one write and fsync by the
+    // account writer. Wait for the batch before acknowledging the signup.
+    if (!account_writer_->Append(id + kParsingDelimeterAccount + password)
+             .get()) {
+      error("Can't write account file");
       return false;
     }
+
+    AccountShard& account_shard = GetAccountShard(id);
+    lock_guard<shared_timed_mutex> lock(account_shard.mutex_accounts);
+    account_shard.accounts[id] = password;
+    account_shard.pending_ids.erase(id);
     return true;
   }
 
   bool AccountDatabase::IsExistAccount(string_t id) const {
-    if (accounts_.find(id) == accounts_.end()) {
+    const AccountShard& account_shard = GetAccountShard(id);
+    shared_lock<shared_timed_mutex> lock(account_shard.mutex_accounts);
+    if (account_shard.accounts.find(id) == account_shard.accounts.end()) {
       return false;
     } else {
       return true;
     }
   }
 
+  bool AccountDatabase::GetPassword(const string_t& id,
+                                    string_t* out_password) const {
+    const AccountShard& account_shard = GetAccountShard(id);
+    shared_lock<shared_timed_mutex> lock(account_shard.mutex_accounts);
+    const auto account_it = account_shard.accounts.find(id);
+    if (account_it == account_shard.accounts.end()) {
+      return false;
+    }
+    *out_password = account_it->second;
+    return true;
+  }
+
+  string_t AccountDatabase::HashString(string_t string) const {
+    return to_string_t(to_string(hash<string_t>{}(string)));
+  }
+
+  AccountDatabase::AccountShard& AccountDatabase::GetAccountShard(
+      const string_t& id) {
+    return account_shards_[hash<string_t>{}(id) % kAccountShardCount];
+  }
+
+  const AccountDatabase::AccountShard& AccountDatabase::GetAccountShard(
+      const string_t& id) const {
+    return account_shards_[hash<string_t>{}(id) % kAccountShardCount];
+  }
+
 } // namespace chatserver
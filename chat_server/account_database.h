@@ -5,10 +5,17 @@
 #ifndef CHATSERVER_ACCOUNTDATABASE_H_
 #define CHATSERVER_ACCOUNTDATABASE_H_
 
+#include <array>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
 #include <string>
 
 #include "cpprest/json.h"
+#include "account_writer.h"
+#include "nonce_replay_cache.h"
 
 // This class is designed to manage pairs of chat ID and password accounts.
 // It uses a file database that holds IDs and passwords.
@@ -24,6 +31,13 @@
 //     do something with failed login attempts with wrong passwords.
 //   }
 // The usage of the AuthResult functions is similar to the above.
+//
+// The class is thread-safe and optimized for login storms. Accounts are
+// partitioned into shards, each with a reader-writer lock. Logins share the
+// lock of their shard only while the stored password is copied, and hash
+// without it. A signup takes it exclusively twice: to reserve the ID and to
+// insert the account once it is written, so logins of that shard wait at
+// most for one map insert, and logins of other shards never wait.
 
 namespace chatserver {
 
@@ -39,9 +53,15 @@ namespace chatserver {
       kDuplicateID,
       kAccountWriteError,
       kIDNotExist,
-      kPasswordError
+      kPasswordError,
+      // The login nonce was already used within the replay window.
+      kNonceReplayed,
+      // Too many recent logins to record the nonce. Retry later.
+      kLoginBusy
     } AuthResult;
 
+    AccountDatabase();
+
     // Read IDs and passwords from the given file into database.
     bool Initialize(utility::string_t account_file);
 
@@ -68,11 +88,48 @@ namespace chatserver {
     // Check given ID exists on database.
     bool IsExistAccount(utility::string_t id) const;
 
+    // Copy the stored password hash of the given ID. Return false if the ID
+    // has no account.
+    bool GetPassword(const utility::string_t& id,
+                     utility::string_t* out_password) const;
+
+    // Hash string.
+    utility::string_t HashString(utility::string_t string) const;
+
     // Account database: std::map<ID, pwd>
-    std::map<utility::string_t, utility::string_t> accounts_;
+    typedef std::map<utility::string_t, utility::string_t> AccountMap;
+
+    // Partition of the account database.
+    struct AccountShard {
+      // Accounts of this shard.
+      AccountMap accounts;
+
+      // IDs of signups that are being written to the file database.
+      std::set<utility::string_t> pending_ids;
+
+      // Mutex for member variables: accounts, pending_ids. Readers take it
+      // shared, writers exclusively.
+      mutable std::shared_timed_mutex mutex_accounts;
+    };
+
+    // Number of account shards.
+    static const size_t kAccountShardCount = 64;
+
+    // Get the shard the given ID belongs to.
+    AccountShard& GetAccountShard(const utility::string_t& id);
+    const AccountShard& GetAccountShard(const utility::string_t& id) const;
+
+    // Account shards: hash(ID) % kAccountShardCount.
+    std::array<AccountShard, kAccountShardCount> account_shards_;
 
     // File database name.
     utility::string_t account_file_;
+
+    // Append new accounts to the file database in batches.
+    std::unique_ptr<AccountWriter> account_writer_;
+
+    // Nonces of the recent successful logins.
+    NonceReplayCache nonce_replay_cache_;
   };
 
 } // namespace chatserver
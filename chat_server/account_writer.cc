@@ -0,0 +1,126 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "account_writer.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <share.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "cpprest/asyncrt_utils.h"
+#include "spdlog/spdlog.h"
+
+using namespace std;
+using ::utility::string_t;
+using ::utility::conversions::to_utf8string;
+using ::spdlog::error;
+
+namespace chatserver {
+
+  AccountWriter::AccountWriter()
+      : file_(nullptr),
+        stop_writer_thread_(false) {
+  }
+
+  AccountWriter::~AccountWriter() {
+    {
+      lock_guard<mutex> lock(mutex_pending_records_);
+      stop_writer_thread_ = true;
+    }
+    pending_records_condition_.notify_one();
+    if (writer_thread_.joinable()) {
+      writer_thread_.join();
+    }
+    if (file_ != nullptr) {
+      fclose(file_);
+    }
+  }
+
+  bool AccountWriter::Open(string_t account_file) {
+    if (file_ != nullptr) {
+      error("Account writer is already opened");
+      return false;
+    }
+#ifdef _WIN32
+    // The file stays open while the server runs, so it is shared for other
+    // readers and writers like a file opened on POSIX.
+    file_ = _wfsopen(account_file.c_str(), UU("ab"), _SH_DENYNO);
+#else
+    file_ = fopen(to_utf8string(account_file).c_str(), "ab");
+#endif
+    if (file_ == nullptr) {
+      error("Can't open account file: {}", to_utf8string(account_file));
+      return false;
+    }
+    writer_thread_ = thread(&AccountWriter::RunWriterThread, this);
+    return true;
+  }
+
+  future<bool> AccountWriter::Append(string_t record) {
+    PendingRecord pending_record;
+    pending_record.line = to_utf8string(record);
+    pending_record.line.push_back('\n');
+    future<bool> written = pending_record.written.get_future();
+    {
+      lock_guard<mutex> lock(mutex_pending_records_);
+      if (file_ == nullptr || stop_writer_thread_) {
+        pending_record.written.set_value(false);
+        return written;
+      }
+      pending_records_.push_back(move(pending_record));
+    }
+    pending_records_condition_.notify_one();
+    return written;
+  }
+
+  void AccountWriter::RunWriterThread() {
+    vector<PendingRecord> batch;
+    while (true) {
+      {
+        unique_lock<mutex> lock(mutex_pending_records_);
+        pending_records_condition_.wait(lock, [this] {
+          return stop_writer_thread_ || !pending_records_.empty();
+        });
+        if (pending_records_.empty()) {
+          return;
+        }
+        // Records appended while this batch is written form the next batch.
+        batch.swap(pending_records_);
+      }
+
+      const bool written = WriteBatch(batch);
+      for (auto& pending_record : batch) {
+        pending_record.written.set_value(written);
+      }
+      batch.clear();
+    }
+  }
+
+  bool AccountWriter::WriteBatch(const vector<PendingRecord>& batch) {
+    string buffer;
+    for (const auto& pending_record : batch) {
+      buffer.append(pending_record.line);
+    }
+
+    if (fwrite(buffer.data(), 1, buffer.size(), file_) != buffer.size() ||
+        fflush(file_) != 0) {
+      error("Account file write error");
+      return false;
+    }
+#ifdef _WIN32
+    const int sync_result = _commit(_fileno(file_));
+#else
+    const int sync_result = fsync(fileno(file_));
+#endif
+    if (sync_result != 0) {
+      error("Account file sync error");
+      return false;
+    }
+    return true;
+  }
+
+} // namespace chatserver
@@ -0,0 +1,84 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_ACCOUNTWRITER_H_
+#define CHATSERVER_ACCOUNTWRITER_H_
+
+#include <condition_variable>
+#include <cstdio>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cpprest/details/basic_types.h"
+
+// This class is designed to append account records to the account file
+// database with group commit. The file is opened once and kept open. A single
+// writer thread collects every record appended while the previous batch was
+// being written, and stores the whole batch with one write and one fsync.
+// Each caller gets a future that is set once its batch is on disk.
+// Example:
+//   AccountWriter account_writer;
+//   account_writer.Open("account_db.txt");
+//   if (account_writer.Append("kaist,4171751037").get()) {
+//     the record is durable in the file database.
+//   }
+
+namespace chatserver {
+
+  class AccountWriter {
+   public:
+    AccountWriter();
+
+    // Write the pending records, stop the writer thread and close the file.
+    ~AccountWriter();
+
+    // Open the given file in append mode and run the writer thread.
+    bool Open(utility::string_t account_file);
+
+    // Queue one record (a line without line break) to the file database.
+    // The returned future is true when the batch holding the record has been
+    // written and synced, false when the write failed.
+    std::future<bool> Append(utility::string_t record);
+
+   private:
+    // Record waiting for the next batch.
+    struct PendingRecord {
+      // UTF-8 encoded line including the line break.
+      std::string line;
+
+      // Set with the result of the batch write.
+      std::promise<bool> written;
+    };
+
+    // Take every pending record as one batch and write it until stopped.
+    void RunWriterThread();
+
+    // Write the given batch with a single write call and sync the file.
+    bool WriteBatch(const std::vector<PendingRecord>& batch);
+
+    // Account file database opened in append mode.
+    FILE* file_;
+
+    // Records appended since the writer thread took the last batch.
+    std::vector<PendingRecord> pending_records_;
+
+    // Mutex for member variables: pending_records_, stop_writer_thread_
+    std::mutex mutex_pending_records_;
+
+    // Wake up the writer thread when a record is appended or on stop.
+    std::condition_variable pending_records_condition_;
+
+    // Ask the writer thread to finish after the pending records.
+    bool stop_writer_thread_;
+
+    // Thread that writes batches into file_.
+    std::thread writer_thread_;
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_ACCOUNTWRITER_H_ // CHATSERVER_ACCOUNTWRITER_H_
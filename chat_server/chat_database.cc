@@ -4,12 +4,26 @@
 
 #include "chat_database.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#ifdef _WIN32
+#include <io.h>
+#include <share.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "cpprest/asyncrt_utils.h"
 #include "spdlog/spdlog.h"
 
 namespace chatserver {
 
   using namespace std;
+  using ::utility::conversions::to_string_t;
   using ::utility::conversions::to_utf8string;
   using ::utility::string_t;
   using ::spdlog::error;
@@ -17,69 +31,395 @@ namespace chatserver {
   // Delimiter in the chat message file database.
   const string_t kParsingDelimiter = UU("|");
 
+  namespace {
+
+    // Open the file database to append lines.
+    FILE* OpenFileWriter(const string_t& file_name) {
+#ifdef _WIN32
+      // The file stays open while the database runs, so it is shared for
+      // other readers and writers like a file opened on POSIX.
+      return _wfsopen(file_name.c_str(), UU("ab"), _SH_DENYNO);
+#else
+      return fopen(to_utf8string(file_name).c_str(), "ab");
+#endif
+    }
+
+    // Append the UTF-8 text to the file database.
+    bool WriteText(FILE* file, const string& utf8_text) {
+      return fwrite(utf8_text.data(), 1, utf8_text.size(), file) ==
+                 utf8_text.size() &&
+             fflush(file) == 0;
+    }
+
+    // Get the size of the file database. The file must have no buffered
+    // output.
+    bool GetFileSize(FILE* file, int64_t* out_size) {
+#ifdef _WIN32
+      *out_size = _filelengthi64(_fileno(file));
+      return *out_size >= 0;
+#else
+      struct stat file_stat;
+      if (fstat(fileno(file), &file_stat) != 0) {
+        return false;
+      }
+      *out_size = file_stat.st_size;
+      return true;
+#endif
+    }
+
+    // Cut the file database back to the given size.
+    bool TruncateFile(FILE* file, int64_t size) {
+      clearerr(file);
+#ifdef _WIN32
+      return _chsize_s(_fileno(file), size) == 0;
+#else
+      return ftruncate(fileno(file), static_cast<off_t>(size)) == 0;
+#endif
+    }
+
+    // Append the line and a line break to the file database.
+    bool WriteLine(FILE* file, const string_t& line) {
+      string utf8_line = to_utf8string(line);
+      utf8_line.push_back('\n');
+      return WriteText(file, utf8_line);
+    }
+
+    // Open the file database to read UTF-8 lines.
+    void OpenFileReader(const string_t& file_name, ifstream* out_file) {
+#ifdef _WIN32
+      out_file->open(file_name, ios::binary);
+#else
+      out_file->open(to_utf8string(file_name), ios::binary);
+#endif
+    }
+
+    // Read a UTF-8 line of the file database without its line break.
+    bool ReadLine(ifstream* file, string_t* out_line) {
+      string utf8_line;
+      if (!getline(*file, utf8_line)) {
+        return false;
+      }
+      if (!utf8_line.empty() && utf8_line.back() == '\r') {
+        utf8_line.pop_back();
+      }
+      *out_line = to_string_t(utf8_line);
+      return true;
+    }
+
+    // Append the UTF-8 line of the chat message in the chat message file
+    // database and a line break.
+    void AppendChatMessageLine(const ChatMessage& message, string* out_text) {
+      const string delimiter = to_utf8string(kParsingDelimiter);
+      out_text->append(to_string(message.date));
+      out_text->append(delimiter);
+      out_text->append(to_utf8string(message.user_id));
+      out_text->append(delimiter);
+      out_text->append(to_utf8string(message.chat_room));
+      out_text->append(delimiter);
+      out_text->append(to_utf8string(message.chat_message));
+      out_text->push_back('\n');
+    }
+
+  } // namespace
+
+  ChatDatabase::ChatDatabase()
+      : chat_message_writer_(nullptr),
+        chat_room_writer_(nullptr) {
+  }
+
+  ChatDatabase::~ChatDatabase() {
+    if (chat_message_writer_ != nullptr) {
+      fclose(chat_message_writer_);
+    }
+    if (chat_room_writer_ != nullptr) {
+      fclose(chat_room_writer_);
+    }
+  }
+
   bool ChatDatabase::Initialize(string_t chat_message_file,
                                 string_t chat_room_file) {
+    lock_guard<mutex> lock(mutex_chat_database_);
     chat_message_file_ = chat_message_file;
     chat_room_file_ = chat_room_file;
+    chat_messages_.clear();
+    chat_rooms_.clear();
+
+    if (!ReadChatRoomFromFileDatabase(chat_room_file_)) {
+      error("Error to open chat room file: {}",
+            to_utf8string(chat_room_file_));
+      return false;
+    }
 
-    // ToDo: Use the below commented code. We comment on the code because of the
-    // ToDo: execution of skeleton code.
-    /*
     if (!ReadChatMessagesFromFileDatabase(chat_message_file_)) {
       error("Error to open chat message file: {}",
             to_utf8string(chat_message_file_));
       return false;
     }
 
-    if (!ReadChatRoomFromFileDatabase(chat_room_file_)) {
-      error("Error to open chat room file: {}", 
-            to_utf8string(chat_room_file_));
+    if (chat_message_writer_ != nullptr) {
+      fclose(chat_message_writer_);
+    }
+    if (chat_room_writer_ != nullptr) {
+      fclose(chat_room_writer_);
+    }
+    chat_message_writer_ = OpenFileWriter(chat_message_file_);
+    chat_room_writer_ = OpenFileWriter(chat_room_file_);
+    if (chat_message_writer_ == nullptr || chat_room_writer_ == nullptr) {
+      error("Can't open chat file database to write");
       return false;
-    }*/
+    }
+    // Every write is flushed at once anyway. Without a buffer, a failed
+    // write leaves no output behind that a later flush would append.
+    setvbuf(chat_message_writer_, nullptr, _IONBF, 0);
     return true;
   }
 
   bool ChatDatabase::StoreChatMessage(const ChatMessage& message) {
-    // ToDo: Check if the given message has delimiter.
-    // ToDo: Save the given message into chat message file DB.
-    // ToDo: Save the given message into chat_messages_
-    return false;
+    return StoreChatMessage(ChatMessage(message));
+  }
+
+  bool ChatDatabase::StoreChatMessage(ChatMessage&& message) {
+    if (!IsStorableText(message.user_id) ||
+        !IsStorableText(message.chat_room) ||
+        !IsStorableText(message.chat_message)) {
+      return false;
+    }
+    string utf8_line;
+    AppendChatMessageLine(message, &utf8_line);
+
+    ChatMessageListener chat_message_listener;
+    // The stored message may move when the room grows, so the listener gets
+    // a copy. It is only made if a listener is set.
+    ChatMessage listened_message;
+    size_t message_count;
+    {
+      lock_guard<mutex> lock(mutex_chat_database_);
+      if (find(chat_rooms_.begin(), chat_rooms_.end(), message.chat_room) ==
+              chat_rooms_.end() ||
+          chat_message_writer_ == nullptr) {
+        return false;
+      }
+      if (!WriteText(chat_message_writer_, utf8_line)) {
+        error("Can't write chat message file: {}",
+              to_utf8string(chat_message_file_));
+        return false;
+      }
+      vector<ChatMessage>& room_messages = chat_messages_[message.chat_room];
+      room_messages.push_back(move(message));
+      message_count = room_messages.size();
+      chat_message_listener = chat_message_listener_;
+      if (chat_message_listener) {
+        listened_message = room_messages.back();
+      }
+    }
+
+    // The listener may take time, so it is called without the lock.
+    if (chat_message_listener) {
+      chat_message_listener(listened_message, message_count);
+    }
+    return true;
+  }
+
+  bool ChatDatabase::StoreChatMessages(const vector<ChatMessage>& messages) {
+    // Every message is checked and formatted before anything is stored.
+    string utf8_lines;
+    for (const auto& message : messages) {
+      if (!IsStorableText(message.user_id) ||
+          !IsStorableText(message.chat_room) ||
+          !IsStorableText(message.chat_message)) {
+        return false;
+      }
+      AppendChatMessageLine(message, &utf8_lines);
+    }
+
+    ChatMessageListener chat_message_listener;
+    vector<size_t> message_counts;
+    {
+      lock_guard<mutex> lock(mutex_chat_database_);
+      if (chat_message_writer_ == nullptr) {
+        return false;
+      }
+      for (const auto& message : messages) {
+        if (find(chat_rooms_.begin(), chat_rooms_.end(),
+                 message.chat_room) == chat_rooms_.end()) {
+          return false;
+        }
+      }
+      // A failed write may have written a part of the lines. It is cut
+      // off, so the file never holds a part of the group.
+      int64_t file_size;
+      if (!GetFileSize(chat_message_writer_, &file_size)) {
+        error("Can't get chat message file size: {}",
+              to_utf8string(chat_message_file_));
+        return false;
+      }
+      if (!WriteText(chat_message_writer_, utf8_lines)) {
+        error("Can't write chat message file: {}",
+              to_utf8string(chat_message_file_));
+        if (!TruncateFile(chat_message_writer_, file_size)) {
+          error("Can't truncate chat message file: {}",
+                to_utf8string(chat_message_file_));
+        }
+        return false;
+      }
+      message_counts.reserve(messages.size());
+      for (const auto& message : messages) {
+        vector<ChatMessage>& room_messages =
+            chat_messages_[message.chat_room];
+        room_messages.push_back(message);
+        message_counts.push_back(room_messages.size());
+      }
+      chat_message_listener = chat_message_listener_;
+    }
+
+    // The listener may take time, so it is called without the lock.
+    if (chat_message_listener) {
+      for (size_t i = 0; i < messages.size(); ++i) {
+        chat_message_listener(messages[i], message_counts[i]);
+      }
+    }
+    return true;
   }
 
   const vector<ChatMessage>* ChatDatabase::GetAllChatMessages(
       string_t chat_room) {
-    // ToDo: Return chat message of the given chat room.
-    return nullptr;
+    lock_guard<mutex> lock(mutex_chat_database_);
+    const auto chat_room_it = chat_messages_.find(chat_room);
+    if (chat_room_it == chat_messages_.end()) {
+      return nullptr;
+    }
+    return &chat_room_it->second;
+  }
+
+  bool ChatDatabase::GetChatMessages(const string_t& chat_room, size_t since,
+                                     vector<ChatMessage>* out_chat_messages,
+                                     size_t* out_cursor) const {
+    lock_guard<mutex> lock(mutex_chat_database_);
+    if (find(chat_rooms_.begin(), chat_rooms_.end(), chat_room) ==
+            chat_rooms_.end()) {
+      return false;
+    }
+    out_chat_messages->clear();
+    *out_cursor = 0;
+    const auto chat_room_it = chat_messages_.find(chat_room);
+    if (chat_room_it == chat_messages_.end()) {
+      return true;
+    }
+    const vector<ChatMessage>& room_messages = chat_room_it->second;
+    if (since < room_messages.size()) {
+      out_chat_messages->assign(room_messages.begin() + since,
+                                room_messages.end());
+    }
+    *out_cursor = room_messages.size();
+    return true;
+  }
+
+  void ChatDatabase::SetChatMessageListener(ChatMessageListener listener) {
+    lock_guard<mutex> lock(mutex_chat_database_);
+    chat_message_listener_ = move(listener);
   }
 
   bool ChatDatabase::CreateChatRoom(string_t chat_room) {
-    // ToDo: Check if the given chat_room name is correct.
-    // ToDo: Check if the given chat_room name is duplicate.
-    // ToDo: Save the given chat_room into chat room file DB.
-    // ToDo: Save the given chat_room into chat_rooms_.
-    return false;
+    if (chat_room.empty() || !IsStorableText(chat_room)) {
+      return false;
+    }
+    lock_guard<mutex> lock(mutex_chat_database_);
+    if (find(chat_rooms_.begin(), chat_rooms_.end(), chat_room) !=
+            chat_rooms_.end() ||
+        chat_room_writer_ == nullptr) {
+      return false;
+    }
+    if (!WriteLine(chat_room_writer_, chat_room)) {
+      error("Can't write chat room file: {}",
+            to_utf8string(chat_room_file_));
+      return false;
+    }
+    chat_rooms_.push_back(chat_room);
+    return true;
   }
 
   bool ChatDatabase::IsExistChatRoom(string_t chat_room) const {
-    // ToDo: The given chat_room exist in chat_rooms_.
-    return false;
+    lock_guard<mutex> lock(mutex_chat_database_);
+    return find(chat_rooms_.begin(), chat_rooms_.end(), chat_room) !=
+           chat_rooms_.end();
   }
 
-  const vector<string_t>* ChatDatabase::GetChatRoomList() const{
-    // ToDo: Implement to return chat room list.
-    return nullptr;
+  vector<string_t> ChatDatabase::GetChatRoomList() const {
+    // A copy, since another thread can create a chat room meanwhile.
+    lock_guard<mutex> lock(mutex_chat_database_);
+    return chat_rooms_;
   }
 
   bool ChatDatabase::ReadChatMessagesFromFileDatabase(
       string_t chat_message_file) {
-    // ToDo: Implement saving the given chat message DB file into
-    // ToDo: chat_messages_.
-    return false;
+    // The file is written in UTF-8, so it is read as bytes and converted.
+    ifstream file;
+    OpenFileReader(chat_message_file, &file);
+    if (!file.is_open()) {
+      error("Can't open chat message file: {}",
+            to_utf8string(chat_message_file));
+      return false;
+    }
+
+    // Format: date|user_id|chat_room|chat_message
+    string_t line;
+    while (ReadLine(&file, &line)) {
+      if (line.length() == 0) continue;
+      const size_t user_index = line.find(kParsingDelimiter);
+      const size_t room_index = user_index == string_t::npos
+                                    ? string_t::npos
+                                    : line.find(kParsingDelimiter,
+                                                user_index + 1);
+      const size_t message_index = room_index == string_t::npos
+                                       ? string_t::npos
+                                       : line.find(kParsingDelimiter,
+                                                   room_index + 1);
+      if (message_index == string_t::npos || user_index == 0) {
+        error("Chat message file parsing error");
+        return false;
+      }
+
+      ChatMessage message;
+      try {
+        message.date = static_cast<time_t>(
+            stoll(line.substr(0, user_index)));
+      } catch (const exception&) {
+        error("Chat message file parsing error");
+        return false;
+      }
+      message.user_id =
+          line.substr(user_index + 1, room_index - user_index - 1);
+      message.chat_room =
+          line.substr(room_index + 1, message_index - room_index - 1);
+      message.chat_message = line.substr(message_index + 1);
+      chat_messages_[message.chat_room].push_back(message);
+    }
+    return true;
   }
 
   bool ChatDatabase::ReadChatRoomFromFileDatabase(string_t chat_room_file) {
-    // ToDo: Implement saving the given chat room DB file into chat_rooms_.
-    return false;
+    ifstream file;
+    OpenFileReader(chat_room_file, &file);
+    if (!file.is_open()) {
+      error("Can't open chat room file: {}", to_utf8string(chat_room_file));
+      return false;
+    }
+
+    string_t line;
+    while (ReadLine(&file, &line)) {
+      if (line.length() == 0) continue;
+      if (find(chat_rooms_.begin(), chat_rooms_.end(), line) ==
+              chat_rooms_.end()) {
+        chat_rooms_.push_back(line);
+      }
+    }
+    return true;
+  }
+
+  bool ChatDatabase::IsStorableText(const string_t& text) const {
+    return text.find(kParsingDelimiter) == string_t::npos &&
+           text.find(UU('\n')) == string_t::npos &&
+           text.find(UU('\r')) == string_t::npos;
   }
 
 } // namespace chatserver
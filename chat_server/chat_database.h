@@ -5,7 +5,10 @@
 #ifndef CHATSERVER_CHATDATABASE_H_
 #define CHATSERVER_CHATDATABASE_H_
 
+#include <cstdio>
+#include <functional>
 #include <map>
+#include <mutex>
 #include <vector>
 
 #include "cpprest/details/basic_types.h"
@@ -36,11 +39,26 @@
 //     do something to fail to create the chat room
 //   }
 // The usage with GetChatList() function is similar to the above.
+//
+// The class is thread-safe. Messages of a room are numbered from 0 in the
+// order they are stored, and GetChatMessages reads the messages from a given
+// number (cursor) on. A listener set by SetChatMessageListener is called
+// after each stored message, so that waiting readers can be woken up.
 
 namespace chatserver {
 
   class ChatDatabase {
    public:
+    // Called with the stored message and the new number of messages of its
+    // chat room after a message is stored.
+    typedef std::function<void(const ChatMessage& chat_message,
+                               size_t message_count)> ChatMessageListener;
+
+    ChatDatabase();
+
+    // Close the chat message file database.
+    ~ChatDatabase();
+
     // Read chat messages and chat rooms from given file into database.
     bool Initialize(utility::string_t chat_message_file,
                     utility::string_t chat_room_file);
@@ -48,18 +66,37 @@ namespace chatserver {
     // Store chat message on the database.
     bool StoreChatMessage(const ChatMessage& message);
 
-    // Get all chat messages in the given chat room.
+    // Store chat message on the database. The message is moved in.
+    bool StoreChatMessage(ChatMessage&& message);
+
+    // Store the chat messages, of any chat rooms, as one group: either all
+    // of them are stored with one file write, or none is. A failed write is
+    // cut off the file. The listener is called for each message in order.
+    bool StoreChatMessages(const std::vector<ChatMessage>& messages);
+
+    // Get all chat messages in the given chat room. The vector can change
+    // while another thread stores a message; use GetChatMessages then.
     const std::vector<ChatMessage>* GetAllChatMessages(
         utility::string_t chat_room);
 
+    // Copy the messages of the chat room from number since on into
+    // out_chat_messages, and set out_cursor to the number of messages of the
+    // room. Return false if the chat room does not exist.
+    bool GetChatMessages(const utility::string_t& chat_room, size_t since,
+                         std::vector<ChatMessage>* out_chat_messages,
+                         size_t* out_cursor) const;
+
+    // Set the listener called after each stored message. nullptr removes it.
+    void SetChatMessageListener(ChatMessageListener listener);
+
     // Create the chat room.
     bool CreateChatRoom(utility::string_t chat_room);
 
     // Check the given chat room exists.
     bool IsExistChatRoom(utility::string_t chat_room) const;
 
-    // Get every chat room list.
-    const std::vector<utility::string_t>* GetChatRoomList() const;
+    // Get a copy of every chat room list.
+    std::vector<utility::string_t> GetChatRoomList() const;
 
    private:
     // Read chat messages from the given file into database.
@@ -68,6 +105,9 @@ namespace chatserver {
     // Read chat rooms from the given file into database.
     bool ReadChatRoomFromFileDatabase(utility::string_t chat_room_file);
 
+    // Check the text can be stored in the file databases.
+    bool IsStorableText(const utility::string_t& text) const;
+
     // Chat message database: std::map<chat room, ChatMessage>.
     std::map<utility::string_t, std::vector<ChatMessage>> chat_messages_;
 
@@ -79,6 +119,19 @@ namespace chatserver {
 
     // Chat room file database name.
     utility::string_t chat_room_file_;
+
+    // Chat message file database opened to append.
+    std::FILE* chat_message_writer_;
+
+    // Chat room file database opened to append.
+    std::FILE* chat_room_writer_;
+
+    // Listener called after each stored message.
+    ChatMessageListener chat_message_listener_;
+
+    // Mutex for member variables: chat_messages_, chat_rooms_,
+    // chat_message_writer_, chat_room_writer_, chat_message_listener_
+    mutable std::mutex mutex_chat_database_;
   };
 
 } // namespace chatserver
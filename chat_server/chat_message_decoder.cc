@@ -0,0 +1,393 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "chat_message_decoder.h"
+
+using namespace std;
+using ::utility::char_t;
+using ::utility::string_t;
+
+namespace chatserver {
+
+  // Largest Unicode code point.
+  const uint32_t kMaxCodePoint = 0x10FFFF;
+  // Range of UTF-16 surrogates.
+  const uint32_t kHighSurrogateBegin = 0xD800;
+  const uint32_t kLowSurrogateBegin = 0xDC00;
+  const uint32_t kSurrogateEnd = 0xE000;
+
+  namespace {
+
+    bool IsJsonWhitespace(uint8_t byte) {
+      return byte == ' ' || byte == '\t' || byte == '\n' || byte == '\r';
+    }
+
+    // Character of a single character JSON escape, or 0.
+    uint32_t EscapedCharacter(uint8_t byte) {
+      switch (byte) {
+        case '"':
+        case '\\':
+        case '/':
+          return byte;
+        case 'b':
+          return '\b';
+        case 'f':
+          return '\f';
+        case 'n':
+          return '\n';
+        case 'r':
+          return '\r';
+        case 't':
+          return '\t';
+        default:
+          return 0;
+      }
+    }
+
+  } // namespace
+
+  ChatMessageDecoder::ChatMessageDecoder(BodyFormat body_format,
+                                         size_t max_body_size,
+                                         ChatMessage* out_chat_message)
+      : body_format_(body_format),
+        max_body_size_(max_body_size),
+        chat_message_(out_chat_message),
+        message_template_(0, string_t(), string_t(), string_t()),
+        chat_messages_(nullptr),
+        body_size_(0),
+        json_state_(kBeforeObject),
+        escape_state_(kNoEscape),
+        target_(nullptr),
+        code_point_(0),
+        pending_count_(0),
+        min_code_point_(0),
+        high_surrogate_(0),
+        has_chat_message_(false) {
+    if (body_format_ == kRawBody) {
+      target_ = &chat_message_->chat_message;
+      target_->clear();
+    }
+  }
+
+  ChatMessageDecoder::ChatMessageDecoder(
+      size_t max_body_size, const ChatMessage& message_template,
+      vector<ChatMessage>* out_chat_messages)
+      : body_format_(kJsonArrayBody),
+        max_body_size_(max_body_size),
+        chat_message_(nullptr),
+        message_template_(message_template),
+        chat_messages_(out_chat_messages),
+        body_size_(0),
+        json_state_(kBeforeArray),
+        escape_state_(kNoEscape),
+        target_(nullptr),
+        code_point_(0),
+        pending_count_(0),
+        min_code_point_(0),
+        high_surrogate_(0),
+        has_chat_message_(false) {
+  }
+
+  ChatMessageDecoder::Status ChatMessageDecoder::Decode(const uint8_t* data,
+                                                        size_t size) {
+    if (size > max_body_size_ - body_size_) {
+      return kTooLarge;
+    }
+    body_size_ += size;
+    for (size_t i = 0; i < size; ++i) {
+      const bool is_decoded = body_format_ == kRawBody
+                                  ? DecodeUtf8Byte(data[i])
+                                  : DecodeJsonByte(data[i]);
+      if (!is_decoded) {
+        return kMalformed;
+      }
+    }
+    return kDecoding;
+  }
+
+  ChatMessageDecoder::Status ChatMessageDecoder::Finish() {
+    if (body_format_ == kRawBody) {
+      return pending_count_ == 0 ? kDecoded : kMalformed;
+    }
+    if (body_format_ == kJsonArrayBody) {
+      return json_state_ == kAfterArray ? kDecoded : kMalformed;
+    }
+    return json_state_ == kAfterObject && has_chat_message_ ? kDecoded
+                                                             : kMalformed;
+  }
+
+  bool ChatMessageDecoder::DecodeJsonByte(uint8_t byte) {
+    bool is_end = false;
+    switch (json_state_) {
+      case kBeforeArray:
+        if (byte == '[') {
+          json_state_ = kBeforeFirstElement;
+          return true;
+        }
+        return IsJsonWhitespace(byte);
+      case kBeforeFirstElement:
+      case kBeforeElement:
+        if (byte == '{') {
+          chat_messages_->push_back(message_template_);
+          chat_message_ = &chat_messages_->back();
+          has_chat_message_ = false;
+          json_state_ = kBeforeFirstKey;
+          return true;
+        }
+        if (byte == ']' && json_state_ == kBeforeFirstElement) {
+          json_state_ = kAfterArray;
+          return true;
+        }
+        return IsJsonWhitespace(byte);
+      case kAfterElement:
+        if (byte == ',') {
+          json_state_ = kBeforeElement;
+          return true;
+        }
+        if (byte == ']') {
+          json_state_ = kAfterArray;
+          return true;
+        }
+        return IsJsonWhitespace(byte);
+      case kAfterArray:
+        return IsJsonWhitespace(byte);
+      case kBeforeObject:
+        if (byte == '{') {
+          json_state_ = kBeforeFirstKey;
+          return true;
+        }
+        return IsJsonWhitespace(byte);
+      case kBeforeFirstKey:
+      case kBeforeKey:
+        if (byte == '"') {
+          key_.clear();
+          target_ = &key_;
+          json_state_ = kInKey;
+          return true;
+        }
+        if (byte == '}' && json_state_ == kBeforeFirstKey) {
+          return DecodeObjectEnd();
+        }
+        return IsJsonWhitespace(byte);
+      case kInKey:
+        if (!DecodeStringByte(byte, &is_end)) {
+          return false;
+        }
+        if (is_end) {
+          json_state_ = kAfterKey;
+        }
+        return true;
+      case kAfterKey:
+        if (byte == ':') {
+          json_state_ = kBeforeValue;
+          return true;
+        }
+        return IsJsonWhitespace(byte);
+      case kBeforeValue:
+        if (byte == '"') {
+          // Only string values are accepted. Later fields win.
+          target_ = nullptr;
+          if (key_ == UU("chat_room")) {
+            target_ = &chat_message_->chat_room;
+          } else if (key_ == UU("chat_message")) {
+            target_ = &chat_message_->chat_message;
+            has_chat_message_ = true;
+          }
+          if (target_ != nullptr) {
+            target_->clear();
+          }
+          json_state_ = kInValue;
+          return true;
+        }
+        return IsJsonWhitespace(byte);
+      case kInValue:
+        if (!DecodeStringByte(byte, &is_end)) {
+          return false;
+        }
+        if (is_end) {
+          target_ = nullptr;
+          json_state_ = kAfterValue;
+        }
+        return true;
+      case kAfterValue:
+        if (byte == ',') {
+          json_state_ = kBeforeKey;
+          return true;
+        }
+        if (byte == '}') {
+          return DecodeObjectEnd();
+        }
+        return IsJsonWhitespace(byte);
+      case kAfterObject:
+        return IsJsonWhitespace(byte);
+    }
+    return false;
+  }
+
+  bool ChatMessageDecoder::DecodeObjectEnd() {
+    if (body_format_ != kJsonArrayBody) {
+      json_state_ = kAfterObject;
+      return true;
+    }
+    // Each object of an array must have its own chat message.
+    json_state_ = kAfterElement;
+    return has_chat_message_;
+  }
+
+  bool ChatMessageDecoder::DecodeStringByte(uint8_t byte, bool* out_is_end) {
+    *out_is_end = false;
+    if (escape_state_ == kUnicodeEscape) {
+      return DecodeUnicodeEscapeDigit(byte);
+    }
+    if (escape_state_ == kEscape) {
+      escape_state_ = kNoEscape;
+      if (byte == 'u') {
+        escape_state_ = kUnicodeEscape;
+        code_point_ = 0;
+        pending_count_ = 4;
+        return true;
+      }
+      // A high surrogate must be followed by a \u low surrogate.
+      const uint32_t character = EscapedCharacter(byte);
+      if (character == 0 || high_surrogate_ != 0) {
+        return false;
+      }
+      AppendCodePoint(character);
+      return true;
+    }
+
+    if (pending_count_ == 0) {
+      if (byte == '\\') {
+        escape_state_ = kEscape;
+        return true;
+      }
+      if (high_surrogate_ != 0 || byte < 0x20) {
+        return false;
+      }
+      if (byte == '"') {
+        *out_is_end = true;
+        return true;
+      }
+    }
+    return DecodeUtf8Byte(byte);
+  }
+
+  bool ChatMessageDecoder::DecodeUtf8Byte(uint8_t byte) {
+    if (pending_count_ == 0) {
+      if (byte < 0x80) {
+        AppendCodePoint(byte);
+        return true;
+      }
+      if ((byte & 0xE0) == 0xC0) {
+        code_point_ = byte & 0x1F;
+        pending_count_ = 1;
+        min_code_point_ = 0x80;
+      } else if ((byte & 0xF0) == 0xE0) {
+        code_point_ = byte & 0x0F;
+        pending_count_ = 2;
+        min_code_point_ = 0x800;
+      } else if ((byte & 0xF8) == 0xF0) {
+        code_point_ = byte & 0x07;
+        pending_count_ = 3;
+        min_code_point_ = 0x10000;
+      } else {
+        return false;
+      }
+      return true;
+    }
+
+    if ((byte & 0xC0) != 0x80) {
+      return false;
+    }
+    code_point_ = (code_point_ << 6) | (byte & 0x3F);
+    if (--pending_count_ == 0) {
+      if (code_point_ < min_code_point_ || code_point_ > kMaxCodePoint ||
+          (code_point_ >= kHighSurrogateBegin &&
+           code_point_ < kSurrogateEnd)) {
+        return false;
+      }
+      AppendCodePoint(code_point_);
+    }
+    return true;
+  }
+
+  bool ChatMessageDecoder::DecodeUnicodeEscapeDigit(uint8_t byte) {
+    uint32_t digit;
+    if (byte >= '0' && byte <= '9') {
+      digit = byte - '0';
+    } else if (byte >= 'a' && byte <= 'f') {
+      digit = byte - 'a' + 10;
+    } else if (byte >= 'A' && byte <= 'F') {
+      digit = byte - 'A' + 10;
+    } else {
+      return false;
+    }
+    code_point_ = (code_point_ << 4) | digit;
+    if (--pending_count_ != 0) {
+      return true;
+    }
+
+    escape_state_ = kNoEscape;
+    const bool is_high_surrogate = code_point_ >= kHighSurrogateBegin &&
+                                   code_point_ < kLowSurrogateBegin;
+    const bool is_low_surrogate = code_point_ >= kLowSurrogateBegin &&
+                                  code_point_ < kSurrogateEnd;
+    if (high_surrogate_ != 0) {
+      if (!is_low_surrogate) {
+        return false;
+      }
+      AppendCodePoint(0x10000 +
+                      ((high_surrogate_ - kHighSurrogateBegin) << 10) +
+                      (code_point_ - kLowSurrogateBegin));
+      high_surrogate_ = 0;
+      return true;
+    }
+    if (is_high_surrogate) {
+      high_surrogate_ = code_point_;
+      return true;
+    }
+    if (is_low_surrogate) {
+      return false;
+    }
+    AppendCodePoint(code_point_);
+    return true;
+  }
+
+  void ChatMessageDecoder::AppendCodePoint(uint32_t code_point) {
+    if (target_ == nullptr) {
+      return;
+    }
+    if (sizeof(char_t) == 1) {
+      // UTF-8 strings.
+      if (code_point < 0x80) {
+        target_->push_back(static_cast<char_t>(code_point));
+      } else if (code_point < 0x800) {
+        target_->push_back(static_cast<char_t>(0xC0 | (code_point >> 6)));
+        target_->push_back(static_cast<char_t>(0x80 | (code_point & 0x3F)));
+      } else if (code_point < 0x10000) {
+        target_->push_back(static_cast<char_t>(0xE0 | (code_point >> 12)));
+        target_->push_back(
+            static_cast<char_t>(0x80 | ((code_point >> 6) & 0x3F)));
+        target_->push_back(static_cast<char_t>(0x80 | (code_point & 0x3F)));
+      } else {
+        target_->push_back(static_cast<char_t>(0xF0 | (code_point >> 18)));
+        target_->push_back(
+            static_cast<char_t>(0x80 | ((code_point >> 12) & 0x3F)));
+        target_->push_back(
+            static_cast<char_t>(0x80 | ((code_point >> 6) & 0x3F)));
+        target_->push_back(static_cast<char_t>(0x80 | (code_point & 0x3F)));
+      }
+    } else if (sizeof(char_t) == 2 && code_point >= 0x10000) {
+      // UTF-16 strings.
+      code_point -= 0x10000;
+      target_->push_back(
+          static_cast<char_t>(kHighSurrogateBegin + (code_point >> 10)));
+      target_->push_back(
+          static_cast<char_t>(kLowSurrogateBegin + (code_point & 0x3FF)));
+    } else {
+      target_->push_back(static_cast<char_t>(code_point));
+    }
+  }
+
+} // namespace chatserver
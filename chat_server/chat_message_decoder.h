@@ -0,0 +1,160 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_CHATMESSAGEDECODER_H_
+#define CHATSERVER_CHATMESSAGEDECODER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "cpprest/details/basic_types.h"
+#include "chat_message.h"
+
+// This class is designed to decode a chat message request body while it
+// arrives, chunk by chunk, so that the body is never buffered as a whole.
+// The decoded UTF-8 text is appended to the fields of the chat message
+// directly. The body is either:
+//   kJsonBody: {"chat_room": "gsis", "chat_message": "hi"}
+//              Other string fields are skipped.
+//   kRawBody:  the UTF-8 chat message text itself.
+//   kJsonArrayBody: [{"chat_room": "gsis", "chat_message": "hi"}, ...]
+//              Each object is decoded into a new chat message.
+// The class is not thread-safe.
+// Example:
+//   ChatMessage chat_message;
+//   ChatMessageDecoder decoder(ChatMessageDecoder::kJsonBody, 65536,
+//                              &chat_message);
+//   For each chunk of the body:
+//     if (decoder.Decode(chunk, chunk_size) !=
+//         ChatMessageDecoder::kDecoding) {
+//       Reply the error.
+//     }
+//   if (decoder.Finish() == ChatMessageDecoder::kDecoded) {
+//     Store chat_message.
+//   }
+
+namespace chatserver {
+
+  class ChatMessageDecoder {
+   public:
+    // Format of the request body.
+    enum BodyFormat { kJsonBody, kRawBody, kJsonArrayBody };
+
+    enum Status {
+      // More of the body is expected.
+      kDecoding,
+      // The body is decoded.
+      kDecoded,
+      // The body is not valid JSON or UTF-8, or misses a field.
+      kMalformed,
+      // The body is longer than the maximum size.
+      kTooLarge
+    };
+
+    // Decode at most max_body_size bytes into out_chat_message, which must
+    // outlive the decoder. Fields absent from the body keep their values.
+    ChatMessageDecoder(BodyFormat body_format, size_t max_body_size,
+                       ChatMessage* out_chat_message);
+
+    // Decode a kJsonArrayBody of at most max_body_size bytes. Each object
+    // is appended to out_chat_messages, which must outlive the decoder, as
+    // a copy of message_template with the fields of the object.
+    ChatMessageDecoder(size_t max_body_size,
+                       const ChatMessage& message_template,
+                       std::vector<ChatMessage>* out_chat_messages);
+
+    // Decode the next chunk of the body. Return kDecoding, or the error.
+    Status Decode(const uint8_t* data, size_t size);
+
+    // Decode the end of the body. Return kDecoded, or the error.
+    Status Finish();
+
+   private:
+    // Position in the JSON body.
+    enum JsonState {
+      kBeforeArray,
+      kBeforeFirstElement,
+      kBeforeElement,
+      kAfterElement,
+      kAfterArray,
+      kBeforeObject,
+      kBeforeFirstKey,
+      kBeforeKey,
+      kInKey,
+      kAfterKey,
+      kBeforeValue,
+      kInValue,
+      kAfterValue,
+      kAfterObject
+    };
+
+    // Position in a JSON string escape.
+    enum EscapeState { kNoEscape, kEscape, kUnicodeEscape };
+
+    // Decode one byte of the JSON body. Return false if it is malformed.
+    bool DecodeJsonByte(uint8_t byte);
+
+    // Decode the end of an object. Return false if it is malformed.
+    bool DecodeObjectEnd();
+
+    // Decode one byte inside a JSON string. Set out_is_end when the
+    // string ends. Return false if it is malformed.
+    bool DecodeStringByte(uint8_t byte, bool* out_is_end);
+
+    // Decode one UTF-8 byte of text. Return false if it is malformed.
+    bool DecodeUtf8Byte(uint8_t byte);
+
+    // Decode one hex digit of a \u escape. Return false if it is
+    // malformed.
+    bool DecodeUnicodeEscapeDigit(uint8_t byte);
+
+    // Append the code point to the string being decoded.
+    void AppendCodePoint(uint32_t code_point);
+
+    const BodyFormat body_format_;
+
+    const size_t max_body_size_;
+
+    // Chat message being decoded.
+    ChatMessage* chat_message_;
+
+    // kJsonArrayBody: first fields of each chat message.
+    const ChatMessage message_template_;
+
+    // kJsonArrayBody: decoded chat messages.
+    std::vector<ChatMessage>* chat_messages_;
+
+    // Number of decoded bytes.
+    size_t body_size_;
+
+    JsonState json_state_;
+
+    EscapeState escape_state_;
+
+    // String being decoded, or nullptr if it is skipped.
+    utility::string_t* target_;
+
+    // Key of the field being decoded.
+    utility::string_t key_;
+
+    // Code point of the UTF-8 sequence or \u escape being decoded.
+    uint32_t code_point_;
+
+    // Bytes left in the UTF-8 sequence, or hex digits left in the \u
+    // escape.
+    int pending_count_;
+
+    // Smallest code point of the UTF-8 sequence, to refuse overlong forms.
+    uint32_t min_code_point_;
+
+    // High surrogate of a \u escape pair, or 0.
+    uint32_t high_surrogate_;
+
+    // Whether the JSON object has a chat_message field.
+    bool has_chat_message_;
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_CHATMESSAGEDECODER_H_ // CHATSERVER_CHATMESSAGEDECODER_H_
@@ -4,18 +4,28 @@
 
 #include "chat_server.h"
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <vector>
+
 #include "cpprest/json.h"
+#include "cpprest/rawptrstream.h"
 #include "cpprest/uri.h"
 #include "spdlog/spdlog.h"
+#include "chat_message_decoder.h"
+#include "coarse_clock.h"
 
 using namespace std;
-using ::web::uri;
 using ::web::http::methods;
 using ::web::http::http_request;
+using ::web::http::http_response;
+using ::web::http::status_code;
 using ::web::http::status_codes;
 using ::web::http::experimental::listener::http_listener;
 using ::web::json::value;
 using ::utility::string_t;
+using ::utility::conversions::to_string_t;
 using ::utility::conversions::to_utf8string;
 using ::pplx::task;
 using ::spdlog::info;
@@ -24,12 +34,406 @@ using ::spdlog::error;
 
 namespace chatserver {
 
+  // Number of threads for password hashing and verification.
+  const size_t kHashWorkerThreadCount = 2;
+  // Maximum number of logins waiting for a hashing thread.
+  const size_t kHashWorkerQueueDepth = 1024;
+  // Signup and login burst and rate (per second) of a remote address.
+  const uint32_t kAddressRateBurst = 30;
+  const uint32_t kAddressRatePerSecond = 10;
+  // Signup and login burst and rate (per second) of an ID.
+  const uint32_t kIDRateBurst = 5;
+  const uint32_t kIDRatePerSecond = 1;
+  // HTTP status code: Too Many Requests.
+  const status_code kTooManyRequests = 429;
+  // Maximum wait time of a long-poll chat message request.
+  const chrono::seconds kMaxLongPollWait(30);
+  // Maximum number of parked long-poll requests.
+  const size_t kMaxLongPollWaiters = 4096;
+  // Path of the WebSocket chat message stream.
+  const char kChatStreamPath[] = "chatstream";
+  // Maximum number of queued items handed to the WebSocket server at once.
+  const size_t kWebSocketSendBatch = 16;
+  // Interval to renew the sessions of open connections (second). It is
+  // shorter than the session alive time, so a listening client stays logged
+  // in.
+  const int kConnectionHeartbeatInterval = 10;
+  // Event type of a chat message in an event stream.
+  const char kChatMessageEventType[] = "chat_message";
+  // Header of the last event a resuming event stream client received.
+  const utility::char_t kLastEventIdHeader[] = UU("Last-Event-ID");
+  // Maximum size of a chat message request body.
+  const size_t kMaxChatMessageBodySize = 64 * 1024;
+  // Maximum size of a chat message batch request body.
+  const size_t kMaxChatMessageBatchBodySize = 1024 * 1024;
+  // Size of a chunk read from a chat message request body.
+  const size_t kBodyReadSize = 4096;
+  // Content types of a chat message request body.
+  const utility::char_t kJsonContentType[] = UU("application/json");
+  const utility::char_t kTextContentType[] = UU("text/plain");
+
+  namespace {
+
+    value ChatMessageToJson(const ChatMessage& chat_message) {
+      value json_chat_message = value::object();
+      json_chat_message[UU("date")] =
+          value::number(static_cast<int64_t>(chat_message.date));
+      json_chat_message[UU("user_id")] = value::string(chat_message.user_id);
+      json_chat_message[UU("chat_room")] =
+          value::string(chat_message.chat_room);
+      json_chat_message[UU("chat_message")] =
+          value::string(chat_message.chat_message);
+      return json_chat_message;
+    }
+
+    // JSON of the chat messages read from cursor on.
+    value ChatMessagesToJson(size_t cursor,
+                             const vector<ChatMessage>& chat_messages) {
+      value json_chat_messages = value::array(chat_messages.size());
+      for (size_t i = 0; i < chat_messages.size(); ++i) {
+        json_chat_messages[i] = ChatMessageToJson(chat_messages[i]);
+      }
+      value response = value::object();
+      response[UU("cursor")] = value::number(static_cast<uint64_t>(cursor));
+      response[UU("chat_messages")] = json_chat_messages;
+      return response;
+    }
+
+    // Serialize a message once for every subscriber of its room. The push
+    // message is the message JSON with the type and the cursor in front of
+    // its fields.
+    RoomBroadcaster::Payload SerializeChatMessage(
+        const ChatMessage& chat_message, uint64_t sequence) {
+      RoomBroadcaster::Payload payload;
+      string json_chat_message =
+          to_utf8string(ChatMessageToJson(chat_message).serialize());
+      payload.push_message = make_shared<const string>(
+          "{\"type\":\"chat_message\",\"cursor\":" + to_string(sequence) +
+          "," + json_chat_message.substr(1));
+      payload.chat_message =
+          make_shared<const string>(move(json_chat_message));
+      return payload;
+    }
+
+    // Reply a JSON body serialized beforehand. The body is read from the
+    // shared buffer, which the reply keeps until it is sent.
+    void ReplyJson(const http_request& message,
+                   const shared_ptr<const string>& body) {
+      http_response response(status_codes::OK);
+      response.set_body(
+          concurrency::streams::rawptr_stream<uint8_t>::open_istream(
+              reinterpret_cast<const uint8_t*>(body->data()), body->size()),
+          body->size(), UU("application/json"));
+      message.reply(response).then([body](task<void> reply_task) {
+        try {
+          reply_task.get();
+        } catch (const exception&) {
+        }
+      });
+    }
+
+    // Read the chat messages of the chat room from since on and serialize
+    // the reply.
+    RequestCoalescer::Response ReadChatMessages(ChatDatabase* chat_database,
+                                                const string_t& chat_room,
+                                                size_t since) {
+      RequestCoalescer::Response response;
+      vector<ChatMessage> chat_messages;
+      response.is_found = chat_database->GetChatMessages(
+          chat_room, since, &chat_messages, &response.cursor);
+      response.has_messages = !chat_messages.empty();
+      if (response.is_found) {
+        response.body = make_shared<const string>(to_utf8string(
+            ChatMessagesToJson(response.cursor, chat_messages).serialize()));
+      }
+      return response;
+    }
+
+    // Reply the chat messages of the chat room from since on.
+    void ReplyChatMessages(const http_request& message,
+                           ChatDatabase* chat_database,
+                           const string_t& chat_room, size_t since) {
+      vector<ChatMessage> chat_messages;
+      size_t cursor;
+      if (!chat_database->GetChatMessages(chat_room, since, &chat_messages,
+                                          &cursor)) {
+        message.reply(status_codes::BadRequest, UU("Not exist chat room"));
+        return;
+      }
+      message.reply(status_codes::OK,
+                    ChatMessagesToJson(cursor, chat_messages));
+    }
+
+    // Parse a decimal event ID.
+    bool ParseEventId(const string_t& text, uint64_t* out_event_id) {
+      if (text.empty() || text.size() > 18) {
+        return false;
+      }
+      uint64_t event_id = 0;
+      for (const auto character : text) {
+        if (character < '0' || character > '9') {
+          return false;
+        }
+        event_id = event_id * 10 + (character - '0');
+      }
+      *out_event_id = event_id;
+      return true;
+    }
+
+    // Whether the content type is the media type, with or without
+    // parameters such as charset.
+    bool IsContentType(const string_t& content_type,
+                       const utility::char_t* media_type) {
+      const string_t::size_type media_type_size =
+          string_t(media_type).size();
+      return content_type.compare(0, media_type_size, media_type) == 0 &&
+             (content_type.size() == media_type_size ||
+              content_type[media_type_size] == UU(';'));
+    }
+
+    // Chat messages decoded from a request body while it is read.
+    struct BodyDecoding {
+      typedef function<void(ChatMessageDecoder::Status,
+                            BodyDecoding* decoding)> Callback;
+
+      // Decode one chat message into chat_message.
+      BodyDecoding(const http_request& message,
+                   ChatMessageDecoder::BodyFormat body_format,
+                   ChatMessage chat_message, Callback on_decoded)
+          : body(message.body().streambuf()),
+            chat_message(move(chat_message)),
+            decoder(body_format, kMaxChatMessageBodySize,
+                    &this->chat_message),
+            on_decoded(move(on_decoded)) {
+      }
+
+      // Decode a JSON array of chat messages into chat_messages.
+      BodyDecoding(const http_request& message,
+                   const ChatMessage& message_template, Callback on_decoded)
+          : body(message.body().streambuf()),
+            decoder(kMaxChatMessageBatchBodySize, message_template,
+                    &chat_messages),
+            on_decoded(move(on_decoded)) {
+      }
+
+      concurrency::streams::streambuf<uint8_t> body;
+      ChatMessage chat_message;
+      vector<ChatMessage> chat_messages;
+      ChatMessageDecoder decoder;
+      Callback on_decoded;
+      uint8_t buffer[kBodyReadSize];
+    };
+
+    // Read and decode the body chunk by chunk, then call on_decoded.
+    void ReadBodyChunk(const shared_ptr<BodyDecoding>& decoding) {
+      decoding->body.getn(decoding->buffer, kBodyReadSize)
+          .then([decoding](task<size_t> read_task) {
+            size_t read_size = 0;
+            try {
+              read_size = read_task.get();
+            } catch (const exception& e) {
+              warn("Can't read chat message body: {}", e.what());
+              decoding->on_decoded(ChatMessageDecoder::kMalformed,
+                                   decoding.get());
+              return;
+            }
+            const ChatMessageDecoder::Status status =
+                read_size == 0
+                    ? decoding->decoder.Finish()
+                    : decoding->decoder.Decode(decoding->buffer, read_size);
+            if (status != ChatMessageDecoder::kDecoding) {
+              decoding->on_decoded(status, decoding.get());
+              return;
+            }
+            ReadBodyChunk(decoding);
+          });
+    }
+
+    // Store the chat message and reply the result. The chat message is moved
+    // into the database.
+    void ReplyStoreChatMessage(const http_request& message,
+                               ChatDatabase* chat_database,
+                               ChatMessage&& chat_message) {
+      if (!chat_database->StoreChatMessage(move(chat_message))) {
+        message.reply(status_codes::BadRequest,
+                      UU("Chat message store error"));
+        return;
+      }
+      message.reply(status_codes::OK);
+    }
+
+  } // namespace
+
+  // Bit of a parameter in Endpoint::required_parameters.
+  constexpr uint32_t ParameterBit(int parameter) {
+    return uint32_t(1) << parameter;
+  }
+
+  // Slots of the endpoint hash table. Its size is a power of two.
+  const size_t kEndpointSlotCount = 16;
+
+  // Endpoint hash of a method and a path. The table is checked at compile
+  // time to have no collision, so finding an endpoint is one hash and one
+  // string comparison however many endpoints there are.
+  constexpr size_t EndpointHash(int method, size_t path_size,
+                                char first_character, char last_character) {
+    return (size_t(method) + path_size +
+            static_cast<unsigned char>(first_character) +
+            static_cast<unsigned char>(last_character) * 7) &
+           (kEndpointSlotCount - 1);
+  }
+
+  constexpr size_t PathSize(const char* path) {
+    size_t size = 0;
+    while (path[size] != '\0') {
+      ++size;
+    }
+    return size;
+  }
+
+  // REST API endpoints of ChatServer. An endpoint is added by a line here;
+  // DispatchRequest checks its rate limits, session and that its required
+  // parameters are present. Values are not typed here.
+  struct EndpointTable {
+    static constexpr ChatServer::Endpoint kEndpoints[] = {
+        // make account: http://server_url/account?id=[]&password=[]
+        {ChatServer::kPost, "account",
+         ParameterBit(RequestQuery::kId) |
+             ParameterBit(RequestQuery::kPassword),
+         UU("Account information absence"), false, true,
+         &ChatServer::ProcessPostSignUpRequest},
+        // login: http://server_url/login?id=[]&password=[]&nonce=[]
+        {ChatServer::kPost, "login",
+         ParameterBit(RequestQuery::kId) |
+             ParameterBit(RequestQuery::kPassword) |
+             ParameterBit(RequestQuery::kNonce),
+         UU("Login information absence"), false, true,
+         &ChatServer::ProcessPostLoginRequest},
+        // get chat message list:
+        // http://server_url/chatmessage?chat_room=[]&session_id=[]
+        // &since=[]&wait=[]
+        {ChatServer::kGet, "chatmessage",
+         ParameterBit(RequestQuery::kChatRoom),
+         UU("Chat room absence"), true, false,
+         &ChatServer::ProcessGetChatMessageRequest},
+        // stream chat messages:
+        // http://server_url/chatmessage/stream?chat_room=[]&session_id=[]
+        // &since=[]
+        {ChatServer::kGet, "chatmessage/stream",
+         ParameterBit(RequestQuery::kChatRoom),
+         UU("Chat room absence"), true, false,
+         &ChatServer::ProcessGetChatMessageStreamRequest},
+        // make chat message:
+        // http://server_url/chatmessage?chat_message=[]&chat_room=[]
+        // &session_id=[]
+        // or with a JSON or text body. The handler checks the parameters.
+        {ChatServer::kPost, "chatmessage", 0,
+         UU("Chat message absence"), true, false,
+         &ChatServer::ProcessPostInputChatMessageRequest},
+        // make chat messages of any chat rooms at once:
+        // http://server_url/chatmessage/batch?session_id=[]&chat_room=[]
+        // with a JSON array body. The handler checks the parameters.
+        {ChatServer::kPost, "chatmessage/batch", 0,
+         UU("Chat message absence"), true, false,
+         &ChatServer::ProcessPostChatMessageBatchRequest},
+        // logout: http://server_url/session?session_id=[]
+        // logout everywhere: http://server_url/session?session_id=[]&all=true
+        {ChatServer::kDelete, "session",
+         ParameterBit(RequestQuery::kSessionId),
+         UU("Not exist session"), true, false,
+         &ChatServer::ProcessDeleteLogoutRequest},
+    };
+
+    static constexpr size_t kEndpointCount =
+        sizeof(kEndpoints) / sizeof(kEndpoints[0]);
+
+    // Index + 1 of the endpoint in each hash slot, 0 if the slot is empty.
+    struct SlotIndex {
+      uint8_t slots[kEndpointSlotCount];
+    };
+
+    static constexpr size_t Hash(const ChatServer::Endpoint& endpoint) {
+      return EndpointHash(
+          endpoint.method, PathSize(endpoint.path), endpoint.path[0],
+          endpoint.path[PathSize(endpoint.path) - 1]);
+    }
+
+    static constexpr SlotIndex BuildSlotIndex() {
+      SlotIndex slot_index{};
+      for (size_t i = 0; i < kEndpointCount; ++i) {
+        slot_index.slots[Hash(kEndpoints[i])] = static_cast<uint8_t>(i + 1);
+      }
+      return slot_index;
+    }
+
+    static constexpr bool HasNoCollision() {
+      const SlotIndex slot_index = BuildSlotIndex();
+      for (size_t i = 0; i < kEndpointCount; ++i) {
+        if (slot_index.slots[Hash(kEndpoints[i])] != i + 1) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // Built from kEndpoints at compile time.
+    static const SlotIndex kSlotIndex;
+
+    // Endpoint of the method and the path, or nullptr.
+    static const ChatServer::Endpoint* Find(ChatServer::HttpMethod method,
+                                            const RequestQuery::Span& path) {
+      if (path.empty()) {
+        return nullptr;
+      }
+      const size_t index = kSlotIndex.slots[EndpointHash(
+          method, path.size, path.data[0], path.data[path.size - 1])];
+      if (index == 0) {
+        return nullptr;
+      }
+      const ChatServer::Endpoint& endpoint = kEndpoints[index - 1];
+      if (endpoint.method != method || path != endpoint.path) {
+        return nullptr;
+      }
+      return &endpoint;
+    }
+  };
+
+  constexpr ChatServer::Endpoint EndpointTable::kEndpoints[];
+  const EndpointTable::SlotIndex EndpointTable::kSlotIndex =
+      EndpointTable::BuildSlotIndex();
+
+  static_assert(EndpointTable::HasNoCollision(),
+                "Endpoint hash collision: change EndpointHash or "
+                "kEndpointSlotCount");
+
   ChatServer::ChatServer(ChatDatabase* chat_database, 
                          AccountDatabase* account_database, 
                          SessionManager* session_manager)
                          : chat_database_(chat_database),
                            account_database_(account_database),
-                           session_manager_(session_manager) {
+                           session_manager_(session_manager),
+                           address_rate_limiter_(kAddressRateBurst,
+                                                 kAddressRatePerSecond),
+                           id_rate_limiter_(kIDRateBurst, kIDRatePerSecond),
+                           subscriber_queue_capacity_(
+                               kDefaultSubscriberQueueCapacity),
+                           subscriber_queue_policy_(SubscriberQueue::kResync),
+                           logged_subscriber_queue_metrics_(),
+                           pending_store_count_(0),
+                           stop_heartbeat_thread_(false),
+                           long_poll_registry_(kMaxLongPollWaiters),
+                           room_broadcaster_(SerializeChatMessage) {
+    hash_worker_pool_ = make_unique<HashWorkerPool>(kHashWorkerThreadCount,
+                                                    kHashWorkerQueueDepth);
+  }
+
+  ChatServer::~ChatServer() {
+    StopHeartbeatThread();
+    WaitForChatMessageStores();
+    if (chat_database_ != nullptr) {
+      chat_database_->SetChatMessageListener(nullptr);
+    }
+    CloseEventStreams();
   }
 
   bool ChatServer::Initialize(string_t server_url) {
@@ -40,6 +444,19 @@ namespace chatserver {
       return false;
     }
     session_manager_->RunSessionExpireThread();
+    RunHeartbeatThread();
+
+    // A stored message is only queued here. The broadcaster completes the
+    // long-poll requests and pushes it to the subscribers of its room.
+    room_broadcaster_.SetListener(
+        [this](const RoomBroadcaster::Broadcast& broadcast) {
+          NotifyLongPollRequests(broadcast);
+        },
+        [this](const string_t&) { return long_poll_registry_.size() != 0; });
+    chat_database_->SetChatMessageListener(
+        [this](const ChatMessage& chat_message, size_t message_count) {
+          room_broadcaster_.Publish(chat_message, message_count);
+        });
 
     // HTTP request listener from cpprestsdk.
     listener_ = http_listener(server_url);  
@@ -61,103 +478,225 @@ namespace chatserver {
   }
 
   task<void> ChatServer::CloseServer() {
+    StopHeartbeatThread();
+    websocket_server_.Close();
+    // A store task uses the chat database, which may be destroyed after the
+    // server closes.
+    WaitForChatMessageStores();
+    CloseEventStreams();
     return listener_.close();
   }
 
-  void ChatServer::HandleGet(const http_request& message) {
-    // Path of HTTP request URL.
-    // path[n] means the name of the nth path in HTTP request URL.
-    vector<string_t> url_paths = uri::split_path(
-        uri::decode(message.relative_uri().path()));
-    
-    // Query string of HTTP request URL.
-    // Format: map<string_t, string_t> = <query name, query value>
-    map<string_t, string_t> url_queries = uri::split_query(
-        uri::decode(message.relative_uri().query()));
-
-    if (url_paths.empty()) {
-      message.reply(status_codes::NotFound);
-      return;
-    }
+  bool ChatServer::OpenWebSocketServer(uint16_t port) {
+    websocket_server_.SetOpenHandler(
+        [this](uint64_t connection_id, const string& path,
+               const string& query) {
+          return ProcessWebSocketOpen(connection_id, path, query);
+        });
+    websocket_server_.SetMessageHandler(
+        [this](uint64_t connection_id, const string& text) {
+          ProcessWebSocketMessage(connection_id, text);
+        });
+    websocket_server_.SetCloseHandler([this](uint64_t connection_id) {
+      ProcessWebSocketClose(connection_id);
+    });
+    websocket_server_.SetWritableHandler([this](uint64_t connection_id) {
+      ProcessWebSocketWritable(connection_id);
+    });
+    return websocket_server_.Open(port);
+  }
 
-    if (!IsValidSession(url_queries)) {
-      message.reply(status_codes::Forbidden,
-                    UU("Not a valid session ID"));
-      return;
-    }
+  void ChatServer::SetSubscriberQueuePolicy(
+      size_t capacity, SubscriberQueue::OverflowPolicy overflow_policy) {
+    lock_guard<mutex> lock(mutex_websocket_clients_);
+    subscriber_queue_capacity_ = capacity;
+    subscriber_queue_policy_ = overflow_policy;
+  }
 
-    // ToDo: Add get chat message and get chat room list API service.
+  SubscriberQueue::Metrics ChatServer::GetSubscriberQueueMetrics() const {
+    return subscriber_queue_counters_.Load();
+  }
 
-    // No matching HTTP request.
-    warn("No matching HTTP request");
-    message.reply(status_codes::NotFound);
+  uint64_t ChatServer::GetCoalescedRequestCount() const {
+    return request_coalescer_.coalesced_count();
   }
 
-  void ChatServer::ProcessGetChatMessageRequest(
-      const http_request& message,
-      const map<string_t, string_t>& url_queries) {
-    const auto chat_room_it = url_queries.find(UU("chat_room"));
-    // ToDo: Implement chat message request. The Http response must have chat
-    // ToDO: messages of the given chat room.
+  HashWorkerPool::Metrics ChatServer::GetHashWorkerMetrics() const {
+    return hash_worker_pool_->GetMetrics();
   }
 
-  void ChatServer::ProcessGetChatRoomRequest(const http_request& message) {
-    // ToDo: Implement get chat room API. The Http response must have chat
-    // ToDO: room list.
+  void ChatServer::HandleGet(const http_request& message) {
+    DispatchRequest(kGet, message);
   }
 
-  void ChatServer::HandlePost(const http_request& message) {
-    // Path of HTTP request URL.
-    // path[n] means the name of the nth path in HTTP request URL.
-    vector<string_t> url_paths = uri::split_path(
-        uri::decode(message.relative_uri().path()));
+  void ChatServer::ProcessGetChatMessageRequest(
+      const http_request& message,
+      const RequestQuery& request_query) {
+    const string_t chat_room = request_query.GetString(RequestQuery::kChatRoom);
+    uint64_t since = 0;
+    uint64_t wait_seconds = 0;
+    if ((request_query.Has(RequestQuery::kSince) &&
+         !request_query.GetNumber(RequestQuery::kSince, &since)) ||
+        (request_query.Has(RequestQuery::kWait) &&
+         !request_query.GetNumber(RequestQuery::kWait, &wait_seconds))) {
+      message.reply(status_codes::BadRequest, UU("Wrong since or wait"));
+      return;
+    }
 
-    // Query string of HTTP request URL.
-    // Format: map<string_t, string_t> = <query name, query value>
-    map<string_t, string_t> url_queries = uri::split_query(
-        uri::decode(message.relative_uri().query()));
+    // Identical requests arriving together are read and serialized once.
+    ChatDatabase* chat_database = chat_database_;
+    request_coalescer_.Run(
+        chat_room, static_cast<size_t>(since),
+        [chat_database, &chat_room, since] {
+          return ReadChatMessages(chat_database, chat_room,
+                                  static_cast<size_t>(since));
+        },
+        [this, message, chat_room, since,
+         wait_seconds](const RequestCoalescer::Response& response) {
+          if (response.is_failed) {
+            message.reply(status_codes::InternalError,
+                          UU("Chat message read error"));
+            return;
+          }
+          if (!response.is_found) {
+            message.reply(status_codes::BadRequest,
+                          UU("Not exist chat room"));
+            return;
+          }
+          if (response.has_messages || wait_seconds == 0) {
+            ReplyJson(message, response.body);
+            return;
+          }
+          ParkChatMessageRequest(message, chat_room,
+                                 min(static_cast<size_t>(since),
+                                     response.cursor),
+                                 wait_seconds);
+        });
+  }
 
-    if (url_paths.empty()) {
-      message.reply(status_codes::NotFound);
+  void ChatServer::ParkChatMessageRequest(const http_request& message,
+                                          const string_t& chat_room,
+                                          size_t wait_cursor,
+                                          uint64_t wait_seconds) {
+    // Nothing new: park the request instead of blocking this thread. It is
+    // replied on the next stored message of the room or after the wait.
+    const chrono::seconds wait_time =
+        min(chrono::seconds(wait_seconds), kMaxLongPollWait);
+    ChatDatabase* chat_database = chat_database_;
+    if (!long_poll_registry_.Park(
+            chat_room, wait_cursor, wait_time,
+            [message, chat_database, chat_room,
+             wait_cursor](const LongPollRegistry::Reply& reply) {
+              if (reply != nullptr) {
+                ReplyJson(message, reply);
+                return;
+              }
+              ReplyChatMessages(message, chat_database, chat_room,
+                                wait_cursor);
+            })) {
+      warn("Long-poll rejected, too many waiting requests");
+      message.reply(status_codes::ServiceUnavailable,
+                    UU("Too many waiting requests"));
+    }
+  }
+
+  void ChatServer::ProcessGetChatMessageStreamRequest(
+      const http_request& message,
+      const RequestQuery& request_query) {
+    const string_t chat_room = request_query.GetString(RequestQuery::kChatRoom);
+    vector<ChatMessage> chat_messages;
+    size_t cursor;
+    if (!chat_database_->GetChatMessages(chat_room, SIZE_MAX, &chat_messages,
+                                         &cursor)) {
+      message.reply(status_codes::BadRequest, UU("Not exist chat room"));
       return;
     }
 
-    // Signup API is implemented as a sample.
-    // API service without session ID.
-    const string_t first_request_url_path = url_paths[0];
-    if (first_request_url_path == UU("account")) {
-      ProcessPostSignUpRequest(message, url_queries);
+    // Resume after the last event the client received.
+    uint64_t last_event_id = cursor;
+    const auto last_event_id_it = message.headers().find(kLastEventIdHeader);
+    if (last_event_id_it != message.headers().end()) {
+      if (!ParseEventId(last_event_id_it->second, &last_event_id)) {
+        message.reply(status_codes::BadRequest, UU("Wrong Last-Event-ID"));
+        return;
+      }
+    } else if (request_query.Has(RequestQuery::kSince) &&
+               !request_query.GetNumber(RequestQuery::kSince,
+                                        &last_event_id)) {
+      message.reply(status_codes::BadRequest, UU("Wrong since"));
       return;
     }
+    last_event_id = min(last_event_id, static_cast<uint64_t>(cursor));
 
-    // ToDo: Add login API service.
+    const auto event_stream = make_shared<EventStream>(last_event_id);
+    http_response response(status_codes::OK);
+    response.headers().add(UU("Cache-Control"), UU("no-cache"));
+    response.set_body(event_stream->CreateInputStream(),
+                      UU("text/event-stream"));
+    // The reply ends when the stream is closed or the client goes away.
+    message.reply(response).then([event_stream](task<void> reply_task) {
+      try {
+        reply_task.get();
+      } catch (const exception&) {
+      }
+      event_stream->Close();
+    });
 
-    if (!IsValidSession(url_queries)) {
-      message.reply(status_codes::Forbidden,
-                    UU("Not a valid session ID"));
-      return;
+    {
+      lock_guard<mutex> lock(mutex_event_streams_);
+      event_streams_.erase(
+          remove_if(event_streams_.begin(), event_streams_.end(),
+                    [](const EventStreamClient& client) {
+                      return client.event_stream.expired();
+                    }),
+          event_streams_.end());
+      event_streams_.push_back(EventStreamClient{
+          event_stream, request_query.GetString(RequestQuery::kSessionId)});
     }
+    // Subscribed before the backlog is written, so a message stored in
+    // between is written by either of them. The subscription does not keep
+    // the stream: once the reply ends it is unsubscribed on the next message.
+    // The stream sends no request: the open stream is its activity. Logout
+    // ends the stream.
+    const weak_ptr<EventStream> weak_event_stream = event_stream;
+    const string_t session_id =
+        request_query.GetString(RequestQuery::kSessionId);
+    room_broadcaster_.Subscribe(
+        chat_room,
+        [this, weak_event_stream, session_id](
+            const RoomBroadcaster::Broadcast& broadcast) {
+          const shared_ptr<EventStream> open_event_stream =
+              weak_event_stream.lock();
+          if (open_event_stream == nullptr ||
+              open_event_stream->is_closed()) {
+            return false;
+          }
+          if (!session_manager_->RenewLastActivityTime(session_id)) {
+            open_event_stream->Close();
+            return false;
+          }
+          return PushEventStream(broadcast, open_event_stream.get());
+        });
+    CatchUpEventStream(chat_room, event_stream.get());
+  }
 
-    // ToDo: Add chat message input and chat room create API service.
+  void ChatServer::ProcessGetChatRoomRequest(
+      const http_request& message,
+      const RequestQuery& request_query) {
+    // ToDo: Implement get chat room API. The Http response must have chat
+    // ToDO: room list.
+  }
 
-    // No matching HTTP request.
-    warn("No matching HTTP request");
-    message.reply(status_codes::NotFound);
+  void ChatServer::HandlePost(const http_request& message) {
+    DispatchRequest(kPost, message);
   }
 
   void ChatServer::ProcessPostSignUpRequest(
       const http_request& message,
-      const map<string_t, string_t>& url_queries) {
-    const auto id_it = url_queries.find(UU("id"));
-    const auto password_it = url_queries.find(UU("password"));
-    if (id_it == url_queries.end() ||
-      password_it == url_queries.end()) {
-      message.reply(status_codes::BadRequest,
-          UU("Account information absence"));
-      return;
-    }
-    const string_t id = id_it->second;
-    const string_t password = password_it->second;
+      const RequestQuery& request_query) {
+    const string_t id = request_query.GetString(RequestQuery::kId);
+    const string_t password =
+        request_query.GetString(RequestQuery::kPassword);
 
     const int signup_result = 
         account_database_->SignUp(id, password);
@@ -185,69 +724,725 @@ namespace chatserver {
 
   void ChatServer::ProcessPostLoginRequest(
       const http_request& message, 
-      const map<string_t, string_t>& url_queries) {
-    const auto id_it = url_queries.find(UU("id"));
-    const auto password_it = url_queries.find(UU("password"));
-    const auto nonce_it = url_queries.find(UU("nonce"));
-    // ToDo: Implement login API.
+      const RequestQuery& request_query) {
+    const string_t id = request_query.GetString(RequestQuery::kId);
+    const string_t password =
+        request_query.GetString(RequestQuery::kPassword);
+    const string_t nonce = request_query.GetString(RequestQuery::kNonce);
+
+    // Hashing can be expensive, so it runs on the hashing workers and this
+    // listener thread returns immediately.
+    AccountDatabase* account_database = account_database_;
+    task<AccountDatabase::AuthResult> login_task;
+    if (!hash_worker_pool_->Run<AccountDatabase::AuthResult>(
+            [account_database, id, password, nonce] {
+              return account_database->Login(id, password, nonce);
+            },
+            &login_task)) {
+      warn("Login rejected, hashing queue is full");
+      message.reply(status_codes::ServiceUnavailable,
+                    UU("Login service is busy"));
+      return;
+    }
+
+    SessionManager* session_manager = session_manager_;
+    login_task.then([message, session_manager, id](
+        task<AccountDatabase::AuthResult> result_task) {
+      AccountDatabase::AuthResult login_result;
+      try {
+        login_result = result_task.get();
+      } catch (const exception& e) {
+        error("Login failed: {}", e.what());
+        message.reply(status_codes::InternalError, UU("Login error"));
+        return;
+      }
+      if (login_result == AccountDatabase::kAuthSuccess) {
+        const Session session = session_manager->CreateSession(id);
+        value response = value::object();
+        response[UU("session_id")] = value::string(session.session_id);
+        message.reply(status_codes::OK, response);
+      } else if (login_result == AccountDatabase::kIDNotExist) {
+        message.reply(status_codes::BadRequest, UU("Not exist ID"));
+      } else if (login_result == AccountDatabase::kNonceReplayed) {
+        message.reply(status_codes::BadRequest, UU("Reused nonce"));
+      } else if (login_result == AccountDatabase::kLoginBusy) {
+        message.reply(status_codes::ServiceUnavailable,
+                      UU("Login service is busy"));
+      } else {
+        message.reply(status_codes::BadRequest, UU("Wrong password"));
+      }
+    });
   }
 
   void ChatServer::ProcessPostInputChatMessageRequest(
       const http_request& message, 
-      const map<string_t, string_t>& url_queries) {
-    const auto chat_message_it = url_queries.find(UU("chat_message"));
-    const auto chat_room_it = url_queries.find(UU("chat_room"));
-    // ToDo: Implement API to save chat message into the server.
+      const RequestQuery& request_query) {
+    string_t user_id;
+    if (!session_manager_->GetUserIDFromSessionId(
+            request_query.GetString(RequestQuery::kSessionId), &user_id)) {
+      message.reply(status_codes::Forbidden, UU("Not a valid session ID"));
+      return;
+    }
+
+    ChatMessage chat_message;
+    chat_message.date = CoarseClock::GetInstance().Now();
+    chat_message.user_id = move(user_id);
+    chat_message.chat_room = request_query.GetString(RequestQuery::kChatRoom);
+    if (request_query.Has(RequestQuery::kChatMessage)) {
+      // Query form, kept for compatibility.
+      if (chat_message.chat_room.empty()) {
+        message.reply(status_codes::BadRequest, UU("Chat message absence"));
+        return;
+      }
+      chat_message.chat_message =
+          request_query.GetString(RequestQuery::kChatMessage);
+      ReplyStoreChatMessage(message, chat_database_, move(chat_message));
+      return;
+    }
+
+    // Body form. The body is decoded while it arrives, straight into the
+    // chat message, and never buffered as a whole.
+    ChatMessageDecoder::BodyFormat body_format;
+    const string_t content_type = message.headers().content_type();
+    if (IsContentType(content_type, kJsonContentType)) {
+      body_format = ChatMessageDecoder::kJsonBody;
+    } else if (IsContentType(content_type, kTextContentType) &&
+               !chat_message.chat_room.empty()) {
+      body_format = ChatMessageDecoder::kRawBody;
+    } else {
+      message.reply(status_codes::BadRequest, UU("Chat message absence"));
+      return;
+    }
+    if (message.headers().content_length() > kMaxChatMessageBodySize) {
+      message.reply(status_codes::RequestEntityTooLarge,
+                    UU("Chat message too large"));
+      return;
+    }
+
+    ChatDatabase* chat_database = chat_database_;
+    ReadBodyChunk(make_shared<BodyDecoding>(
+        message, body_format, move(chat_message),
+        [message, chat_database](ChatMessageDecoder::Status status,
+                                 BodyDecoding* decoding) {
+          if (status == ChatMessageDecoder::kTooLarge) {
+            message.reply(status_codes::RequestEntityTooLarge,
+                          UU("Chat message too large"));
+          } else if (status != ChatMessageDecoder::kDecoded ||
+                     decoding->chat_message.chat_room.empty()) {
+            message.reply(status_codes::BadRequest,
+                          UU("Malformed chat message body"));
+          } else {
+            ReplyStoreChatMessage(message, chat_database,
+                                  move(decoding->chat_message));
+          }
+        }));
+  }
+
+  void ChatServer::ProcessPostChatMessageBatchRequest(
+      const http_request& message,
+      const RequestQuery& request_query) {
+    string_t user_id;
+    if (!session_manager_->GetUserIDFromSessionId(
+            request_query.GetString(RequestQuery::kSessionId), &user_id)) {
+      message.reply(status_codes::Forbidden, UU("Not a valid session ID"));
+      return;
+    }
+    if (!IsContentType(message.headers().content_type(), kJsonContentType)) {
+      message.reply(status_codes::BadRequest, UU("Chat message absence"));
+      return;
+    }
+    if (message.headers().content_length() > kMaxChatMessageBatchBodySize) {
+      message.reply(status_codes::RequestEntityTooLarge,
+                    UU("Chat message batch too large"));
+      return;
+    }
+
+    // Every message of the batch shares the date and the user, and the
+    // chat room of the query unless the message names one.
+    ChatMessage message_template;
+    message_template.date = CoarseClock::GetInstance().Now();
+    message_template.user_id = move(user_id);
+    message_template.chat_room =
+        request_query.GetString(RequestQuery::kChatRoom);
+    ChatDatabase* chat_database = chat_database_;
+    ReadBodyChunk(make_shared<BodyDecoding>(
+        message, message_template,
+        [message, chat_database](ChatMessageDecoder::Status status,
+                                 BodyDecoding* decoding) {
+          if (status == ChatMessageDecoder::kTooLarge) {
+            message.reply(status_codes::RequestEntityTooLarge,
+                          UU("Chat message batch too large"));
+          } else if (status != ChatMessageDecoder::kDecoded ||
+                     decoding->chat_messages.empty()) {
+            message.reply(status_codes::BadRequest,
+                          UU("Malformed chat message batch"));
+          } else if (!chat_database->StoreChatMessages(
+                         decoding->chat_messages)) {
+            message.reply(status_codes::BadRequest,
+                          UU("Chat message store error"));
+          } else {
+            message.reply(status_codes::OK);
+          }
+        }));
   }
 
   void ChatServer::ProcessCreateChatRoomRequest(
       const http_request& message,
-      const map<string_t, string_t>& url_queries) {
-    const auto chat_room_it = url_queries.find(UU("chat_room"));
+      const RequestQuery& request_query) {
+    const RequestQuery::Span chat_room =
+        request_query.Get(RequestQuery::kChatRoom);
     // ToDo: Implement API to create the given chat room.
   }
 
   void ChatServer::HandleDelete(const http_request& message) {
-    // Path of HTTP request URL.
-    // path[n] means the name of the nth path in HTTP request URL.
-    vector<string_t> url_paths = uri::split_path(
-        uri::decode(message.relative_uri().path()));
+    DispatchRequest(kDelete, message);
+  }
+
+  void ChatServer::ProcessDeleteLogoutRequest(
+      const http_request& message, 
+      const RequestQuery& request_query) {
+    const string_t session_id =
+        request_query.GetString(RequestQuery::kSessionId);
+
+    // Logout everywhere: delete every session of the user. Signed tokens
+    // are revoked without being counted, so no deleted session is not an
+    // error then.
+    if (request_query.Get(RequestQuery::kAll) == "true") {
+      string_t user_id;
+      if (!session_manager_->GetUserIDFromSessionId(session_id, &user_id) ||
+          (session_manager_->DeleteUserSessions(user_id) == 0 &&
+           session_manager_->session_mode() !=
+               SessionManager::kSignedToken)) {
+        message.reply(status_codes::BadRequest, UU("Not exist session"));
+        return;
+      }
+      message.reply(status_codes::OK);
+      return;
+    }
+
+    if (!session_manager_->DeleteSession(session_id)) {
+      message.reply(status_codes::BadRequest, UU("Not exist session"));
+      return;
+    }
+    message.reply(status_codes::OK);
+  }
+
+  void ChatServer::HandlePut(const http_request& message) {
+    DispatchRequest(kPut, message);
+  }
 
-    // Query string of HTTP request URL.
-    // Format: map<string_t, string_t> = <query name, query value>
-    map<string_t, string_t> url_queries = uri::split_query(
-        uri::decode(message.relative_uri().query()));
+  void ChatServer::DispatchRequest(HttpMethod method,
+                                   const http_request& message) {
+    // First path name and known query parameters of HTTP request URL.
+    RequestQuery request_query;
+    if (!ParseRequestQuery(message, &request_query)) {
+      return;
+    }
+
+    const Endpoint* endpoint =
+        EndpointTable::Find(method, request_query.path());
+    if (endpoint == nullptr) {
+      // No matching HTTP request.
+      warn("No matching HTTP request");
+      message.reply(status_codes::NotFound);
+      return;
+    }
+
+    if (endpoint->rate_limited &&
+        !IsAllowedAuthRequest(message, request_query)) {
+      message.reply(kTooManyRequests, UU("Too many requests"));
+      return;
+    }
 
-    if (!IsValidSession(url_queries)) {
+    if (endpoint->session_required && !IsValidSession(request_query)) {
       message.reply(status_codes::Forbidden,
                     UU("Not a valid session ID"));
       return;
     }
-    // ToDo: Add logout API service.
 
-    // No matching HTTP request.
-    warn("No matching HTTP request");
-    message.reply(status_codes::NotFound);
-  }
+    for (int parameter = 0; parameter < RequestQuery::kParameterCount;
+         ++parameter) {
+      if ((endpoint->required_parameters & ParameterBit(parameter)) != 0 &&
+          !request_query.Has(static_cast<RequestQuery::Parameter>(parameter))) {
+        message.reply(status_codes::BadRequest,
+                      endpoint->missing_parameter_reply);
+        return;
+      }
+    }
 
-  void ChatServer::ProcessDeleteLogoutRequest(
-      const http_request& message, 
-      const map<string_t, string_t>& url_queries) {
-    const auto session_id_it = url_queries.find(UU("session_id"));
-    // ToDo: Implement logout API.
+    (this->*endpoint->handler)(message, request_query);
   }
 
-  void ChatServer::HandlePut(const http_request& message) {
-    // No matching HTTP request.
-    warn("No matching HTTP request");
-    message.reply(status_codes::NotFound);
+  bool ChatServer::IsAllowedAuthRequest(
+      const http_request& message,
+      const RequestQuery& request_query) {
+    // Checked before any account lookup or hashing, so a credential stuffing
+    // burst costs only a few atomic operations.
+    if (!address_rate_limiter_.TryAcquire(message.remote_address())) {
+      return false;
+    }
+    if (request_query.Has(RequestQuery::kId) &&
+        !id_rate_limiter_.TryAcquire(
+            request_query.GetString(RequestQuery::kId))) {
+      return false;
+    }
+    return true;
   }
 
   bool ChatServer::IsValidSession(
-      const map<string_t, string_t>& url_queries) {
-    const auto session_id_it = url_queries.find(UU("session_id"));
-    // ToDo: Implement to check the given session Id is valid.
-    return false;
+      const RequestQuery& request_query) {
+    if (!request_query.Has(RequestQuery::kSessionId)) {
+      return false;
+    }
+    // Checking and renewing the session takes no lock. The ID is read from
+    // the query buffer without a copy.
+    const RequestQuery::Span session_id =
+        request_query.Get(RequestQuery::kSessionId);
+    return session_manager_->RenewLastActivityTime(session_id.data,
+                                                   session_id.size);
+  }
+
+  bool ChatServer::ProcessWebSocketOpen(uint64_t connection_id,
+                                        const string& path,
+                                        const string& query) {
+    RequestQuery request_query;
+    if (!request_query.Parse(to_string_t(path), to_string_t(query)) ||
+        request_query.path() != kChatStreamPath ||
+        !IsValidSession(request_query)) {
+      return false;
+    }
+    const string_t session_id =
+        request_query.GetString(RequestQuery::kSessionId);
+    string_t user_id;
+    if (!session_manager_->GetUserIDFromSessionId(session_id, &user_id)) {
+      return false;
+    }
+    lock_guard<mutex> lock(mutex_websocket_clients_);
+    websocket_clients_.erase(connection_id);
+    WebSocketClient& client =
+        websocket_clients_
+            .emplace(connection_id,
+                     WebSocketClient(subscriber_queue_capacity_,
+                                     subscriber_queue_policy_,
+                                     &subscriber_queue_counters_))
+            .first->second;
+    client.session_id = session_id;
+    client.user_id = move(user_id);
+    return true;
+  }
+
+  void ChatServer::ProcessWebSocketMessage(uint64_t connection_id,
+                                           const string& text) {
+    string_t session_id;
+    string_t user_id;
+    {
+      lock_guard<mutex> lock(mutex_websocket_clients_);
+      const auto client_it = websocket_clients_.find(connection_id);
+      if (client_it == websocket_clients_.end()) {
+        return;
+      }
+      session_id = client_it->second.session_id;
+      user_id = client_it->second.user_id;
+    }
+    // Every message renews the session like an HTTP request does.
+    if (!session_manager_->RenewLastActivityTime(session_id)) {
+      SendWebSocketError(connection_id, "Not a valid session ID");
+      websocket_server_.CloseConnection(connection_id);
+      return;
+    }
+
+    value request;
+    try {
+      request = value::parse(to_string_t(text));
+    } catch (const web::json::json_exception&) {
+      SendWebSocketError(connection_id, "Malformed JSON");
+      return;
+    }
+    if (!request.is_object() || !request.has_string_field(UU("type")) ||
+        !request.has_string_field(UU("chat_room"))) {
+      SendWebSocketError(connection_id, "Type or chat room absence");
+      return;
+    }
+    const string_t type = request.at(UU("type")).as_string();
+    const string_t chat_room = request.at(UU("chat_room")).as_string();
+
+    if (type == UU("subscribe") || type == UU("unsubscribe")) {
+      // Messages after the cursor are pushed once subscribed.
+      vector<ChatMessage> chat_messages;
+      size_t cursor;
+      if (!chat_database_->GetChatMessages(chat_room, SIZE_MAX,
+                                           &chat_messages, &cursor)) {
+        SendWebSocketError(connection_id, "Not exist chat room");
+        return;
+      }
+      lock_guard<mutex> lock(mutex_websocket_clients_);
+      const auto client_it = websocket_clients_.find(connection_id);
+      if (client_it == websocket_clients_.end()) {
+        return;
+      }
+      auto& chat_rooms = client_it->second.chat_rooms;
+      const auto chat_room_it = chat_rooms.find(chat_room);
+      if (type == UU("subscribe")) {
+        if (chat_room_it != chat_rooms.end()) {
+          return;
+        }
+        WebSocketClient::ChatRoom& subscription = chat_rooms[chat_room];
+        subscription.last_sequence = cursor;
+        subscription.subscriber_id = room_broadcaster_.Subscribe(
+            chat_room,
+            [this, connection_id](
+                const RoomBroadcaster::Broadcast& broadcast) {
+              return PushWebSocketMessage(connection_id, broadcast);
+            });
+      } else if (chat_room_it != chat_rooms.end()) {
+        room_broadcaster_.Unsubscribe(chat_room,
+                                      chat_room_it->second.subscriber_id);
+        chat_rooms.erase(chat_room_it);
+      }
+    } else if (type == UU("chat_message")) {
+      if (!request.has_string_field(UU("chat_message"))) {
+        SendWebSocketError(connection_id, "Chat message absence");
+        return;
+      }
+      const ChatMessage chat_message(
+          CoarseClock::GetInstance().Now(), user_id, chat_room,
+          request.at(UU("chat_message")).as_string());
+      lock_guard<mutex> lock(mutex_websocket_clients_);
+      const auto client_it = websocket_clients_.find(connection_id);
+      if (client_it == websocket_clients_.end()) {
+        return;
+      }
+      StoreWebSocketChatMessage(connection_id, &client_it->second,
+                                chat_message);
+    } else {
+      SendWebSocketError(connection_id, "Unknown type");
+    }
+  }
+
+  void ChatServer::StoreWebSocketChatMessage(uint64_t connection_id,
+                                             WebSocketClient* client,
+                                             const ChatMessage& chat_message) {
+    {
+      lock_guard<mutex> lock(mutex_pending_stores_);
+      ++pending_store_count_;
+    }
+    // Storing writes the chat file, which would stall every connection of
+    // the event loop. It runs on a task chained after the previous store of
+    // the connection, so its messages keep their order. Each link catches
+    // its own exception, so a failed store does not skip the later ones.
+    client->store_task = client->store_task.then(
+        [this, connection_id, chat_message](task<void> previous_store) {
+          try {
+            previous_store.get();
+          } catch (const exception& e) {
+            error("Chat message store error: {}", e.what());
+          }
+          bool is_stored = false;
+          try {
+            is_stored = chat_database_->StoreChatMessage(chat_message);
+          } catch (const exception& e) {
+            error("Chat message store error: {}", e.what());
+          }
+          if (!is_stored) {
+            SendWebSocketError(connection_id, "Chat message store error");
+          }
+          lock_guard<mutex> lock(mutex_pending_stores_);
+          if (--pending_store_count_ == 0) {
+            pending_stores_condition_.notify_all();
+          }
+        });
+  }
+
+  void ChatServer::WaitForChatMessageStores() {
+    unique_lock<mutex> lock(mutex_pending_stores_);
+    pending_stores_condition_.wait(
+        lock, [this] { return pending_store_count_ == 0; });
+  }
+
+  void ChatServer::ProcessWebSocketClose(uint64_t connection_id) {
+    lock_guard<mutex> lock(mutex_websocket_clients_);
+    const auto client_it = websocket_clients_.find(connection_id);
+    if (client_it == websocket_clients_.end()) {
+      return;
+    }
+    for (const auto& chat_room : client_it->second.chat_rooms) {
+      room_broadcaster_.Unsubscribe(chat_room.first,
+                                    chat_room.second.subscriber_id);
+    }
+    websocket_clients_.erase(client_it);
+  }
+
+  void ChatServer::ProcessWebSocketWritable(uint64_t connection_id) {
+    lock_guard<mutex> lock(mutex_websocket_clients_);
+    const auto client_it = websocket_clients_.find(connection_id);
+    if (client_it == websocket_clients_.end()) {
+      return;
+    }
+    client_it->second.is_sending = false;
+    SendQueuedWebSocketMessages(connection_id, &client_it->second);
+  }
+
+  bool ChatServer::PushWebSocketMessage(
+      uint64_t connection_id, const RoomBroadcaster::Broadcast& broadcast) {
+    unique_lock<mutex> lock(mutex_websocket_clients_);
+    auto client_it = websocket_clients_.find(connection_id);
+    if (client_it == websocket_clients_.end()) {
+      return false;
+    }
+    // A listening client sends no frame: the open connection is its
+    // activity. Logout ends the connection.
+    if (!session_manager_->RenewLastActivityTime(
+            client_it->second.session_id)) {
+      SendWebSocketError(connection_id, "Not a valid session ID");
+      websocket_server_.CloseConnection(connection_id);
+      return false;
+    }
+    auto chat_room_it = client_it->second.chat_rooms.find(broadcast.chat_room);
+    if (chat_room_it == client_it->second.chat_rooms.end()) {
+      return false;
+    }
+    const uint64_t last_sequence = chat_room_it->second.last_sequence;
+    if (broadcast.sequence <= last_sequence) {
+      // Queued already by a catch-up.
+      return true;
+    }
+
+    // Stores are published outside the database lock, so a message can be
+    // broadcast before an earlier one. The database has both.
+    vector<ChatMessage> chat_messages;
+    if (last_sequence + 1 < broadcast.sequence) {
+      lock.unlock();
+      size_t cursor;
+      if (!chat_database_->GetChatMessages(
+              broadcast.chat_room, static_cast<size_t>(last_sequence),
+              &chat_messages, &cursor)) {
+        return false;
+      }
+      lock.lock();
+      client_it = websocket_clients_.find(connection_id);
+      if (client_it == websocket_clients_.end()) {
+        return false;
+      }
+      chat_room_it = client_it->second.chat_rooms.find(broadcast.chat_room);
+      if (chat_room_it == client_it->second.chat_rooms.end()) {
+        return false;
+      }
+    }
+
+    WebSocketClient& client = client_it->second;
+    uint64_t& queued_sequence = chat_room_it->second.last_sequence;
+    bool is_queued = true;
+    if (chat_messages.empty()) {
+      is_queued = client.send_queue.Push(broadcast.chat_room,
+                                         broadcast.sequence,
+                                         broadcast.payload.push_message);
+      queued_sequence = broadcast.sequence;
+    }
+    for (size_t i = 0; i < chat_messages.size() && is_queued; ++i) {
+      const uint64_t sequence = last_sequence + i + 1;
+      if (sequence <= queued_sequence) {
+        continue;
+      }
+      is_queued = client.send_queue.Push(
+          broadcast.chat_room, sequence,
+          SerializeChatMessage(chat_messages[i], sequence).push_message);
+      queued_sequence = sequence;
+    }
+    if (!is_queued) {
+      warn("WebSocket connection {} is too slow, closing it", connection_id);
+      websocket_server_.CloseConnection(connection_id);
+      return false;
+    }
+    // Otherwise the message is sent when the connection is writable.
+    if (!client.is_sending) {
+      SendQueuedWebSocketMessages(connection_id, &client);
+    }
+    return true;
+  }
+
+  void ChatServer::SendQueuedWebSocketMessages(uint64_t connection_id,
+                                               WebSocketClient* client) {
+    SubscriberQueue::Item item;
+    size_t sent_count = 0;
+    while (sent_count < kWebSocketSendBatch &&
+           client->send_queue.Pop(&item)) {
+      ++sent_count;
+      client->is_sending = true;
+      if (item.type == SubscriberQueue::kMessageItem) {
+        // The shared push message is queued without a copy.
+        websocket_server_.Send(connection_id, item.message);
+        continue;
+      }
+      value notice = value::object();
+      notice[UU("chat_room")] = value::string(item.chat_room);
+      if (item.type == SubscriberQueue::kGapItem) {
+        notice[UU("type")] = value::string(UU("gap"));
+        notice[UU("from")] = value::number(item.gap_begin);
+        notice[UU("to")] = value::number(item.sequence);
+      } else {
+        notice[UU("type")] = value::string(UU("resync"));
+        notice[UU("cursor")] = value::number(item.sequence);
+      }
+      websocket_server_.Send(connection_id, to_utf8string(notice.serialize()));
+    }
+  }
+
+  void ChatServer::NotifyLongPollRequests(
+      const RoomBroadcaster::Broadcast& broadcast) {
+    // The payload and the shared reply are only made if a request may be
+    // waiting.
+    LongPollRegistry::Reply reply;
+    if (broadcast.payload.chat_message != nullptr) {
+      reply = make_shared<const string>(
+          "{\"cursor\":" + to_string(broadcast.sequence) +
+          ",\"chat_messages\":[" + *broadcast.payload.chat_message + "]}");
+    }
+    long_poll_registry_.Notify(broadcast.chat_room,
+                               static_cast<size_t>(broadcast.sequence), reply);
+  }
+
+  bool ChatServer::PushEventStream(const RoomBroadcaster::Broadcast& broadcast,
+                                   EventStream* event_stream) {
+    if (event_stream->last_event_id() + 1 < broadcast.sequence) {
+      // Behind, e.g. while its backlog is written: the database has this
+      // message too.
+      return CatchUpEventStream(broadcast.chat_room, event_stream);
+    }
+    return event_stream->WriteEvent(broadcast.sequence, kChatMessageEventType,
+                                    *broadcast.payload.chat_message);
+  }
+
+  bool ChatServer::CatchUpEventStream(const string_t& chat_room,
+                                      EventStream* event_stream) {
+    const uint64_t last_event_id = event_stream->last_event_id();
+    vector<ChatMessage> chat_messages;
+    size_t cursor;
+    if (!chat_database_->GetChatMessages(
+            chat_room, static_cast<size_t>(last_event_id), &chat_messages,
+            &cursor)) {
+      return !event_stream->is_closed();
+    }
+    for (size_t i = 0; i < chat_messages.size(); ++i) {
+      if (!event_stream->WriteEvent(
+              last_event_id + i + 1, kChatMessageEventType,
+              to_utf8string(ChatMessageToJson(chat_messages[i]).serialize()))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void ChatServer::CloseEventStreams() {
+    vector<EventStreamClient> event_streams;
+    {
+      lock_guard<mutex> lock(mutex_event_streams_);
+      event_streams.swap(event_streams_);
+    }
+    for (const auto& client : event_streams) {
+      const shared_ptr<EventStream> open_event_stream =
+          client.event_stream.lock();
+      if (open_event_stream != nullptr) {
+        open_event_stream->Close();
+      }
+    }
+  }
+
+  void ChatServer::RunHeartbeatThread() {
+    if (heartbeat_thread_.joinable()) {
+      return;
+    }
+    heartbeat_thread_ = thread([this] {
+      unique_lock<mutex> lock(mutex_heartbeat_thread_);
+      while (!heartbeat_thread_condition_.wait_for(
+                 lock, chrono::seconds(kConnectionHeartbeatInterval),
+                 [this] { return stop_heartbeat_thread_; })) {
+        lock.unlock();
+        RenewWebSocketSessions();
+        RenewEventStreamSessions();
+        LogSubscriberQueueMetrics();
+        lock.lock();
+      }
+    });
+  }
+
+  void ChatServer::StopHeartbeatThread() {
+    {
+      lock_guard<mutex> lock(mutex_heartbeat_thread_);
+      stop_heartbeat_thread_ = true;
+    }
+    heartbeat_thread_condition_.notify_all();
+    if (heartbeat_thread_.joinable()) {
+      heartbeat_thread_.join();
+    }
+  }
+
+  void ChatServer::RenewWebSocketSessions() {
+    vector<pair<uint64_t, string_t>> sessions;
+    {
+      lock_guard<mutex> lock(mutex_websocket_clients_);
+      sessions.reserve(websocket_clients_.size());
+      for (const auto& client : websocket_clients_) {
+        sessions.emplace_back(client.first, client.second.session_id);
+      }
+    }
+    for (const auto& session : sessions) {
+      if (!session_manager_->RenewLastActivityTime(session.second)) {
+        SendWebSocketError(session.first, "Not a valid session ID");
+        websocket_server_.CloseConnection(session.first);
+      }
+    }
+  }
+
+  void ChatServer::RenewEventStreamSessions() {
+    vector<EventStreamClient> event_streams;
+    {
+      lock_guard<mutex> lock(mutex_event_streams_);
+      event_streams = event_streams_;
+    }
+    for (const auto& client : event_streams) {
+      const shared_ptr<EventStream> open_event_stream =
+          client.event_stream.lock();
+      if (open_event_stream == nullptr ||
+          !open_event_stream->WriteHeartbeat()) {
+        continue;
+      }
+      if (!session_manager_->RenewLastActivityTime(client.session_id)) {
+        open_event_stream->Close();
+      }
+    }
+  }
+
+  void ChatServer::LogSubscriberQueueMetrics() {
+    const SubscriberQueue::Metrics metrics = GetSubscriberQueueMetrics();
+    if (metrics.dropped_messages ==
+            logged_subscriber_queue_metrics_.dropped_messages &&
+        metrics.disconnects == logged_subscriber_queue_metrics_.disconnects) {
+      return;
+    }
+    logged_subscriber_queue_metrics_ = metrics;
+    warn("Slow WebSocket clients: {} dropped messages, {} gap notices, "
+         "{} resync notices, {} disconnects",
+         metrics.dropped_messages, metrics.gap_notices,
+         metrics.resync_notices, metrics.disconnects);
+  }
+
+  void ChatServer::SendWebSocketError(uint64_t connection_id,
+                                      const char* reason) {
+    value error_message = value::object();
+    error_message[UU("type")] = value::string(UU("error"));
+    error_message[UU("reason")] = value::string(to_string_t(reason));
+    websocket_server_.Send(connection_id,
+                           to_utf8string(error_message.serialize()));
+  }
+
+  bool ChatServer::ParseRequestQuery(const http_request& message,
+                                     RequestQuery* out_request_query) {
+    if (!out_request_query->Parse(message.relative_uri().path(),
+                                  message.relative_uri().query())) {
+      message.reply(status_codes::BadRequest, UU("Malformed URL"));
+      return false;
+    }
+    return true;
   }
 
 } // namespace chatserver
@@ -5,17 +5,54 @@
 #ifndef CHATSERVER_CHATSERVER_H_
 #define CHATSERVER_CHATSERVER_H_
 
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 #include "cpprest/http_listener.h"
 #include "cpprest/details/basic_types.h"
 
 #include "account_database.h"
 #include "session_manager.h"
 #include "chat_database.h"
+#include "event_stream.h"
+#include "hash_worker_pool.h"
+#include "long_poll_registry.h"
+#include "rate_limiter.h"
+#include "request_coalescer.h"
+#include "request_query.h"
+#include "room_broadcaster.h"
+#include "subscriber_queue.h"
+#include "websocket_server.h"
 
 // This class is designed to run chat server with REST APIs.
 // Please, call Initialize function before using this class.
 // The chat server listens to four types of the HTTP request:
 // GET, PUT, POST, DEL
+// Stored messages are handed to a RoomBroadcaster, which serializes each of
+// them once for the long-poll requests, event streams and WebSocket
+// subscribers of its room.
+// Chat messages are also pushed through WebSocket connections to
+// ws://host:websocket_port/chatstream?session_id=[] when OpenWebSocketServer
+// is called. A client sends JSON text messages:
+//   {"type": "subscribe" or "unsubscribe", "chat_room": []}
+//   {"type": "chat_message", "chat_room": [], "chat_message": []}
+// and receives {"type": "chat_message", "cursor": n, "date": [],
+// "user_id": [], "chat_room": [], "chat_message": []} for each new message of
+// its rooms, or {"type": "error", "reason": []}.
+// Pushed messages wait in a bounded queue of the connection while it is
+// slow. When the queue is full, the client receives by the overflow policy
+//   {"type": "gap", "chat_room": [], "from": n, "to": m}: the messages after
+//   cursor n up to cursor m are dropped, or
+//   {"type": "resync", "chat_room": [], "cursor": n}: read the room again
+//   from cursor n with GET chatmessage,
+// or it is disconnected.
 // Example:
 //   ChatServer chat_server(chat_database, acct_database, session_database);
 //   chat_server.Initialize(server_address);
@@ -32,8 +69,13 @@ namespace chatserver {
                AccountDatabase* account_database,
                SessionManager* session_manager);
 
+    // Remove the chat message listener set by Initialize.
+    ~ChatServer();
+
     // Set-up http_listener that process incoming HTTP request using given URL.
     // Run session thread that removes an expired session.
+    // Run heartbeat thread that renews the sessions of open connections.
+    // Listen to stored chat messages to complete long-poll requests.
     bool Initialize(utility::string_t server_url);
 
     // Open chat server. Return value, task<void>, means the chat server can be
@@ -56,27 +98,120 @@ namespace chatserver {
     //   status = chat_server.CloseServer().wait();
     pplx::task<void> CloseServer();
 
+    // Listen to WebSocket connections on the port. Call it after Initialize.
+    // CloseServer closes the WebSocket server too.
+    bool OpenWebSocketServer(uint16_t port);
+
+    // Default number of pushed messages queued to a WebSocket connection.
+    static const size_t kDefaultSubscriberQueueCapacity = 256;
+
+    // Set the size and the overflow policy of the queue of pushed messages of
+    // each WebSocket connection. Connections opened later use it.
+    void SetSubscriberQueuePolicy(
+        size_t capacity, SubscriberQueue::OverflowPolicy overflow_policy);
+
+    // Get the counters of pushed messages dropped for slow WebSocket clients.
+    // The heartbeat thread logs them when they grow.
+    SubscriberQueue::Metrics GetSubscriberQueueMetrics() const;
+
+    // Get the number of chat message requests answered with the response of
+    // an identical concurrent request.
+    uint64_t GetCoalescedRequestCount() const;
+
+    // Get queue depth and job counters of the password hashing workers.
+    HashWorkerPool::Metrics GetHashWorkerMetrics() const;
+
    private:
+    // The endpoint table of chat_server.cc.
+    friend struct EndpointTable;
+
+    // HTTP methods of the endpoints.
+    enum HttpMethod { kGet, kPost, kPut, kDelete };
+
+    // Process function of an endpoint.
+    typedef void (ChatServer::*EndpointHandler)(
+        const web::http::http_request& message,
+        const RequestQuery& request_query);
+
+    // REST API endpoint. Every endpoint is listed in EndpointTable, and
+    // DispatchRequest checks the request against it before the handler runs.
+    // Only the presence of the parameters is checked. The handler reads
+    // and converts their values with RequestQuery::GetString and GetNumber.
+    struct Endpoint {
+      HttpMethod method;
+      // Path of the URL without the separators at both ends.
+      const char* path;
+      // Bits (1 << RequestQuery::Parameter) of the parameters that must be
+      // in the query string.
+      uint32_t required_parameters;
+      // Reply of Bad Request when a required parameter is absent.
+      const utility::char_t* missing_parameter_reply;
+      // The session ID must be valid. It is renewed.
+      bool session_required;
+      // Signup and login rate limits apply.
+      bool rate_limited;
+      EndpointHandler handler;
+    };
+
+    // Find the endpoint of the request and run its handler after checking
+    // the rate limits, the session and the required parameters.
+    void DispatchRequest(HttpMethod method,
+                         const web::http::http_request& message);
+
     // Processes ResetAPI GET requests that involve server inquiry. It handles
     // for getting chat messages and getting existing chat rooms.
     // RestAPI URL forms:
     // 1) get chat message list:
     //    http://server_url/chatmessage?chat_room=[]&session_id=[]
-    // 2) get chat room list: http://server_url/chatroom?session_id=[]
+    //    &since=[]&wait=[]
+    //    since is the cursor of the previous reply (0 by default). If the
+    //    room has no message from since on, the request waits up to wait
+    //    seconds (0 by default) for one without holding a thread.
+    // 2) stream chat messages as Server-Sent Events:
+    //    http://server_url/chatmessage/stream?chat_room=[]&session_id=[]
+    //    &since=[]
+    //    The event ID is the cursor after the message. The stream starts
+    //    after the Last-Event-ID header or since, or at the current cursor.
+    // 3) get chat room list: http://server_url/chatroom?session_id=[]
     void HandleGet(const web::http::http_request& message);
 
     // Process incoming GET HTTP request for chat message list request.
+    // The reply is {"cursor": n, "chat_messages": [...]}. Concurrent
+    // requests of the same chat room and cursor share one response made by
+    // request_coalescer_. A long-poll request is parked in
+    // long_poll_registry_ and replied when it completes.
     // <Parameter description>
     //  - message: Can make an HTTP reply to the incoming HTTP request.
-    //  - url_queries: Hold query string of the incoming HTTP request URL.
+    //  - request_query: Hold path and query string of the incoming HTTP
+    //    request URL.
     void ProcessGetChatMessageRequest(
         const web::http::http_request& message,
-        const std::map<utility::string_t, utility::string_t>& url_queries);
+        const RequestQuery& request_query);
+
+    // Park a long-poll chat message request until a message of the chat
+    // room after wait_cursor is stored or wait_seconds are over.
+    void ParkChatMessageRequest(const web::http::http_request& message,
+                                const utility::string_t& chat_room,
+                                size_t wait_cursor, uint64_t wait_seconds);
+
+    // Process incoming GET HTTP request for a chat message event stream.
+    // The response stays open and each new message of the room is written
+    // as a chat_message event.
+    // <Parameter description>
+    //  - message: Can make an HTTP reply to the incoming HTTP request.
+    //  - request_query: Hold path and query string of the incoming HTTP
+    //    request URL.
+    void ProcessGetChatMessageStreamRequest(
+        const web::http::http_request& message,
+        const RequestQuery& request_query);
 
     // Process incoming GET HTTP request for chat room list request.
     // <Parameter description>
     //  - message: Can make an HTTP reply to the incoming HTTP request.
-    void ProcessGetChatRoomRequest(const web::http::http_request& message);
+    //  - request_query: Hold path and query string of the incoming HTTP
+    //    request URL.
+    void ProcessGetChatRoomRequest(const web::http::http_request& message,
+                                   const RequestQuery& request_query);
 
     // Processes ResetAPI POST requests that change server internal states.
     // It handles for account creations, login, accepting chat message, and
@@ -86,65 +221,168 @@ namespace chatserver {
     // 2) login: http://server_url/login?id=[]&pwd=[]
     // 3) make chat message:
     //    http://server_url/chatmessage?chat_message=[]&chat_room=[]&session_id=[]
-    // 4) make chat room:
+    //    or with the message in the request body:
+    //    http://server_url/chatmessage?session_id=[]
+    //    Content-Type: application/json
+    //    {"chat_room": "...", "chat_message": "..."}
+    //    or http://server_url/chatmessage?chat_room=[]&session_id=[]
+    //    Content-Type: text/plain, with the UTF-8 message text as the body.
+    // 4) make chat messages of any chat rooms at once:
+    //    http://server_url/chatmessage/batch?session_id=[]&chat_room=[]
+    //    Content-Type: application/json
+    //    [{"chat_room": "...", "chat_message": "..."}, ...]
+    //    chat_room of the query is used by messages without one. Either
+    //    every message is stored or none is.
+    // 5) make chat room:
     //    http://server_url/chatroom?chat_room=[]&session_id=[]
     void HandlePost(const web::http::http_request& message);
 
     // Process incoming POST HTTP request for sign-up.
     // <Parameter description>
     //  - message: Can make an HTTP reply to the incoming HTTP request.
-    //  - url_queries: Hold query string of the incoming HTTP request URL.
+    //  - request_query: Hold path and query string of the incoming HTTP
+    //    request URL.
     void ProcessPostSignUpRequest(
         const web::http::http_request& message, 
-        const std::map<utility::string_t, utility::string_t>& url_queries);
+        const RequestQuery& request_query);
 
-    // Process incoming POST HTTP request for login.
+    // Process incoming POST HTTP request for login. Password verification
+    // runs on hash_worker_pool_ and the reply is made when it completes.
     // <Parameter description>
     //  - message: Can make an HTTP reply to the incoming HTTP request.
-    //  - url_queries: Hold query string of the incoming HTTP request URL.
+    //  - request_query: Hold path and query string of the incoming HTTP
+    //    request URL.
     void ProcessPostLoginRequest(
         const web::http::http_request& message,
-        const std::map<utility::string_t, utility::string_t>& url_queries);
+        const RequestQuery& request_query);
 
-    // Process incoming POST HTTP request for chat message input.
+    // Process incoming POST HTTP request for chat message input. A body is
+    // decoded chunk by chunk as it is read, and the reply is made when the
+    // body ends.
     // <Parameter description>
     //  - message: Can make an HTTP reply to the incoming HTTP request.
-    //  - url_queries: Hold query string of the incoming HTTP request URL.
+    //  - request_query: Hold path and query string of the incoming HTTP
+    //    request URL.
     void ProcessPostInputChatMessageRequest(
         const web::http::http_request& message, 
-        const std::map<utility::string_t, utility::string_t>& url_queries);
+        const RequestQuery& request_query);
+
+    // Process incoming POST HTTP request for a chat message batch. The
+    // messages are decoded while the body is read, checked together and
+    // stored as one group.
+    // <Parameter description>
+    //  - message: Can make an HTTP reply to the incoming HTTP request.
+    //  - request_query: Hold path and query string of the incoming HTTP
+    //    request URL.
+    void ProcessPostChatMessageBatchRequest(
+        const web::http::http_request& message,
+        const RequestQuery& request_query);
 
     // Process incoming POST HTTP request for creating a chat room.
     // <Parameter description>
     //  - message: Can make an HTTP reply to the incoming HTTP request.
-    //  - url_queries: Hold query string of the incoming HTTP request URL.
+    //  - request_query: Hold path and query string of the incoming HTTP
+    //    request URL.
     void ProcessCreateChatRoomRequest(
         const web::http::http_request& message, 
-        const std::map<utility::string_t, utility::string_t>& url_queries);
+        const RequestQuery& request_query);
 
     // Listen to HTTP DELETE requests.
     // Mainly provides API to remove data in the web server.
     // API list:
     // 1) logout: http://server_url/session?session_id=[]
+    // 2) logout everywhere: http://server_url/session?session_id=[]&all=true
     void HandleDelete(const web::http::http_request& message);
 
     // Process incoming DELETE HTTP request for logout.
     // <Parameter description>
     //  - message: Can make an HTTP reply to the incoming HTTP request.
-    //  - url_queries: Hold query string of the incoming HTTP request URL.
+    //  - request_query: Hold path and query string of the incoming HTTP
+    //    request URL.
     void ProcessDeleteLogoutRequest(
         const web::http::http_request& message,
-        const std::map<utility::string_t, utility::string_t>& url_queries);
+        const RequestQuery& request_query);
 
     // Listen to HTTP PUT requests.
     // Mainly provides API to update data in the web server.
     // API list: none
     void HandlePut(const web::http::http_request& message);
 
+    // Take a token of the remote address and of the requested ID for the
+    // signup and login APIs. Return false if either is over the rate limit.
+    bool IsAllowedAuthRequest(
+        const web::http::http_request& message,
+        const RequestQuery& request_query);
+
     // Check the given session ID is valid or not. If the session is valid,
     // renew the alive time of the session.
-    bool IsValidSession(
-        const std::map<utility::string_t, utility::string_t>& url_queries);
+    bool IsValidSession(const RequestQuery& request_query);
+
+    // Decode the path and query string of the request URL. Reply Bad Request
+    // and return false if the URL is malformed.
+    bool ParseRequestQuery(const web::http::http_request& message,
+                           RequestQuery* out_request_query);
+
+    // Accept a WebSocket handshake of a valid session to chatstream.
+    bool ProcessWebSocketOpen(uint64_t connection_id, const std::string& path,
+                              const std::string& query);
+
+    // Process a JSON text message of a WebSocket connection. Chat messages
+    // are stored off the event loop thread.
+    void ProcessWebSocketMessage(uint64_t connection_id,
+                                 const std::string& text);
+
+    // Remove the subscriptions of a closed WebSocket connection.
+    void ProcessWebSocketClose(uint64_t connection_id);
+
+    // Send the next queued messages once a WebSocket connection has written
+    // the previous ones.
+    void ProcessWebSocketWritable(uint64_t connection_id);
+
+    // Queue the broadcast message to the WebSocket connection in sequence
+    // order, and renew its session. A message published out of order is
+    // queued with the earlier ones read from chat_database_. Return false if
+    // the connection is gone, its session was deleted, or it is closed by
+    // the overflow policy.
+    bool PushWebSocketMessage(uint64_t connection_id,
+                              const RoomBroadcaster::Broadcast& broadcast);
+
+    // Complete the long-poll requests of the broadcast room. The requests
+    // right before the message share one reply.
+    void NotifyLongPollRequests(const RoomBroadcaster::Broadcast& broadcast);
+
+    // Write the broadcast message to the event stream, or the messages it
+    // missed if it is behind. Return false if the stream is closed.
+    bool PushEventStream(const RoomBroadcaster::Broadcast& broadcast,
+                         EventStream* event_stream);
+
+    // Write the messages of the chat room after the last event of the
+    // stream. Return false if the stream is closed.
+    bool CatchUpEventStream(const utility::string_t& chat_room,
+                            EventStream* event_stream);
+
+    // Close every event stream so that their responses end.
+    void CloseEventStreams();
+
+    // Send {"type": "error", "reason": reason} to the WebSocket connection.
+    void SendWebSocketError(uint64_t connection_id, const char* reason);
+
+    // Renew the sessions of the open connections, which count as activity,
+    // every kConnectionHeartbeatInterval until StopHeartbeatThread.
+    void RunHeartbeatThread();
+    void StopHeartbeatThread();
+
+    // Renew the session of each WebSocket connection. A connection whose
+    // session was deleted is closed.
+    void RenewWebSocketSessions();
+
+    // Renew the session of each event stream and write a heartbeat to it. A
+    // stream whose session was deleted is closed.
+    void RenewEventStreamSessions();
+
+    // Log the subscriber queue counters if messages were dropped or clients
+    // disconnected since the last log.
+    void LogSubscriberQueueMetrics();
 
     // HTTP_listener: can listen to HTTP requests.
     web::http::experimental::listener::http_listener listener_;
@@ -157,6 +395,127 @@ namespace chatserver {
 
     // session_manager_ manages every session information for a user account.
     SessionManager* session_manager_;
+
+    // Runs password hashing and verification off the listener threads.
+    std::unique_ptr<HashWorkerPool> hash_worker_pool_;
+
+    // Limit signup and login requests per remote address.
+    RateLimiter address_rate_limiter_;
+
+    // Limit signup and login requests per ID.
+    RateLimiter id_rate_limiter_;
+
+    // WebSocket client of a connection.
+    struct WebSocketClient {
+      WebSocketClient(size_t capacity,
+                      SubscriberQueue::OverflowPolicy overflow_policy,
+                      SubscriberQueue::Counters* counters)
+          : send_queue(capacity, overflow_policy, counters),
+            is_sending(false),
+            store_task(pplx::task_from_result()) {
+      }
+
+      // Subscription to a chat room.
+      struct ChatRoom {
+        // Subscriber ID of room_broadcaster_.
+        uint64_t subscriber_id;
+        // Sequence of the last message queued to the client.
+        uint64_t last_sequence;
+      };
+
+      utility::string_t session_id;
+      utility::string_t user_id;
+      // Subscribed chat rooms by name.
+      std::map<utility::string_t, ChatRoom> chat_rooms;
+      // Pushed messages not handed to websocket_server_ yet.
+      SubscriberQueue send_queue;
+      // Messages are handed to websocket_server_ and not written yet.
+      bool is_sending;
+      // Last chat message store of the connection.
+      pplx::task<void> store_task;
+    };
+
+    // Store a chat message of a WebSocket connection on a task chained after
+    // the previous store of the connection. Must hold mutex_websocket_clients_.
+    void StoreWebSocketChatMessage(uint64_t connection_id,
+                                   WebSocketClient* client,
+                                   const ChatMessage& chat_message);
+
+    // Wait until every chat message store of the WebSocket connections ends.
+    // Call it after the WebSocket server is closed, so no store is added.
+    void WaitForChatMessageStores();
+
+    // Send the first queued items of the client. Must hold
+    // mutex_websocket_clients_.
+    void SendQueuedWebSocketMessages(uint64_t connection_id,
+                                     WebSocketClient* client);
+
+    // WebSocket clients by connection ID.
+    std::unordered_map<uint64_t, WebSocketClient> websocket_clients_;
+
+    // Mutex for member variables: websocket_clients_,
+    // subscriber_queue_capacity_, subscriber_queue_policy_
+    std::mutex mutex_websocket_clients_;
+
+    // Queue size and overflow policy of a new WebSocket client.
+    size_t subscriber_queue_capacity_;
+    SubscriberQueue::OverflowPolicy subscriber_queue_policy_;
+
+    // Drop counters of the queues of the WebSocket clients.
+    SubscriberQueue::Counters subscriber_queue_counters_;
+
+    // Counters at the last log. Used by the heartbeat thread only.
+    SubscriberQueue::Metrics logged_subscriber_queue_metrics_;
+
+    // Mutex for member variables: pending_store_count_
+    std::mutex mutex_pending_stores_;
+
+    // Wake up WaitForChatMessageStores when the last store ends.
+    std::condition_variable pending_stores_condition_;
+
+    // Chat message stores of WebSocket connections not finished yet.
+    size_t pending_store_count_;
+
+    // Event stream of a chat message stream request.
+    struct EventStreamClient {
+      // The reply owns the open stream until the reply ends.
+      std::weak_ptr<EventStream> event_stream;
+      utility::string_t session_id;
+    };
+
+    // Event streams to close with the server.
+    std::vector<EventStreamClient> event_streams_;
+
+    // Mutex for member variables: event_streams_
+    std::mutex mutex_event_streams_;
+
+    // Mutex for member variables: stop_heartbeat_thread_
+    std::mutex mutex_heartbeat_thread_;
+
+    // Wake up the heartbeat thread to stop.
+    std::condition_variable heartbeat_thread_condition_;
+
+    // Ask the heartbeat thread to stop.
+    bool stop_heartbeat_thread_;
+
+    // Thread that renews the sessions of the open connections.
+    std::thread heartbeat_thread_;
+
+    // Serves the WebSocket connections. It is declared after the clients,
+    // so its close handlers run while they still exist.
+    WebSocketServer websocket_server_;
+
+    // Shares one response among identical concurrent chat message requests.
+    RequestCoalescer request_coalescer_;
+
+    // Parked long-poll requests of chat messages. It completes them when it
+    // is destroyed, while the members declared before it still exist.
+    LongPollRegistry long_poll_registry_;
+
+    // Fans stored messages out to the long-poll requests, event streams and
+    // WebSocket subscribers. It is declared last so that its dispatch thread
+    // stops before the members it calls are destroyed.
+    RoomBroadcaster room_broadcaster_;
   };
 
 } // namespace chatserver
@@ -0,0 +1,61 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "coarse_clock.h"
+
+using namespace std;
+using chrono::duration_cast;
+using chrono::milliseconds;
+using chrono::steady_clock;
+
+namespace chatserver {
+
+  // Period to update the time.
+  const milliseconds kTickInterval(10);
+
+  CoarseClock& CoarseClock::GetInstance() {
+    static CoarseClock coarse_clock;
+    return coarse_clock;
+  }
+
+  time_t CoarseClock::Now() const {
+    return now_.load(memory_order_relaxed);
+  }
+
+  int64_t CoarseClock::NowMilliseconds() const {
+    return now_milliseconds_.load(memory_order_relaxed);
+  }
+
+  CoarseClock::CoarseClock()
+      : start_time_(steady_clock::now()),
+        stop_tick_thread_(false) {
+    Tick();
+    tick_thread_ = thread([this] {
+      unique_lock<mutex> lock(mutex_tick_thread_);
+      while (!tick_thread_condition_.wait_for(
+                 lock, kTickInterval, [this] { return stop_tick_thread_; })) {
+        Tick();
+      }
+    });
+  }
+
+  CoarseClock::~CoarseClock() {
+    {
+      lock_guard<mutex> lock(mutex_tick_thread_);
+      stop_tick_thread_ = true;
+    }
+    tick_thread_condition_.notify_all();
+    if (tick_thread_.joinable()) {
+      tick_thread_.join();
+    }
+  }
+
+  void CoarseClock::Tick() {
+    now_.store(time(nullptr), memory_order_relaxed);
+    now_milliseconds_.store(
+        duration_cast<milliseconds>(steady_clock::now() - start_time_).count(),
+        memory_order_relaxed);
+  }
+
+} // namespace chatserver
@@ -0,0 +1,74 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_COARSECLOCK_H_
+#define CHATSERVER_COARSECLOCK_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <thread>
+
+// This class is designed to give the current time to hot paths without a
+// clock call. One thread of the process updates the time every
+// kTickInterval, and readers take it with a relaxed atomic load.
+// The time lags behind the real clock by at most one tick.
+// The class is thread-safe.
+// Example:
+//   time_t now = CoarseClock::GetInstance().Now();
+//   int64_t now_milliseconds = CoarseClock::GetInstance().NowMilliseconds();
+
+namespace chatserver {
+
+  class CoarseClock {
+   public:
+    // Process-wide clock. The tick thread starts on the first call.
+    static CoarseClock& GetInstance();
+
+    // Wall-clock time (second).
+    std::time_t Now() const;
+
+    // Monotonic time (millisecond) since the clock started.
+    int64_t NowMilliseconds() const;
+
+    CoarseClock(const CoarseClock&) = delete;
+    CoarseClock& operator=(const CoarseClock&) = delete;
+
+   private:
+    CoarseClock();
+
+    // Stop the tick thread.
+    ~CoarseClock();
+
+    // Read the real clocks into now_ and now_milliseconds_.
+    void Tick();
+
+    // Wall-clock time (second).
+    std::atomic<std::time_t> now_;
+
+    // Monotonic time (millisecond).
+    std::atomic<int64_t> now_milliseconds_;
+
+    // Time the clock started.
+    const std::chrono::steady_clock::time_point start_time_;
+
+    // Mutex for member variable: stop_tick_thread_
+    std::mutex mutex_tick_thread_;
+
+    // Wake up the tick thread to stop.
+    std::condition_variable tick_thread_condition_;
+
+    // Ask the tick thread to stop.
+    bool stop_tick_thread_;
+
+    // Thread that updates the time every kTickInterval.
+    std::thread tick_thread_;
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_COARSECLOCK_H_ // CHATSERVER_COARSECLOCK_H_
@@ -0,0 +1,113 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "epoch_reclaimer.h"
+
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+namespace chatserver {
+
+  // Number of retired objects that triggers a reclamation.
+  const size_t kReclaimThreshold = 64;
+
+  namespace {
+
+    // Thread index spreading threads over the reader slots.
+    atomic<size_t> next_thread_index(0);
+
+  } // namespace
+
+  EpochReclaimer::ReadGuard::ReadGuard(EpochReclaimer* epoch_reclaimer)
+      : epoch_reclaimer_(epoch_reclaimer),
+        reader_slot_(epoch_reclaimer->EnterReader()) {
+  }
+
+  EpochReclaimer::ReadGuard::~ReadGuard() {
+    epoch_reclaimer_->LeaveReader(reader_slot_);
+  }
+
+  EpochReclaimer::EpochReclaimer() : global_epoch_(1) {
+    for (auto& reader_slot : reader_slots_) {
+      reader_slot.epoch.store(0, memory_order_relaxed);
+    }
+  }
+
+  EpochReclaimer::~EpochReclaimer() {
+    for (auto& retired : retired_) {
+      retired.second();
+    }
+  }
+
+  void EpochReclaimer::Retire(function<void()> deleter) {
+    size_t retired_count;
+    {
+      lock_guard<mutex> lock(mutex_retired_);
+      retired_.emplace_back(global_epoch_.fetch_add(1), move(deleter));
+      retired_count = retired_.size();
+    }
+    if (retired_count >= kReclaimThreshold) {
+      Reclaim();
+    }
+  }
+
+  void EpochReclaimer::Reclaim() {
+    // Readers that entered after an object was retired cannot reach it.
+    // A reader entering after the scan announces at least the epoch read
+    // before it, and can reach objects retired from that epoch on, so only
+    // objects retired before both the scan and every announced reader are
+    // freed.
+    uint64_t reclaim_epoch = global_epoch_.load();
+    for (const auto& reader_slot : reader_slots_) {
+      const uint64_t epoch = reader_slot.epoch.load();
+      if (epoch != 0) {
+        reclaim_epoch = min(reclaim_epoch, epoch);
+      }
+    }
+
+    vector<function<void()>> deleters;
+    {
+      lock_guard<mutex> lock(mutex_retired_);
+      const auto reclaimable_end = partition(
+          retired_.begin(), retired_.end(),
+          [reclaim_epoch](
+              const pair<uint64_t, function<void()>>& retired) {
+            return retired.first < reclaim_epoch;
+          });
+      for (auto it = retired_.begin(); it != reclaimable_end; ++it) {
+        deleters.push_back(move(it->second));
+      }
+      retired_.erase(retired_.begin(), reclaimable_end);
+    }
+    for (auto& deleter : deleters) {
+      deleter();
+    }
+  }
+
+  size_t EpochReclaimer::EnterReader() {
+    thread_local const size_t thread_index = next_thread_index.fetch_add(1);
+    size_t reader_slot = thread_index % kReaderSlotCount;
+    while (true) {
+      // The slot is taken with the epoch to announce. Sequentially consistent
+      // order makes the announcement visible before the reader loads any
+      // pointer, and after any unlink the writer did before its scan.
+      uint64_t free_epoch = 0;
+      if (reader_slots_[reader_slot].epoch.compare_exchange_strong(
+              free_epoch, global_epoch_.load())) {
+        return reader_slot;
+      }
+      reader_slot = (reader_slot + 1) % kReaderSlotCount;
+      if (reader_slot == thread_index % kReaderSlotCount) {
+        this_thread::yield();
+      }
+    }
+  }
+
+  void EpochReclaimer::LeaveReader(size_t reader_slot) {
+    reader_slots_[reader_slot].epoch.store(0, memory_order_release);
+  }
+
+} // namespace chatserver
@@ -0,0 +1,97 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_EPOCHRECLAIMER_H_
+#define CHATSERVER_EPOCHRECLAIMER_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// This class is designed to free memory that lock-free readers may still be
+// reading (epoch-based reclamation). A reader announces the current epoch in
+// a reader slot while it reads. A writer that unlinks an object retires it
+// with the current epoch and advances the epoch. The object is freed once no
+// reader announced an epoch at or before the retire epoch.
+// Reading costs one compare-and-swap on the reader slot and one store.
+// Example:
+//   EpochReclaimer epoch_reclaimer;
+//   Reader:
+//     EpochReclaimer::ReadGuard guard(&epoch_reclaimer);
+//     Node* node = head.load();  // node stays valid until guard is gone.
+//   Writer:
+//     head.store(new_node);
+//     epoch_reclaimer.Retire([old_node] { delete old_node; });
+
+namespace chatserver {
+
+  class EpochReclaimer {
+   public:
+    // Announce a reader in its constructor and leave in its destructor.
+    class ReadGuard {
+     public:
+      explicit ReadGuard(EpochReclaimer* epoch_reclaimer);
+      ~ReadGuard();
+
+      ReadGuard(const ReadGuard&) = delete;
+      ReadGuard& operator=(const ReadGuard&) = delete;
+
+     private:
+      EpochReclaimer* epoch_reclaimer_;
+      size_t reader_slot_;
+    };
+
+    EpochReclaimer();
+
+    // Free every retired object. No reader may be active.
+    ~EpochReclaimer();
+
+    EpochReclaimer(const EpochReclaimer&) = delete;
+    EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+    // Call deleter once no reader can reach the retired object. The object
+    // must already be unreachable for new readers.
+    void Retire(std::function<void()> deleter);
+
+    // Free the retired objects no reader can reach.
+    void Reclaim();
+
+   private:
+    // Number of reader slots. Readers beyond this number wait for a slot.
+    static const size_t kReaderSlotCount = 128;
+
+    // Epoch announced by a reader. Zero means the slot is free. Slots are
+    // padded to a cache line. Padding is used instead of alignas, which
+    // operator new ignores before C++17.
+    struct ReaderSlot {
+      std::atomic<uint64_t> epoch;
+      char padding[64 - sizeof(std::atomic<uint64_t>)];
+    };
+
+    // Take a free reader slot and announce the current epoch in it.
+    size_t EnterReader();
+
+    // Free the reader slot.
+    void LeaveReader(size_t reader_slot);
+
+    // Reader slots.
+    std::array<ReaderSlot, kReaderSlotCount> reader_slots_;
+
+    // Current epoch, starting from 1.
+    std::atomic<uint64_t> global_epoch_;
+
+    // Retired objects: <retire epoch, deleter>
+    std::vector<std::pair<uint64_t, std::function<void()>>> retired_;
+
+    // Mutex for member variable: retired_
+    std::mutex mutex_retired_;
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_EPOCHRECLAIMER_H_ // CHATSERVER_EPOCHRECLAIMER_H_
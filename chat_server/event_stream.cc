@@ -0,0 +1,104 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "event_stream.h"
+
+using namespace std;
+
+namespace chatserver {
+
+  // Maximum number of written bytes the client has not read.
+  const size_t kMaxUnreadSize = 1024 * 1024;
+  // Reconnection time (millisecond) suggested to the client.
+  const char kRetryField[] = "retry: 3000\n\n";
+  // Empty comment written to an idle stream.
+  const char kHeartbeatComment[] = ":\n\n";
+
+  EventStream::EventStream(uint64_t last_event_id)
+      : last_event_id_(last_event_id),
+        is_closed_(false) {
+    buffer_.putn_nocopy(reinterpret_cast<const uint8_t*>(kRetryField),
+                        sizeof(kRetryField) - 1).wait();
+  }
+
+  concurrency::streams::istream EventStream::CreateInputStream() const {
+    return buffer_.create_istream();
+  }
+
+  bool EventStream::WriteEvent(uint64_t id, const string& event_type,
+                               const string& data) {
+    lock_guard<mutex> lock(mutex_write_);
+    if (is_closed_) {
+      return false;
+    }
+    if (id != last_event_id_ + 1) {
+      // Written already, or an earlier event is still to be written.
+      return true;
+    }
+    if (buffer_.in_avail() > kMaxUnreadSize) {
+      // The client does not read; end the stream and let it resume.
+      is_closed_ = true;
+      buffer_.close(ios_base::out).wait();
+      return false;
+    }
+    const string event = FormatEvent(id, event_type, data);
+    buffer_.putn_nocopy(reinterpret_cast<const uint8_t*>(event.data()),
+                        event.size()).wait();
+    last_event_id_ = id;
+    return true;
+  }
+
+  bool EventStream::WriteHeartbeat() {
+    lock_guard<mutex> lock(mutex_write_);
+    if (is_closed_) {
+      return false;
+    }
+    if (buffer_.in_avail() > kMaxUnreadSize) {
+      // The client does not read; end the stream and let it resume.
+      is_closed_ = true;
+      buffer_.close(ios_base::out).wait();
+      return false;
+    }
+    buffer_.putn_nocopy(reinterpret_cast<const uint8_t*>(kHeartbeatComment),
+                        sizeof(kHeartbeatComment) - 1).wait();
+    return true;
+  }
+
+  void EventStream::Close() {
+    lock_guard<mutex> lock(mutex_write_);
+    if (!is_closed_) {
+      is_closed_ = true;
+      buffer_.close(ios_base::out).wait();
+    }
+  }
+
+  uint64_t EventStream::last_event_id() const {
+    return last_event_id_;
+  }
+
+  bool EventStream::is_closed() const {
+    return is_closed_;
+  }
+
+  string EventStream::FormatEvent(uint64_t id, const string& event_type,
+                                  const string& data) {
+    string event = "id: " + to_string(id) + "\nevent: " + event_type + "\n";
+    size_t line_begin = 0;
+    while (true) {
+      const size_t line_end = data.find('\n', line_begin);
+      event += "data: ";
+      event.append(data, line_begin,
+                   line_end == string::npos ? string::npos
+                                            : line_end - line_begin);
+      event += "\n";
+      if (line_end == string::npos) {
+        break;
+      }
+      line_begin = line_end + 1;
+    }
+    event += "\n";
+    return event;
+  }
+
+} // namespace chatserver
@@ -0,0 +1,80 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_EVENTSTREAM_H_
+#define CHATSERVER_EVENTSTREAM_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "cpprest/producerconsumerstream.h"
+
+// This class is designed to write Server-Sent Events into the body of an
+// HTTP response that stays open. The response body is read from
+// CreateInputStream while events are written, so cpprest sends it with
+// chunked transfer encoding.
+// Events carry increasing IDs and an event is written only if its ID follows
+// the last one, so writers racing on the same stream never duplicate,
+// reorder or skip an event. A client resumes with the Last-Event-ID header.
+// Example:
+//   auto event_stream = make_shared<EventStream>(0);
+//   http_response response(status_codes::OK);
+//   response.set_body(event_stream->CreateInputStream(),
+//                     UU("text/event-stream"));
+//   message.reply(response);
+//   event_stream->WriteEvent(1, "chat_message", "{...}");
+//   ...
+//   event_stream->Close();
+
+namespace chatserver {
+
+  class EventStream {
+   public:
+    // The first event to write has the ID last_event_id + 1.
+    explicit EventStream(uint64_t last_event_id);
+
+    // Stream of the response body.
+    concurrency::streams::istream CreateInputStream() const;
+
+    // Write the event if its ID is last_event_id() + 1. Return false if the
+    // stream is closed. The stream is closed if the client has not read
+    // kMaxUnreadSize bytes.
+    bool WriteEvent(uint64_t id, const std::string& event_type,
+                    const std::string& data);
+
+    // Write a comment line that clients ignore, so proxies do not cut an
+    // idle stream. Return false if the stream is closed.
+    bool WriteHeartbeat();
+
+    // End the response body.
+    void Close();
+
+    // ID of the last written event.
+    uint64_t last_event_id() const;
+
+    bool is_closed() const;
+
+    // Text of an event. Each line of data becomes a data field.
+    static std::string FormatEvent(uint64_t id,
+                                   const std::string& event_type,
+                                   const std::string& data);
+
+   private:
+    // Buffer between the writers and the response body.
+    concurrency::streams::producer_consumer_buffer<uint8_t> buffer_;
+
+    // ID of the last written event.
+    std::atomic<uint64_t> last_event_id_;
+
+    std::atomic<bool> is_closed_;
+
+    // Mutex for writing buffer_ and last_event_id_.
+    std::mutex mutex_write_;
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_EVENTSTREAM_H_ // CHATSERVER_EVENTSTREAM_H_
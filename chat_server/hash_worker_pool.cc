@@ -0,0 +1,81 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "hash_worker_pool.h"
+
+using namespace std;
+
+namespace chatserver {
+
+  HashWorkerPool::HashWorkerPool(size_t thread_count, size_t max_queue_depth)
+      : stop_worker_threads_(false),
+        max_queue_depth_(max_queue_depth),
+        queue_depth_(0),
+        max_observed_queue_depth_(0),
+        completed_jobs_(0),
+        rejected_jobs_(0) {
+    for (size_t i = 0; i < thread_count; ++i) {
+      worker_threads_.emplace_back(&HashWorkerPool::RunWorkerThread, this);
+    }
+  }
+
+  HashWorkerPool::~HashWorkerPool() {
+    {
+      lock_guard<mutex> lock(mutex_jobs_);
+      stop_worker_threads_ = true;
+    }
+    jobs_condition_.notify_all();
+    for (auto& worker_thread : worker_threads_) {
+      worker_thread.join();
+    }
+  }
+
+  bool HashWorkerPool::Submit(function<void()> job) {
+    {
+      lock_guard<mutex> lock(mutex_jobs_);
+      if (stop_worker_threads_ || jobs_.size() >= max_queue_depth_) {
+        ++rejected_jobs_;
+        return false;
+      }
+      jobs_.push_back(move(job));
+      const size_t queue_depth = jobs_.size();
+      queue_depth_ = queue_depth;
+      if (queue_depth > max_observed_queue_depth_) {
+        max_observed_queue_depth_ = queue_depth;
+      }
+    }
+    jobs_condition_.notify_one();
+    return true;
+  }
+
+  HashWorkerPool::Metrics HashWorkerPool::GetMetrics() const {
+    Metrics metrics;
+    metrics.queue_depth = queue_depth_;
+    metrics.max_queue_depth = max_observed_queue_depth_;
+    metrics.completed_jobs = completed_jobs_;
+    metrics.rejected_jobs = rejected_jobs_;
+    return metrics;
+  }
+
+  void HashWorkerPool::RunWorkerThread() {
+    while (true) {
+      function<void()> job;
+      {
+        unique_lock<mutex> lock(mutex_jobs_);
+        jobs_condition_.wait(lock, [this] {
+          return stop_worker_threads_ || !jobs_.empty();
+        });
+        if (jobs_.empty()) {
+          return;
+        }
+        job = move(jobs_.front());
+        jobs_.pop_front();
+        queue_depth_ = jobs_.size();
+      }
+      job();
+      ++completed_jobs_;
+    }
+  }
+
+} // namespace chatserver
@@ -0,0 +1,115 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_HASHWORKERPOOL_H_
+#define CHATSERVER_HASHWORKERPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "pplx/pplxtasks.h"
+
+// This class is designed to run password hashing and verification on its own
+// worker threads. The pool has a fixed number of threads and a bounded queue,
+// so authentication work never occupies the HTTP listener threads and a login
+// storm is rejected instead of queueing without limit.
+// Example:
+//   HashWorkerPool hash_worker_pool(2, 1024);
+//   pplx::task<AuthResult> login_task;
+//   if (hash_worker_pool.Run<AuthResult>([=] { return Login(...); },
+//                                        &login_task)) {
+//     login_task.then([](AuthResult result) { reply with result });
+//   } else {
+//     reply that the service is busy.
+//   }
+
+namespace chatserver {
+
+  class HashWorkerPool {
+   public:
+    // Snapshot of the pool state.
+    struct Metrics {
+      // Number of jobs waiting for a worker thread.
+      size_t queue_depth;
+
+      // Highest queue_depth since the pool is created.
+      size_t max_queue_depth;
+
+      // Number of finished jobs.
+      uint64_t completed_jobs;
+
+      // Number of jobs rejected because the queue was full.
+      uint64_t rejected_jobs;
+    };
+
+    // Run thread_count worker threads. At most max_queue_depth jobs can wait.
+    HashWorkerPool(size_t thread_count, size_t max_queue_depth);
+
+    // Finish the queued jobs and join the worker threads.
+    ~HashWorkerPool();
+
+    // Queue the given job. Return false if the queue is full.
+    bool Submit(std::function<void()> job);
+
+    // Queue the given function and set out_task to the task that completes
+    // with its return value, or with its exception if it throws. Return
+    // false if the queue is full.
+    template <typename Result>
+    bool Run(std::function<Result()> function, pplx::task<Result>* out_task) {
+      pplx::task_completion_event<Result> completion_event;
+      if (!Submit([function, completion_event] {
+            try {
+              completion_event.set(function());
+            } catch (...) {
+              completion_event.set_exception(std::current_exception());
+            }
+          })) {
+        return false;
+      }
+      *out_task = pplx::create_task(completion_event);
+      return true;
+    }
+
+    // Get the current metrics of the pool.
+    Metrics GetMetrics() const;
+
+   private:
+    // Take jobs from the queue and run them until the pool is stopped.
+    void RunWorkerThread();
+
+    // Queue of jobs waiting for a worker thread.
+    std::deque<std::function<void()>> jobs_;
+
+    // Mutex for member variables: jobs_, stop_worker_threads_
+    std::mutex mutex_jobs_;
+
+    // Wake up worker threads when a job is queued or on stop.
+    std::condition_variable jobs_condition_;
+
+    // Ask the worker threads to finish after the queued jobs.
+    bool stop_worker_threads_;
+
+    // Maximum number of waiting jobs.
+    const size_t max_queue_depth_;
+
+    // Metrics, readable without locking mutex_jobs_.
+    std::atomic<size_t> queue_depth_;
+    std::atomic<size_t> max_observed_queue_depth_;
+    std::atomic<uint64_t> completed_jobs_;
+    std::atomic<uint64_t> rejected_jobs_;
+
+    // Worker threads.
+    std::vector<std::thread> worker_threads_;
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_HASHWORKERPOOL_H_ // CHATSERVER_HASHWORKERPOOL_H_
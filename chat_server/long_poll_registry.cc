@@ -0,0 +1,147 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "long_poll_registry.h"
+
+#include <vector>
+
+using namespace std;
+using ::utility::string_t;
+
+namespace chatserver {
+
+  LongPollRegistry::LongPollRegistry(size_t max_waiter_count)
+      : next_waiter_id_(0),
+        stop_timer_thread_(false),
+        max_waiter_count_(max_waiter_count) {
+    timer_thread_ = thread(&LongPollRegistry::RunTimerThread, this);
+  }
+
+  LongPollRegistry::~LongPollRegistry() {
+    vector<Callback> callbacks;
+    {
+      lock_guard<mutex> lock(mutex_waiters_);
+      stop_timer_thread_ = true;
+      while (!waiters_.empty()) {
+        callbacks.push_back(RemoveWaiter(waiters_.begin()->first));
+      }
+    }
+    timer_condition_.notify_one();
+    timer_thread_.join();
+    for (auto& callback : callbacks) {
+      callback(nullptr);
+    }
+  }
+
+  bool LongPollRegistry::Park(const string_t& chat_room, size_t cursor,
+                              chrono::milliseconds timeout,
+                              Callback callback) {
+    bool is_first_deadline = false;
+    bool has_new_message;
+    {
+      lock_guard<mutex> lock(mutex_waiters_);
+      // A message may have been stored after the caller read the room.
+      const auto message_count_it = message_counts_.find(chat_room);
+      has_new_message = message_count_it != message_counts_.end() &&
+                        message_count_it->second > cursor;
+      if (!has_new_message) {
+        if (stop_timer_thread_ || waiters_.size() >= max_waiter_count_) {
+          return false;
+        }
+        const uint64_t waiter_id = next_waiter_id_++;
+        Waiter& waiter = waiters_[waiter_id];
+        waiter.cursor = cursor;
+        waiter.callback = move(callback);
+        waiter.room_it = room_waiters_.emplace(chat_room, waiter_id);
+        waiter.deadline_it = deadlines_.emplace(
+            chrono::steady_clock::now() + timeout, waiter_id);
+        is_first_deadline = waiter.deadline_it == deadlines_.begin();
+      }
+    }
+
+    if (has_new_message) {
+      callback(nullptr);
+    } else if (is_first_deadline) {
+      timer_condition_.notify_one();
+    }
+    return true;
+  }
+
+  void LongPollRegistry::Notify(const string_t& chat_room,
+                                size_t message_count, const Reply& reply) {
+    vector<Callback> callbacks;
+    vector<Callback> reply_callbacks;
+    {
+      lock_guard<mutex> lock(mutex_waiters_);
+      size_t& known_message_count = message_counts_[chat_room];
+      if (message_count <= known_message_count) {
+        return;
+      }
+      known_message_count = message_count;
+
+      vector<uint64_t> ready_waiter_ids;
+      const auto room_range = room_waiters_.equal_range(chat_room);
+      for (auto it = room_range.first; it != room_range.second; ++it) {
+        if (waiters_[it->second].cursor < message_count) {
+          ready_waiter_ids.push_back(it->second);
+        }
+      }
+      for (const uint64_t waiter_id : ready_waiter_ids) {
+        const bool is_reply_ready =
+            waiters_[waiter_id].cursor + 1 == message_count;
+        (is_reply_ready ? reply_callbacks : callbacks)
+            .push_back(RemoveWaiter(waiter_id));
+      }
+    }
+
+    for (auto& callback : reply_callbacks) {
+      callback(reply);
+    }
+    for (auto& callback : callbacks) {
+      callback(nullptr);
+    }
+  }
+
+  size_t LongPollRegistry::size() const {
+    lock_guard<mutex> lock(mutex_waiters_);
+    return waiters_.size();
+  }
+
+  LongPollRegistry::Callback LongPollRegistry::RemoveWaiter(
+      uint64_t waiter_id) {
+    const auto waiter_it = waiters_.find(waiter_id);
+    Callback callback = move(waiter_it->second.callback);
+    room_waiters_.erase(waiter_it->second.room_it);
+    deadlines_.erase(waiter_it->second.deadline_it);
+    waiters_.erase(waiter_it);
+    return callback;
+  }
+
+  void LongPollRegistry::RunTimerThread() {
+    unique_lock<mutex> lock(mutex_waiters_);
+    while (!stop_timer_thread_) {
+      if (deadlines_.empty()) {
+        timer_condition_.wait(lock);
+        continue;
+      }
+      const TimePoint first_deadline = deadlines_.begin()->first;
+      if (chrono::steady_clock::now() < first_deadline) {
+        timer_condition_.wait_until(lock, first_deadline);
+        continue;
+      }
+
+      vector<Callback> callbacks;
+      const TimePoint now = chrono::steady_clock::now();
+      while (!deadlines_.empty() && deadlines_.begin()->first <= now) {
+        callbacks.push_back(RemoveWaiter(deadlines_.begin()->second));
+      }
+      lock.unlock();
+      for (auto& callback : callbacks) {
+        callback(nullptr);
+      }
+      lock.lock();
+    }
+  }
+
+} // namespace chatserver
@@ -0,0 +1,127 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_LONGPOLLREGISTRY_H_
+#define CHATSERVER_LONGPOLLREGISTRY_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "cpprest/details/basic_types.h"
+
+// This class is designed to park long-poll requests of chat messages until a
+// new message arrives in their chat room or their wait time is over. A parked
+// request holds no thread: it is a callback that is called once, either by
+// Notify on the thread that stored the message or by the single timer thread
+// of the registry. Callbacks are called without the registry lock.
+// Notify can hand a reply made once to every request waiting right before
+// the new message, so the requests of a busy room share one serialization.
+// Example:
+//   LongPollRegistry long_poll_registry(1024);
+//   room_broadcaster.SetListener([&](const Broadcast& broadcast) {
+//     long_poll_registry.Notify(broadcast.chat_room, broadcast.sequence,
+//                               reply of the new message);
+//   });
+//   if (!long_poll_registry.Park(
+//           chat_room, cursor, seconds(30),
+//           [=](const LongPollRegistry::Reply& reply) {
+//             reply is set ? reply it : reply messages from cursor on;
+//           })) {
+//     reply that the server is busy.
+//   }
+
+namespace chatserver {
+
+  class LongPollRegistry {
+   public:
+    // Reply shared by the requests completed by the same message.
+    typedef std::shared_ptr<const std::string> Reply;
+
+    // Called once when the parked request must be completed. The reply is
+    // set only if the request waits right before the notified message.
+    typedef std::function<void(const Reply& reply)> Callback;
+
+    // Run the timer thread. At most max_waiter_count requests can be parked.
+    explicit LongPollRegistry(size_t max_waiter_count);
+
+    // Call the callbacks of every parked request and join the timer thread.
+    ~LongPollRegistry();
+
+    // Park a request that waits for a message of the chat room after cursor
+    // messages. The callback is called immediately if the room is already
+    // known to have more messages. Return false if the registry is full.
+    bool Park(const utility::string_t& chat_room, size_t cursor,
+              std::chrono::milliseconds timeout, Callback callback);
+
+    // Record that the chat room has message_count messages, and complete the
+    // requests of the room waiting for fewer messages. The reply goes to the
+    // requests at message_count - 1 messages, and may be nullptr.
+    void Notify(const utility::string_t& chat_room, size_t message_count,
+                const Reply& reply);
+
+    // Number of parked requests.
+    size_t size() const;
+
+   private:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    // Parked request.
+    struct Waiter {
+      size_t cursor;
+      Callback callback;
+      // Entries of the waiter in room_waiters_ and deadlines_.
+      std::multimap<utility::string_t, uint64_t>::iterator room_it;
+      std::multimap<TimePoint, uint64_t>::iterator deadline_it;
+    };
+
+    // Remove the waiter and return its callback. Must hold mutex_waiters_.
+    Callback RemoveWaiter(uint64_t waiter_id);
+
+    // Complete the requests whose wait time is over until the registry is
+    // stopped.
+    void RunTimerThread();
+
+    // Parked requests by waiter ID.
+    std::unordered_map<uint64_t, Waiter> waiters_;
+
+    // Waiter IDs by chat room.
+    std::multimap<utility::string_t, uint64_t> room_waiters_;
+
+    // Waiter IDs by deadline. The timer thread waits for the first one.
+    std::multimap<TimePoint, uint64_t> deadlines_;
+
+    // Highest number of messages notified for each chat room.
+    std::map<utility::string_t, size_t> message_counts_;
+
+    // ID of the next parked request.
+    uint64_t next_waiter_id_;
+
+    // Ask the timer thread to finish.
+    bool stop_timer_thread_;
+
+    // Mutex for member variables: waiters_, room_waiters_, deadlines_,
+    // message_counts_, next_waiter_id_, stop_timer_thread_
+    mutable std::mutex mutex_waiters_;
+
+    // Wake up the timer thread when the first deadline changes or on stop.
+    std::condition_variable timer_condition_;
+
+    // Maximum number of parked requests.
+    const size_t max_waiter_count_;
+
+    // Thread that completes the requests whose wait time is over.
+    std::thread timer_thread_;
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_LONGPOLLREGISTRY_H_ // CHATSERVER_LONGPOLLREGISTRY_H_
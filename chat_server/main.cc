@@ -2,8 +2,11 @@
 // Code style follows Google C++ Style Guide.
 // (https://google.github.io/styleguide/cppguide.html)
 
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "cpprest/http_listener.h"
 #include "cpprest/uri.h"
@@ -19,8 +22,73 @@ using ::web::uri_builder;
 using ::concurrency::task_status;
 
 namespace chatserver {
+
+  // Options of the command line.
+  struct ServerOptions {
+    // Secret of signed session tokens. Empty for session tables.
+    string session_token_secret;
+    // Delete expired sessions on lookup instead of in a thread.
+    bool lazy_expiry = false;
+    // Queue of pushed messages of each WebSocket connection.
+    size_t subscriber_queue_capacity =
+        ChatServer::kDefaultSubscriberQueueCapacity;
+    SubscriberQueue::OverflowPolicy overflow_policy = SubscriberQueue::kResync;
+  };
+
+  // Environment variable of the session token secret. The secret is not
+  // taken from the command line, where the process list shows it.
+  const char kTokenSecretVariable[] = "CHAT_SERVER_TOKEN_SECRET";
+
+  // Read the session token secret from the environment variable. Leave
+  // out_secret empty if the variable is not set.
+  void ReadTokenSecretVariable(string* out_secret) {
+#ifdef _WIN32
+    char* value = nullptr;
+    size_t value_size = 0;
+    if (_dupenv_s(&value, &value_size, kTokenSecretVariable) == 0 &&
+        value != nullptr) {
+      *out_secret = value;
+    }
+    free(value);
+#else
+    const char* value = getenv(kTokenSecretVariable);
+    if (value != nullptr) {
+      *out_secret = value;
+    }
+#endif
+  }
+
+  // Read the session token secret from the first line of a file.
+  bool ReadTokenSecretFile(const string& file_name, string* out_secret) {
+    ifstream secret_file(file_name);
+    if (!secret_file.is_open() || !getline(secret_file, *out_secret) ||
+        out_secret->empty()) {
+      error("Fail to read the session token secret from {}", file_name);
+      return false;
+    }
+    if (out_secret->back() == '\r') {
+      out_secret->pop_back();
+    }
+    return true;
+  }
+
+  // Parse "drop-oldest", "resync" or "disconnect".
+  bool ParseOverflowPolicy(const string& text,
+                           SubscriberQueue::OverflowPolicy* out_policy) {
+    if (text == "drop-oldest") {
+      *out_policy = SubscriberQueue::kDropOldest;
+    } else if (text == "resync") {
+      *out_policy = SubscriberQueue::kResync;
+    } else if (text == "disconnect") {
+      *out_policy = SubscriberQueue::kDisconnect;
+    } else {
+      return false;
+    }
+    return true;
+  }
   
-  int RunChatserver(string_t chat_server_uri) { 
+  int RunChatserver(string_t chat_server_uri, uint16_t websocket_port,
+                    const ServerOptions& options) { 
     unique_ptr<ChatDatabase> chat_database = make_unique<ChatDatabase>();
     if (!chat_database->Initialize(UU("chat_messages_sample.txt"),
                                    UU("chat_rooms_sample.txt"))) {
@@ -34,7 +102,22 @@ namespace chatserver {
       return 0;
     }
 
-    unique_ptr<SessionManager> session_manager = make_unique<SessionManager>();
+    // With a token secret, sessions are signed tokens that every server
+    // sharing the secret accepts.
+    unique_ptr<SessionManager> session_manager;
+    if (options.session_token_secret.empty()) {
+      session_manager = make_unique<SessionManager>();
+    } else {
+      session_manager = make_unique<SessionManager>(
+          SessionManager::kSignedToken, options.session_token_secret);
+    }
+    // Lazy expiry deletes expired sessions on lookup and login instead of
+    // in a thread. It must be set before the snapshot restores sessions.
+    if (options.lazy_expiry) {
+      session_manager->EnableLazyExpiry();
+    }
+    // Sessions survive a restart, so a deploy does not log every user out.
+    session_manager->EnableSessionSnapshot(UU("sessions_snapshot.bin"));
 
     ChatServer chat_server(chat_database.get(), 
                            acct_database.get(), 
@@ -44,6 +127,16 @@ namespace chatserver {
       return 0;
     }
 
+    // Chat messages are pushed to WebSocket clients on their own port. The
+    // overflow policy decides what a slow client loses.
+    chat_server.SetSubscriberQueuePolicy(options.subscriber_queue_capacity,
+                                         options.overflow_policy);
+    if (!chat_server.OpenWebSocketServer(websocket_port)) {
+      error("Fail to open the WebSocket server");
+      return 0;
+    }
+    info("Listening for WebSocket connections at port: {}", websocket_port);
+
     // Open the chat server
     task_status status = chat_server.OpenServer().wait();  
     if (status == task_status::completed) {
@@ -72,16 +165,83 @@ namespace chatserver {
 
 
 int main(int argc, char* argv[]) {
+  // chat_server [options] [port]
+  // Options:
+  //   --lazy-expiry
+  //   --subscriber-queue=<capacity>
+  //   --overflow-policy=drop-oldest|resync|disconnect
+  //   --token-secret-file=<file>
+  // The WebSocket server listens on port + 1. Sessions are signed tokens
+  // when a secret is in the file or in CHAT_SERVER_TOKEN_SECRET.
+  const string kQueueOption = "--subscriber-queue=";
+  const string kPolicyOption = "--overflow-policy=";
+  const string kSecretFileOption = "--token-secret-file=";
+  chatserver::ServerOptions options;
+  chatserver::ReadTokenSecretVariable(&options.session_token_secret);
+  vector<string> arguments;
+  for (int i = 1; i < argc; ++i) {
+    const string argument = argv[i];
+    if (argument == "--lazy-expiry") {
+      options.lazy_expiry = true;
+    } else if (argument.compare(0, kQueueOption.size(), kQueueOption) == 0) {
+      const string capacity = argument.substr(kQueueOption.size());
+      if (capacity.empty() || capacity.size() > 6 ||
+          capacity.find_first_not_of("0123456789") != string::npos ||
+          stoi(capacity) < 1) {
+        error("Wrong subscriber queue capacity: {}", capacity);
+        return 1;
+      }
+      options.subscriber_queue_capacity = stoi(capacity);
+    } else if (argument.compare(0, kPolicyOption.size(), kPolicyOption) ==
+               0) {
+      if (!chatserver::ParseOverflowPolicy(
+              argument.substr(kPolicyOption.size()),
+              &options.overflow_policy)) {
+        error("Wrong overflow policy: {}", argument);
+        return 1;
+      }
+    } else if (argument.compare(0, kSecretFileOption.size(),
+                                kSecretFileOption) == 0) {
+      if (!chatserver::ReadTokenSecretFile(
+              argument.substr(kSecretFileOption.size()),
+              &options.session_token_secret)) {
+        return 1;
+      }
+    } else if (argument.compare(0, 2, "--") == 0) {
+      error("Unknown option: {}", argument);
+      return 1;
+    } else {
+      arguments.push_back(argument);
+    }
+  }
   string_t port = UU("34568");
-  if (argc == 2) {
-    port = utility::conversions::to_string_t(argv[1]);
+  if (arguments.size() >= 1) {
+    port = utility::conversions::to_string_t(arguments[0]);
+  }
+  if (arguments.size() >= 2) {
+    error("The session token secret is read from {} or "
+          "--token-secret-file, not from the command line",
+          chatserver::kTokenSecretVariable);
+    return 1;
   }
   
+  // The HTTP port must leave room for the WebSocket port after it.
+  const string port_text = to_utf8string(port);
+  if (port_text.empty() || port_text.size() > 5 ||
+      port_text.find_first_not_of("0123456789") != string::npos ||
+      stoi(port_text) < 1 || stoi(port_text) >= 65535) {
+    error("Wrong port: {} (1 to 65534)", port_text);
+    return 1;
+  }
+  const uint16_t websocket_port =
+      static_cast<uint16_t>(stoi(port_text) + 1);
+
   string_t address = UU("http://localhost:");
   address.append(port);
 
   uri_builder uri(address);
   uri.append_path(UU("chat"));
 
-  return chatserver::RunChatserver(uri.to_uri().to_string());
+  return chatserver::RunChatserver(uri.to_uri().to_string(), websocket_port,
+                                   options);
 }
\ No newline at end of file
@@ -0,0 +1,77 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "nonce_replay_cache.h"
+
+#include <functional>
+
+#include "coarse_clock.h"
+
+using namespace std;
+using ::utility::string_t;
+
+namespace chatserver {
+
+  // Number of time buckets covering the replay window. One more bucket is
+  // kept in the ring, so a nonce lives at least the whole window.
+  const int64_t kBucketsPerWindow = 4;
+  // Delimiter between ID and nonce. It is prohibited in IDs.
+  const string_t kNonceKeyDelimiter = UU("|");
+
+  NonceReplayCache::NonceReplayCache(int64_t replay_window_seconds,
+                                     size_t max_nonces_per_shard)
+      : bucket_seconds_(max<int64_t>(
+            1, (replay_window_seconds + kBucketsPerWindow - 1) /
+                   kBucketsPerWindow)),
+        max_nonces_per_shard_(max_nonces_per_shard) {
+    for (auto& shard : shards_) {
+      shard.buckets.resize(kBucketsPerWindow + 1);
+      for (auto& bucket : shard.buckets) {
+        bucket.period = -1;
+      }
+      shard.nonce_count = 0;
+    }
+  }
+
+  NonceReplayCache::Result NonceReplayCache::CheckAndInsert(
+      const string_t& id, const string_t& nonce) {
+    const int64_t now_seconds =
+        CoarseClock::GetInstance().NowMilliseconds() / 1000;
+    return CheckAndInsert(id, nonce, now_seconds);
+  }
+
+  NonceReplayCache::Result NonceReplayCache::CheckAndInsert(
+      const string_t& id, const string_t& nonce, int64_t now_seconds) {
+    const string_t key = id + kNonceKeyDelimiter + nonce;
+    const int64_t period = now_seconds / bucket_seconds_;
+    const int64_t bucket_count = static_cast<int64_t>(kBucketsPerWindow + 1);
+
+    Shard& shard = shards_[hash<string_t>{}(id) % kShardCount];
+    lock_guard<mutex> lock(shard.mutex_shard);
+
+    // Buckets of periods that left the window are dropped as a whole.
+    for (auto& bucket : shard.buckets) {
+      if (bucket.period <= period - bucket_count && !bucket.nonces.empty()) {
+        shard.nonce_count -= bucket.nonces.size();
+        unordered_set<string_t>().swap(bucket.nonces);
+      }
+    }
+
+    TimeBucket& current_bucket = shard.buckets[period % bucket_count];
+    current_bucket.period = period;
+    for (const auto& bucket : shard.buckets) {
+      if (bucket.nonces.count(key) != 0) {
+        return kReplayed;
+      }
+    }
+
+    if (shard.nonce_count >= max_nonces_per_shard_) {
+      return kFull;
+    }
+    current_bucket.nonces.insert(key);
+    ++shard.nonce_count;
+    return kFirstUse;
+  }
+
+} // namespace chatserver
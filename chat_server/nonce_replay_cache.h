@@ -0,0 +1,101 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_NONCEREPLAYCACHE_H_
+#define CHATSERVER_NONCEREPLAYCACHE_H_
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#include "cpprest/details/basic_types.h"
+
+// This class is designed to reject login nonces that were already used within
+// a replay window. Nonces are sharded by the hash of the user ID, and each
+// shard keeps a ring of time buckets. A nonce is remembered in the bucket of
+// the time it was used, and a whole bucket is dropped at once when the ring
+// wraps around, so expiry never walks individual nonces.
+// Every shard holds at most max_nonces_per_shard nonces. When a shard is full
+// new nonces are refused with kFull, which keeps the memory bounded under a
+// flood. kFull is not a replay: the caller should ask the client to retry.
+// The class is thread-safe.
+// Example:
+//   NonceReplayCache nonce_replay_cache(30, 32768);
+//   NonceReplayCache::Result result = nonce_replay_cache.CheckAndInsert(
+//       id, nonce);
+//   if (result == NonceReplayCache::kFirstUse) {
+//     first use of the nonce.
+//   } else if (result == NonceReplayCache::kReplayed) {
+//     replayed nonce.
+//   } else {
+//     the shard is full; retry later.
+//   }
+
+namespace chatserver {
+
+  class NonceReplayCache {
+   public:
+    // Return values of CheckAndInsert.
+    typedef enum {
+      // The nonce is recorded.
+      kFirstUse,
+      // The nonce was already used within the replay window.
+      kReplayed,
+      // The shard is full, so the nonce is not recorded.
+      kFull
+    } Result;
+
+    // Remember nonces for at least replay_window_seconds.
+    NonceReplayCache(int64_t replay_window_seconds,
+                     size_t max_nonces_per_shard);
+
+    // Record the nonce of the given ID at the current time.
+    Result CheckAndInsert(const utility::string_t& id,
+                          const utility::string_t& nonce);
+
+    // Same as above with the given time (second).
+    Result CheckAndInsert(const utility::string_t& id,
+                          const utility::string_t& nonce,
+                          int64_t now_seconds);
+
+   private:
+    // Nonces used during one bucket period.
+    struct TimeBucket {
+      // now_seconds / bucket_seconds_ of the period this bucket holds.
+      int64_t period;
+
+      // Used nonces: id + delimiter + nonce.
+      std::unordered_set<utility::string_t> nonces;
+    };
+
+    // Partition of the cache.
+    struct Shard {
+      // Ring of time buckets, indexed by period % bucket count.
+      std::vector<TimeBucket> buckets;
+
+      // Number of nonces in buckets.
+      size_t nonce_count;
+
+      // Mutex for member variables: buckets, nonce_count
+      std::mutex mutex_shard;
+    };
+
+    // Number of shards.
+    static const size_t kShardCount = 64;
+
+    // Length of one time bucket (second).
+    const int64_t bucket_seconds_;
+
+    // Maximum number of nonces in a shard.
+    const size_t max_nonces_per_shard_;
+
+    // Shards: hash(ID) % kShardCount.
+    std::array<Shard, kShardCount> shards_;
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_NONCEREPLAYCACHE_H_ // CHATSERVER_NONCEREPLAYCACHE_H_
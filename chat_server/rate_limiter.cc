@@ -0,0 +1,68 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "rate_limiter.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "coarse_clock.h"
+
+using namespace std;
+using ::utility::string_t;
+
+namespace chatserver {
+
+  // Number of low bits holding milli-tokens in a bucket word.
+  const int kTokenBits = 24;
+  // Mask of the milli-tokens in a bucket word.
+  const uint64_t kTokenMask = (uint64_t(1) << kTokenBits) - 1;
+  // Milli-tokens taken by one request.
+  const uint64_t kTokenCost = 1000;
+
+  RateLimiter::RateLimiter(uint32_t burst, uint32_t tokens_per_second)
+      : capacity_(min<uint64_t>(uint64_t(burst) * kTokenCost, kTokenMask)),
+        refill_rate_(tokens_per_second) {
+    for (auto& slot : slots_) {
+      slot.store(0, memory_order_relaxed);
+    }
+  }
+
+  bool RateLimiter::TryAcquire(const string_t& key) {
+    return TryAcquire(key, CoarseClock::GetInstance().NowMilliseconds());
+  }
+
+  bool RateLimiter::TryAcquire(const string_t& key,
+                               int64_t now_milliseconds) {
+    atomic<uint64_t>& slot = slots_[hash<string_t>{}(key) % kSlotCount];
+    const uint64_t now = static_cast<uint64_t>(now_milliseconds);
+    uint64_t state = slot.load(memory_order_relaxed);
+    while (true) {
+      uint64_t tokens = capacity_;
+      uint64_t refill_time = now;
+      if (state != 0) {
+        // Another thread may have stored a slightly later time.
+        const uint64_t last_refill_time = (state >> kTokenBits) - 1;
+        refill_time = max(now, last_refill_time);
+        tokens = min(capacity_, (state & kTokenMask) +
+                                    (refill_time - last_refill_time) *
+                                        refill_rate_);
+      }
+
+      // An empty bucket is left untouched, so a flood of rejected requests
+      // does not keep writing the shared cache line.
+      if (tokens < kTokenCost) {
+        return false;
+      }
+
+      const uint64_t new_state =
+          ((refill_time + 1) << kTokenBits) | (tokens - kTokenCost);
+      if (slot.compare_exchange_weak(state, new_state,
+                                     memory_order_relaxed)) {
+        return true;
+      }
+    }
+  }
+
+} // namespace chatserver
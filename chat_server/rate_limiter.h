@@ -0,0 +1,58 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_RATELIMITER_H_
+#define CHATSERVER_RATELIMITER_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "cpprest/details/basic_types.h"
+
+// This class is designed to limit the request rate per key (user ID, remote
+// address) with token buckets. Buckets live in a fixed-size table indexed by
+// the hash of the key, so memory does not grow with the number of keys. Keys
+// sharing a slot share its bucket, which can only make the limit stricter.
+// Each bucket is one 64-bit atomic word holding the last refill time and the
+// remaining tokens, updated with compare-and-swap. No lock is taken.
+// Example:
+//   RateLimiter rate_limiter(10, 1);
+//   if (!rate_limiter.TryAcquire(remote_address)) {
+//     reply 429 Too Many Requests.
+//   }
+
+namespace chatserver {
+
+  class RateLimiter {
+   public:
+    // Each bucket holds at most burst tokens (at most 16000) and gains
+    // tokens_per_second tokens every second.
+    RateLimiter(uint32_t burst, uint32_t tokens_per_second);
+
+    // Take a token of the given key. Return false if the bucket is empty.
+    bool TryAcquire(const utility::string_t& key);
+
+    // Same as above at the given time (millisecond since the limiter is
+    // created).
+    bool TryAcquire(const utility::string_t& key, int64_t now_milliseconds);
+
+   private:
+    // Number of buckets.
+    static const size_t kSlotCount = 16384;
+
+    // Bucket capacity in milli-tokens.
+    const uint64_t capacity_;
+
+    // Refill rate in milli-tokens per millisecond (= tokens per second).
+    const uint64_t refill_rate_;
+
+    // Buckets: (refill time + 1) << kTokenBits | milli-tokens.
+    // Zero means the bucket is unused and full.
+    std::array<std::atomic<uint64_t>, kSlotCount> slots_;
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_RATELIMITER_H_ // CHATSERVER_RATELIMITER_H_
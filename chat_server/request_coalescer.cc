@@ -0,0 +1,64 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "request_coalescer.h"
+
+#include "spdlog/spdlog.h"
+
+using namespace std;
+using ::utility::string_t;
+using ::spdlog::warn;
+
+namespace chatserver {
+
+  RequestCoalescer::RequestCoalescer() : coalesced_count_(0) {
+  }
+
+  void RequestCoalescer::Run(const string_t& chat_room, size_t cursor,
+                             const Compute& compute, Callback callback) {
+    const Key key(chat_room, cursor);
+    {
+      lock_guard<mutex> lock(mutex_flights_);
+      const auto flight_it = flights_.find(key);
+      if (flight_it != flights_.end()) {
+        flight_it->second.push_back(move(callback));
+        ++coalesced_count_;
+        return;
+      }
+      flights_.emplace(key, vector<Callback>());
+    }
+
+    // Requests joining from now on share this response. The flight must
+    // end even if compute fails, or the joined requests would wait forever.
+    Response response;
+    try {
+      response = compute();
+      response.is_failed = false;
+    } catch (const exception& e) {
+      warn("Chat message response failed: {}", e.what());
+      response.is_failed = true;
+      response.is_found = false;
+      response.cursor = 0;
+      response.has_messages = false;
+    }
+    vector<Callback> joined_callbacks;
+    {
+      lock_guard<mutex> lock(mutex_flights_);
+      const auto flight_it = flights_.find(key);
+      joined_callbacks.swap(flight_it->second);
+      flights_.erase(flight_it);
+    }
+
+    callback(response);
+    for (const auto& joined_callback : joined_callbacks) {
+      joined_callback(response);
+    }
+  }
+
+  uint64_t RequestCoalescer::coalesced_count() const {
+    lock_guard<mutex> lock(mutex_flights_);
+    return coalesced_count_;
+  }
+
+} // namespace chatserver
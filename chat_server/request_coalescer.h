@@ -0,0 +1,93 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_REQUESTCOALESCER_H_
+#define CHATSERVER_REQUESTCOALESCER_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cpprest/details/basic_types.h"
+
+// This class is designed to make one response for identical chat message
+// requests that arrive at the same time. Requests are identical if they read
+// the same chat room from the same cursor. The first request computes the
+// response on its thread; the requests arriving meanwhile do not compute,
+// and their callbacks are called with the same immutable response when it is
+// ready. A joining request holds no thread. A response may miss messages
+// stored while it was computed; its cursor brings them on the next request.
+// Callbacks are called without the coalescer lock.
+// Example:
+//   RequestCoalescer request_coalescer;
+//   request_coalescer.Run(
+//       chat_room, cursor,
+//       [&] { return the response read from the chat database; },
+//       [=](const RequestCoalescer::Response& response) {
+//         reply response.body;
+//       });
+
+namespace chatserver {
+
+  class RequestCoalescer {
+   public:
+    // Response shared by identical requests. It is not changed once made.
+    struct Response {
+      // Whether compute failed with an exception. The other fields are not
+      // set then.
+      bool is_failed;
+
+      // Whether the chat room exists.
+      bool is_found;
+
+      // Number of messages of the chat room.
+      size_t cursor;
+
+      // Whether the response has a message.
+      bool has_messages;
+
+      // Serialized reply: {"cursor": n, "chat_messages": [...]}.
+      std::shared_ptr<const std::string> body;
+    };
+
+    // Make the response of a request.
+    typedef std::function<Response()> Compute;
+
+    // Called once with the response of a request.
+    typedef std::function<void(const Response& response)> Callback;
+
+    RequestCoalescer();
+
+    // Call the callback with the response of the chat room from cursor on.
+    // If an identical request is computing, the callback waits for its
+    // response. Otherwise compute runs on this thread, and the callbacks of
+    // the requests that joined it are called here too. If compute throws,
+    // every callback is called with a response whose is_failed is set.
+    void Run(const utility::string_t& chat_room, size_t cursor,
+             const Compute& compute, Callback callback);
+
+    // Number of requests that joined another request instead of computing.
+    uint64_t coalesced_count() const;
+
+   private:
+    // Chat room and cursor of a request.
+    typedef std::pair<utility::string_t, size_t> Key;
+
+    // Callbacks of the requests joined to the computing request of each key.
+    std::map<Key, std::vector<Callback>> flights_;
+
+    uint64_t coalesced_count_;
+
+    // Mutex for member variables: flights_, coalesced_count_
+    mutable std::mutex mutex_flights_;
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_REQUESTCOALESCER_H_ // CHATSERVER_REQUESTCOALESCER_H_
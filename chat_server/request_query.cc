@@ -0,0 +1,195 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "request_query.h"
+
+#include <cstring>
+
+#include "cpprest/asyncrt_utils.h"
+
+using namespace std;
+using ::utility::conversions::to_string_t;
+using ::utility::string_t;
+
+namespace chatserver {
+
+  // Names of the parameters, in the order of RequestQuery::Parameter.
+  const char* const kParameterNames[RequestQuery::kParameterCount] = {
+      "session_id", "id", "password", "nonce", "chat_room", "chat_message",
+      "all", "since", "wait"};
+  // Maximum number of digits of a number parameter.
+  const size_t kMaxNumberDigits = 18;
+  // Separator of the path names.
+  const char kPathSeparator = '/';
+  // Separator of the query parameters.
+  const char kParameterSeparator = '&';
+  // Separator of the name and the value of a parameter.
+  const char kValueSeparator = '=';
+
+  namespace {
+
+    // Value of a hexadecimal digit, or -1.
+    int HexValue(utility::char_t digit) {
+      if (digit >= '0' && digit <= '9') {
+        return digit - '0';
+      }
+      if (digit >= 'a' && digit <= 'f') {
+        return digit - 'a' + 10;
+      }
+      if (digit >= 'A' && digit <= 'F') {
+        return digit - 'A' + 10;
+      }
+      return -1;
+    }
+
+    // Position of the first separator in text[begin, end), or end.
+    size_t FindSeparator(const string_t& text, size_t begin, size_t end,
+                         char separator) {
+      while (begin < end && text[begin] != separator) {
+        ++begin;
+      }
+      return begin;
+    }
+
+  } // namespace
+
+  bool RequestQuery::Span::operator==(const char* text) const {
+    return strlen(text) == size && memcmp(data, text, size) == 0;
+  }
+
+  string_t RequestQuery::Span::ToString() const {
+    // ASCII text, such as an ID, is copied without a UTF-8 conversion.
+    for (size_t i = 0; i < size; ++i) {
+      if (static_cast<unsigned char>(data[i]) > 0x7F) {
+        return to_string_t(string(data, size));
+      }
+    }
+    return string_t(data, data + size);
+  }
+
+  RequestQuery::RequestQuery() : path_{0, 0} {
+    parameters_.fill(Range{0, 0});
+    has_parameters_.fill(false);
+  }
+
+  bool RequestQuery::Parse(const string_t& path, const string_t& query) {
+    // Decoding never makes the text longer, so the buffer is not reallocated.
+    buffer_.clear();
+    buffer_.reserve(path.size() + query.size());
+    path_ = Range{0, 0};
+    parameters_.fill(Range{0, 0});
+    has_parameters_.fill(false);
+
+    // Path: the separators at both ends are dropped.
+    size_t path_begin = 0;
+    while (path_begin < path.size() && path[path_begin] == kPathSeparator) {
+      ++path_begin;
+    }
+    size_t path_end = path.size();
+    while (path_end > path_begin && path[path_end - 1] == kPathSeparator) {
+      --path_end;
+    }
+    if (!Decode(path, path_begin, path_end)) {
+      return false;
+    }
+    path_.size = buffer_.size();
+
+    // Query: name=value pairs separated by '&'.
+    size_t begin = 0;
+    while (begin < query.size()) {
+      const size_t end =
+          FindSeparator(query, begin, query.size(), kParameterSeparator);
+      const size_t name_end =
+          FindSeparator(query, begin, end, kValueSeparator);
+      const size_t name_offset = buffer_.size();
+      if (!Decode(query, begin, name_end)) {
+        return false;
+      }
+      const char* name = buffer_.data() + name_offset;
+      const size_t name_size = buffer_.size() - name_offset;
+      int parameter = 0;
+      while (parameter < kParameterCount &&
+             !(strlen(kParameterNames[parameter]) == name_size &&
+               memcmp(kParameterNames[parameter], name, name_size) == 0)) {
+        ++parameter;
+      }
+      // The name is not kept.
+      buffer_.resize(name_offset);
+
+      if (parameter < kParameterCount) {
+        const size_t value_begin = name_end < end ? name_end + 1 : end;
+        if (!Decode(query, value_begin, end)) {
+          return false;
+        }
+        parameters_[parameter] =
+            Range{name_offset, buffer_.size() - name_offset};
+        has_parameters_[parameter] = true;
+      }
+      begin = end + 1;
+    }
+    return true;
+  }
+
+  RequestQuery::Span RequestQuery::path() const {
+    return ToSpan(path_);
+  }
+
+  bool RequestQuery::Has(Parameter parameter) const {
+    return has_parameters_[parameter];
+  }
+
+  RequestQuery::Span RequestQuery::Get(Parameter parameter) const {
+    return ToSpan(parameters_[parameter]);
+  }
+
+  string_t RequestQuery::GetString(Parameter parameter) const {
+    return Get(parameter).ToString();
+  }
+
+  bool RequestQuery::GetNumber(Parameter parameter,
+                               uint64_t* out_number) const {
+    const Span value = Get(parameter);
+    if (!Has(parameter) || value.empty() || value.size > kMaxNumberDigits) {
+      return false;
+    }
+    uint64_t number = 0;
+    for (size_t i = 0; i < value.size; ++i) {
+      if (value.data[i] < '0' || value.data[i] > '9') {
+        return false;
+      }
+      number = number * 10 + (value.data[i] - '0');
+    }
+    *out_number = number;
+    return true;
+  }
+
+  bool RequestQuery::Decode(const string_t& text, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const utility::char_t character = text[i];
+      if (static_cast<unsigned int>(character) > 0x7F) {
+        return false;
+      }
+      if (character != '%') {
+        buffer_ += static_cast<char>(character);
+        continue;
+      }
+      if (end - i < 3) {
+        return false;
+      }
+      const int high = HexValue(text[i + 1]);
+      const int low = HexValue(text[i + 2]);
+      if (high < 0 || low < 0) {
+        return false;
+      }
+      buffer_ += static_cast<char>((high << 4) | low);
+      i += 2;
+    }
+    return true;
+  }
+
+  RequestQuery::Span RequestQuery::ToSpan(const Range& range) const {
+    return Span{buffer_.data() + range.offset, range.size};
+  }
+
+} // namespace chatserver
@@ -0,0 +1,119 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_REQUESTQUERY_H_
+#define CHATSERVER_REQUESTQUERY_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "cpprest/details/basic_types.h"
+
+// This class is designed to parse the path and the query string of a
+// request URL without building a vector of path names and a map of queries.
+// Both are percent-decoded in one pass into one UTF-8 buffer of the object,
+// and the values of the known parameters are recorded as ranges of the
+// buffer. Unknown parameters are skipped.
+// If a parameter appears more than once, the last value is kept.
+// Example:
+//   RequestQuery request_query;
+//   if (!request_query.Parse(message.relative_uri().path(),
+//                            message.relative_uri().query())) {
+//     Malformed URL.
+//   }
+//   if (request_query.path() == "login" &&
+//       request_query.Has(RequestQuery::kId)) {
+//     string_t id = request_query.GetString(RequestQuery::kId);
+//   }
+
+namespace chatserver {
+
+  class RequestQuery {
+   public:
+    // Parameters known to the chat server.
+    enum Parameter {
+      kSessionId,
+      kId,
+      kPassword,
+      kNonce,
+      kChatRoom,
+      kChatMessage,
+      kAll,
+      kSince,
+      kWait,
+      kParameterCount
+    };
+
+    // Decoded UTF-8 characters in the buffer of a RequestQuery. It is valid
+    // while the RequestQuery is alive and not parsed again.
+    struct Span {
+      const char* data;
+      size_t size;
+
+      bool empty() const { return size == 0; }
+
+      // Compare with a null-terminated string.
+      bool operator==(const char* text) const;
+      bool operator!=(const char* text) const { return !(*this == text); }
+
+      // Copy of the characters.
+      utility::string_t ToString() const;
+    };
+
+    RequestQuery();
+
+    // Decode the path and the query string of a request URL. Return false if
+    // they have a malformed percent-encoding or a non-ASCII character.
+    bool Parse(const utility::string_t& path,
+               const utility::string_t& query);
+
+    // Path without the separators at both ends, e.g. "chatmessage/stream" of
+    // "/chatmessage/stream/". Empty if the path has no name.
+    Span path() const;
+
+    // Check the parameter is in the query string.
+    bool Has(Parameter parameter) const;
+
+    // Value of the parameter. Empty if it is absent.
+    Span Get(Parameter parameter) const;
+
+    // Copy of the value of the parameter. Empty if it is absent.
+    utility::string_t GetString(Parameter parameter) const;
+
+    // Value of the parameter as a decimal number. Return false if it is
+    // absent, not a number or too large.
+    bool GetNumber(Parameter parameter, uint64_t* out_number) const;
+
+   private:
+    // Range of buffer_.
+    struct Range {
+      size_t offset;
+      size_t size;
+    };
+
+    // Decode text[begin, end) into the end of buffer_. Return false if the
+    // encoding is malformed.
+    bool Decode(const utility::string_t& text, size_t begin, size_t end);
+
+    // Span of the range.
+    Span ToSpan(const Range& range) const;
+
+    // Decoded path name and parameter values.
+    std::string buffer_;
+
+    // Decoded path without the separators at both ends.
+    Range path_;
+
+    // Values of the parameters.
+    std::array<Range, kParameterCount> parameters_;
+
+    // Whether each parameter is in the query string.
+    std::array<bool, kParameterCount> has_parameters_;
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_REQUESTQUERY_H_ // CHATSERVER_REQUESTQUERY_H_
@@ -0,0 +1,209 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "room_broadcaster.h"
+
+#include <algorithm>
+
+using namespace std;
+using ::utility::string_t;
+
+namespace chatserver {
+
+  RoomBroadcaster::RoomBroadcaster(Serializer serializer)
+      : serializer_(move(serializer)),
+        queue_head_(nullptr),
+        is_dispatch_thread_waiting_(false),
+        published_count_(0),
+        next_subscriber_id_(0),
+        broadcast_count_(0),
+        stop_dispatch_thread_(false) {
+    dispatch_thread_ = thread(&RoomBroadcaster::RunDispatchThread, this);
+  }
+
+  RoomBroadcaster::~RoomBroadcaster() {
+    {
+      lock_guard<mutex> lock(mutex_dispatch_);
+      stop_dispatch_thread_ = true;
+    }
+    dispatch_condition_.notify_one();
+    dispatch_thread_.join();
+
+    // Published after the dispatch thread finished.
+    QueuedMessage* queued_message = queue_head_.exchange(nullptr);
+    while (queued_message != nullptr) {
+      QueuedMessage* next = queued_message->next;
+      delete queued_message;
+      queued_message = next;
+    }
+  }
+
+  void RoomBroadcaster::SetListener(Listener listener,
+                                    PayloadDemand payload_demand) {
+    listener_ = move(listener);
+    payload_demand_ = move(payload_demand);
+  }
+
+  void RoomBroadcaster::Publish(const ChatMessage& chat_message,
+                                uint64_t sequence) {
+    // Counted first, so that Flush also waits for this message.
+    published_count_.fetch_add(1);
+    QueuedMessage* queued_message =
+        new QueuedMessage{chat_message, sequence, queue_head_.load()};
+    while (!queue_head_.compare_exchange_weak(queued_message->next,
+                                              queued_message)) {
+    }
+
+    // The dispatch thread sets the flag before it checks the queue under
+    // the mutex, so either it sees the message or it is notified here.
+    if (is_dispatch_thread_waiting_.load()) {
+      lock_guard<mutex> lock(mutex_dispatch_);
+      dispatch_condition_.notify_one();
+    }
+  }
+
+  uint64_t RoomBroadcaster::Subscribe(const string_t& chat_room,
+                                      Subscriber subscriber) {
+    lock_guard<mutex> lock(mutex_subscribers_);
+    RoomSubscribers& room_subscribers = room_subscribers_[chat_room];
+    const uint64_t subscriber_id = next_subscriber_id_++;
+    room_subscribers.subscribers.emplace(subscriber_id, move(subscriber));
+    room_subscribers.is_changed = true;
+    return subscriber_id;
+  }
+
+  void RoomBroadcaster::Unsubscribe(const string_t& chat_room,
+                                    uint64_t subscriber_id) {
+    RemoveSubscribers(chat_room, {subscriber_id});
+  }
+
+  void RoomBroadcaster::Flush() {
+    const uint64_t published_count = published_count_.load();
+    unique_lock<mutex> lock(mutex_dispatch_);
+    flush_condition_.wait(lock, [&] {
+      return broadcast_count_ >= published_count || stop_dispatch_thread_;
+    });
+  }
+
+  size_t RoomBroadcaster::subscriber_count(const string_t& chat_room) const {
+    lock_guard<mutex> lock(mutex_subscribers_);
+    const auto subscribers_it = room_subscribers_.find(chat_room);
+    if (subscribers_it == room_subscribers_.end()) {
+      return 0;
+    }
+    return subscribers_it->second.subscribers.size();
+  }
+
+  void RoomBroadcaster::RunDispatchThread() {
+    while (true) {
+      QueuedMessage* queued_message = queue_head_.exchange(nullptr);
+      if (queued_message == nullptr) {
+        unique_lock<mutex> lock(mutex_dispatch_);
+        is_dispatch_thread_waiting_.store(true);
+        dispatch_condition_.wait(lock, [this] {
+          return stop_dispatch_thread_ || queue_head_.load() != nullptr;
+        });
+        is_dispatch_thread_waiting_.store(false);
+        if (queue_head_.load() == nullptr) {
+          // Stopped, and every published message is broadcast.
+          flush_condition_.notify_all();
+          return;
+        }
+        continue;
+      }
+
+      vector<unique_ptr<QueuedMessage>> queued_messages;
+      while (queued_message != nullptr) {
+        queued_messages.emplace_back(queued_message);
+        queued_message = queued_message->next;
+      }
+      // Messages stored at the same time may be published out of order, so
+      // the messages taken together are put in order of room and sequence.
+      sort(queued_messages.begin(), queued_messages.end(),
+           [](const unique_ptr<QueuedMessage>& left,
+              const unique_ptr<QueuedMessage>& right) {
+             const int room_order = left->chat_message.chat_room.compare(
+                 right->chat_message.chat_room);
+             return room_order < 0 ||
+                    (room_order == 0 && left->sequence < right->sequence);
+           });
+      for (const auto& message : queued_messages) {
+        BroadcastMessage(*message);
+      }
+
+      {
+        lock_guard<mutex> lock(mutex_dispatch_);
+        broadcast_count_ += queued_messages.size();
+      }
+      flush_condition_.notify_all();
+    }
+  }
+
+  void RoomBroadcaster::BroadcastMessage(
+      const QueuedMessage& queued_message) {
+    const string_t& chat_room = queued_message.chat_message.chat_room;
+    shared_ptr<const SubscriberList> subscribers;
+    {
+      lock_guard<mutex> lock(mutex_subscribers_);
+      const auto subscribers_it = room_subscribers_.find(chat_room);
+      if (subscribers_it != room_subscribers_.end()) {
+        RoomSubscribers& room_subscribers = subscribers_it->second;
+        if (room_subscribers.is_changed) {
+          room_subscribers.snapshot = make_shared<SubscriberList>(
+              room_subscribers.subscribers.begin(),
+              room_subscribers.subscribers.end());
+          room_subscribers.is_changed = false;
+        }
+        subscribers = room_subscribers.snapshot;
+      }
+    }
+    if (subscribers == nullptr && !listener_) {
+      return;
+    }
+
+    Broadcast broadcast;
+    broadcast.chat_room = chat_room;
+    broadcast.sequence = queued_message.sequence;
+    if (subscribers != nullptr || !payload_demand_ ||
+        payload_demand_(chat_room)) {
+      broadcast.payload = serializer_(queued_message.chat_message,
+                                      queued_message.sequence);
+    }
+    if (listener_) {
+      listener_(broadcast);
+    }
+    if (subscribers == nullptr) {
+      return;
+    }
+
+    vector<uint64_t> finished_subscriber_ids;
+    for (const auto& subscriber : *subscribers) {
+      if (!subscriber.second(broadcast)) {
+        finished_subscriber_ids.push_back(subscriber.first);
+      }
+    }
+    if (!finished_subscriber_ids.empty()) {
+      RemoveSubscribers(chat_room, finished_subscriber_ids);
+    }
+  }
+
+  void RoomBroadcaster::RemoveSubscribers(
+      const string_t& chat_room, const vector<uint64_t>& subscriber_ids) {
+    lock_guard<mutex> lock(mutex_subscribers_);
+    const auto subscribers_it = room_subscribers_.find(chat_room);
+    if (subscribers_it == room_subscribers_.end()) {
+      return;
+    }
+    RoomSubscribers& room_subscribers = subscribers_it->second;
+    for (const uint64_t subscriber_id : subscriber_ids) {
+      if (room_subscribers.subscribers.erase(subscriber_id) != 0) {
+        room_subscribers.is_changed = true;
+      }
+    }
+    if (room_subscribers.subscribers.empty()) {
+      room_subscribers_.erase(subscribers_it);
+    }
+  }
+
+} // namespace chatserver
@@ -0,0 +1,203 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_ROOMBROADCASTER_H_
+#define CHATSERVER_ROOMBROADCASTER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cpprest/details/basic_types.h"
+#include "chat_message.h"
+
+// This class is designed to fan stored chat messages out to the subscribers
+// of their chat room. Each message is serialized once, and the immutable
+// buffers are shared by every subscriber instead of being serialized again
+// for each reader.
+// Publish only pushes the message onto a lock-free queue, so the thread that
+// stored the message neither serializes it nor waits for a subscriber. One
+// dispatch thread serializes the queued messages and calls the subscribers.
+// A message is not serialized if no subscriber and no listener reads it.
+// A broadcast calls the subscribers of a snapshot list without a lock, so
+// subscribing and unsubscribing never wait for a broadcast, and a broadcast
+// in progress may still call a subscriber that has just been removed.
+// Subscribing only updates a map; the snapshot is rebuilt once by the next
+// broadcast of the room, however many subscribers changed before it.
+// Example:
+//   RoomBroadcaster room_broadcaster(
+//       [](const ChatMessage& chat_message, uint64_t sequence) {
+//         return serialized payload;
+//       });
+//   chat_database.SetChatMessageListener(
+//       [&](const ChatMessage& chat_message, size_t message_count) {
+//         room_broadcaster.Publish(chat_message, message_count);
+//       });
+//   const uint64_t subscriber_id = room_broadcaster.Subscribe(
+//       chat_room, [](const RoomBroadcaster::Broadcast& broadcast) {
+//         write *broadcast.payload.chat_message;
+//         return whether the subscriber still wants messages;
+//       });
+//   ...
+//   room_broadcaster.Unsubscribe(chat_room, subscriber_id);
+
+namespace chatserver {
+
+  class RoomBroadcaster {
+   public:
+    // Serialized forms of a message, shared by every subscriber.
+    struct Payload {
+      // JSON of the chat message.
+      std::shared_ptr<const std::string> chat_message;
+      // Text pushed to WebSocket subscribers.
+      std::shared_ptr<const std::string> push_message;
+    };
+
+    // Message delivered to the subscribers of its chat room.
+    struct Broadcast {
+      utility::string_t chat_room;
+      // Number of messages of the room up to this one, i.e. the cursor
+      // after it.
+      uint64_t sequence;
+      // Empty unless the room has a subscriber or the listener reads it.
+      Payload payload;
+    };
+
+    // Serialize a message. Called once per message on the dispatch thread.
+    typedef std::function<Payload(const ChatMessage& chat_message,
+                                  uint64_t sequence)> Serializer;
+
+    // Called on the dispatch thread and must not block. Return false to be
+    // unsubscribed.
+    typedef std::function<bool(const Broadcast& broadcast)> Subscriber;
+
+    // Called on the dispatch thread with every broadcast before the
+    // subscribers of its room.
+    typedef std::function<void(const Broadcast& broadcast)> Listener;
+
+    // Called on the dispatch thread. Return whether the listener reads the
+    // payload of a broadcast of the chat room.
+    typedef std::function<bool(const utility::string_t& chat_room)>
+        PayloadDemand;
+
+    // Run the dispatch thread.
+    explicit RoomBroadcaster(Serializer serializer);
+
+    // Broadcast the queued messages and join the dispatch thread.
+    ~RoomBroadcaster();
+
+    // Set the listener. Call it before Publish. Without payload_demand the
+    // listener always gets the payload.
+    void SetListener(Listener listener,
+                     PayloadDemand payload_demand = nullptr);
+
+    // Queue the message with the number of messages of its room up to it.
+    // Lock-free: the dispatch thread is only woken up if it sleeps.
+    void Publish(const ChatMessage& chat_message, uint64_t sequence);
+
+    // Add a subscriber to the chat room. Return its subscriber ID.
+    uint64_t Subscribe(const utility::string_t& chat_room,
+                       Subscriber subscriber);
+
+    // Remove the subscriber from the chat room.
+    void Unsubscribe(const utility::string_t& chat_room,
+                     uint64_t subscriber_id);
+
+    // Wait until the messages published before the call are broadcast.
+    void Flush();
+
+    // Number of subscribers of the chat room.
+    size_t subscriber_count(const utility::string_t& chat_room) const;
+
+   private:
+    // Published message in the lock-free queue.
+    struct QueuedMessage {
+      ChatMessage chat_message;
+      uint64_t sequence;
+      QueuedMessage* next;
+    };
+
+    // Subscribers of a chat room: <subscriber ID, subscriber>
+    typedef std::vector<std::pair<uint64_t, Subscriber>> SubscriberList;
+
+    // Subscribers of a chat room.
+    struct RoomSubscribers {
+      RoomSubscribers() : is_changed(false) {
+      }
+
+      // Subscribers by subscriber ID.
+      std::map<uint64_t, Subscriber> subscribers;
+      // Copy of subscribers that broadcasts call without a lock. It is never
+      // modified once shared.
+      std::shared_ptr<const SubscriberList> snapshot;
+      // subscribers changed after snapshot was made.
+      bool is_changed;
+    };
+
+    // Broadcast the published messages until the broadcaster is destroyed.
+    void RunDispatchThread();
+
+    // Serialize the message and call the listener and the subscribers of
+    // its room.
+    void BroadcastMessage(const QueuedMessage& queued_message);
+
+    // Remove the subscribers from the chat room.
+    void RemoveSubscribers(const utility::string_t& chat_room,
+                           const std::vector<uint64_t>& subscriber_ids);
+
+    Serializer serializer_;
+
+    Listener listener_;
+
+    PayloadDemand payload_demand_;
+
+    // Top of the stack of published messages, in reverse publish order.
+    // Producers push with compare-and-swap, and the dispatch thread takes
+    // the whole stack at once.
+    std::atomic<QueuedMessage*> queue_head_;
+
+    // The dispatch thread waits for dispatch_condition_.
+    std::atomic<bool> is_dispatch_thread_waiting_;
+
+    // Number of published messages.
+    std::atomic<uint64_t> published_count_;
+
+    // Subscribers of each chat room with at least one subscriber.
+    std::map<utility::string_t, RoomSubscribers> room_subscribers_;
+
+    // ID of the next subscriber.
+    uint64_t next_subscriber_id_;
+
+    // Mutex for member variables: room_subscribers_, next_subscriber_id_
+    mutable std::mutex mutex_subscribers_;
+
+    // Number of broadcast messages.
+    uint64_t broadcast_count_;
+
+    // Ask the dispatch thread to finish.
+    bool stop_dispatch_thread_;
+
+    // Mutex for member variables: broadcast_count_, stop_dispatch_thread_
+    std::mutex mutex_dispatch_;
+
+    // Wake up the dispatch thread when a message is published or on stop.
+    std::condition_variable dispatch_condition_;
+
+    // Wake up Flush when messages are broadcast.
+    std::condition_variable flush_condition_;
+
+    std::thread dispatch_thread_;
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_ROOMBROADCASTER_H_ // CHATSERVER_ROOMBROADCASTER_H_
@@ -0,0 +1,130 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "session.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CHATSERVER_SESSION_KEY_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+using ::utility::string_t;
+
+namespace chatserver {
+
+  // Size of a cache line.
+  const size_t kCacheLineSize = 64;
+  // Multiplier mixing the words of a key.
+  const uint64_t kKeyHashMultiplier = 0x9E3779B97F4A7C15ULL;
+
+  bool SessionKey::FromString(const string_t& session_id,
+                              SessionKey* out_key) {
+    if (session_id.size() != kLength) {
+      return false;
+    }
+    for (size_t i = 0; i < kLength; ++i) {
+      const auto character = session_id[i];
+      if (character <= 0 || character > 0x7F) {
+        return false;
+      }
+      out_key->bytes[i] = static_cast<unsigned char>(character);
+    }
+    return true;
+  }
+
+  bool SessionKey::FromBytes(const char* session_id, size_t size,
+                             SessionKey* out_key) {
+    if (size != kLength) {
+      return false;
+    }
+    for (size_t i = 0; i < kLength; ++i) {
+      // char may be unsigned, so the byte is checked as unsigned char.
+      const unsigned char character =
+          static_cast<unsigned char>(session_id[i]);
+      if (character == 0 || character > 0x7F) {
+        return false;
+      }
+      out_key->bytes[i] = character;
+    }
+    return true;
+  }
+
+  string_t SessionKey::ToString() const {
+    return string_t(bytes, bytes + kLength);
+  }
+
+  size_t SessionKey::Hash() const {
+    // Session IDs are random, so mixing the four words is enough.
+    uint64_t words[kLength / sizeof(uint64_t)];
+    memcpy(words, bytes, kLength);
+    uint64_t hash = 0;
+    for (const uint64_t word : words) {
+      hash = (hash ^ word) * kKeyHashMultiplier;
+    }
+    return static_cast<size_t>(hash ^ (hash >> 32));
+  }
+
+  bool SessionKey::operator==(const SessionKey& other) const {
+#ifdef CHATSERVER_SESSION_KEY_SSE2
+    // Keys are not always 16-byte aligned (map nodes on 32-bit builds).
+    const __m128i* left = reinterpret_cast<const __m128i*>(bytes);
+    const __m128i* right = reinterpret_cast<const __m128i*>(other.bytes);
+    const __m128i equal = _mm_and_si128(
+        _mm_cmpeq_epi8(_mm_loadu_si128(left), _mm_loadu_si128(right)),
+        _mm_cmpeq_epi8(_mm_loadu_si128(left + 1),
+                       _mm_loadu_si128(right + 1)));
+    return _mm_movemask_epi8(equal) == 0xFFFF;
+#else
+    return memcmp(bytes, other.bytes, kLength) == 0;
+#endif
+  }
+
+  bool SessionKey::operator!=(const SessionKey& other) const {
+    return !(*this == other);
+  }
+
+  SessionRecord::SessionRecord(const SessionKey& key, size_t key_hash,
+                               const string_t& user_id,
+                               time_t last_activity_time)
+      : key(key),
+        last_activity_time(last_activity_time),
+        hash(key_hash),
+        user_id(user_id) {
+  }
+
+  void* SessionRecord::operator new(size_t size) {
+#if defined(_MSC_VER)
+    void* record = _aligned_malloc(size, kCacheLineSize);
+#else
+    void* record = nullptr;
+    if (posix_memalign(&record, kCacheLineSize, size) != 0) {
+      record = nullptr;
+    }
+#endif
+    if (record == nullptr) {
+      throw bad_alloc();
+    }
+    return record;
+  }
+
+  void SessionRecord::operator delete(void* record) {
+#if defined(_MSC_VER)
+    _aligned_free(record);
+#else
+    free(record);
+#endif
+  }
+
+} // namespace chatserver
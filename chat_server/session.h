@@ -5,9 +5,19 @@
 #ifndef CHATSERVER_SESSION_H_
 #define CHATSERVER_SESSION_H_
 
+#include <atomic>
+#include <cstddef>
+#include <ctime>
+
 #include "cpprest/details/basic_types.h"
 
 // Session information structure (session_id, user_id, last_activity_time).
+//
+// SessionKey keeps a session ID inline as kLength bytes instead of a heap
+// string, and compares two keys with two 16-byte SIMD compares.
+// SessionRecord is the session stored in the session table. It starts on a
+// cache line and its fields read by every lookup (key, hash, last activity
+// time) share that line.
 
 namespace chatserver {
 
@@ -22,6 +32,55 @@ namespace chatserver {
     time_t last_activity_time;
   };
 
+  struct SessionKey {
+    // Length of a session ID.
+    static const size_t kLength = 32;
+
+    // Make a key from the session ID. Return false if the ID does not have
+    // kLength characters or has a non-ASCII character.
+    static bool FromString(const utility::string_t& session_id,
+                           SessionKey* out_key);
+
+    // Make a key from the characters of the session ID, e.g. a decoded
+    // request query, without a copy. Same checks as FromString.
+    static bool FromBytes(const char* session_id, size_t size,
+                          SessionKey* out_key);
+
+    // Session ID of the key.
+    utility::string_t ToString() const;
+
+    // Hash of the key.
+    size_t Hash() const;
+
+    bool operator==(const SessionKey& other) const;
+    bool operator!=(const SessionKey& other) const;
+
+    // ASCII characters of the session ID.
+    unsigned char bytes[kLength];
+  };
+
+  struct SessionRecord {
+    SessionRecord(const SessionKey& key, size_t key_hash,
+                  const utility::string_t& user_id,
+                  std::time_t last_activity_time);
+
+    // Records are allocated on a cache line boundary.
+    static void* operator new(size_t size);
+    static void operator delete(void* record);
+
+    // Session ID.
+    const SessionKey key;
+
+    // Last activity time. Renewal is a relaxed store.
+    std::atomic<std::time_t> last_activity_time;
+
+    // Hash of key, compared before the key.
+    const size_t hash;
+
+    // User ID. It is read only after the key matches.
+    const utility::string_t user_id;
+  };
+
 } // namespace chatserver
 
-#endif CHATSERVER_SESSION_H_ // CHATSERVER_SESSION_H_
\ No newline at end of file
+#endif CHATSERVER_SESSION_H_ // CHATSERVER_SESSION_H_
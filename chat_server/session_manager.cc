@@ -6,13 +6,13 @@
 
 #include <chrono>
 #include <future>
+#include <random>
 
+#include "coarse_clock.h"
 #include "cpprest/asyncrt_utils.h"
 #include "spdlog/spdlog.h"
 
 using namespace std;
-using chrono::system_clock;
-using chrono::duration;
 using ::utility::conversions::to_utf8string;
 using ::utility::string_t;
 using ::spdlog::info;
@@ -22,62 +22,554 @@ namespace chatserver {
   // Session alive time (second).
   const time_t kSessionAliveTime = 30;
   // Length of session id.
-  const size_t kSessionLength = 32;
+  const size_t kSessionLength = SessionKey::kLength;
+  // Lifetime of a signed token (second). It bounds how long another server
+  // accepts a token after logout.
+  const time_t kSignedTokenLifetime = 600;
   // Period to check session expire (second).
   const time_t kSessionCheckInterval = 1;
+  // Period to save the session snapshot (second).
+  const time_t kSessionSnapshotInterval = 10;
+  // Slots of a session shard swept by CreateSession in lazy expiry mode.
+  const size_t kLazySweepSlotCount = 32;
   // Session seed.
   const string_t kSessionValue = UU(
       "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz");
+  // Random bits of one session ID character.
+  const int kCharacterBits = 6;
+  // Session ID characters taken from one 64-bit draw.
+  const int kCharactersPerDraw = 64 / kCharacterBits;
+
+  SessionManager::SessionShard::SessionShard()
+      : session_expire_wheel(CoarseClock::GetInstance().Now()),
+        sweep_slot(0) {
+  }
 
   SessionManager::SessionManager()
-      : rand_(std::random_device{}()),
-        session_generator_(0, kSessionValue.size() - 1) {
+      : SessionManager(kStoredSession, string()) {
+  }
+
+  SessionManager::SessionManager(SessionMode session_mode,
+                                 const string& token_secret)
+      : session_mode_(session_mode),
+        lazy_expiry_(false),
+        next_sweep_shard_(0),
+        user_logout_count_(0),
+        stop_expire_thread_(false) {
+    for (auto& session_shard : session_shards_) {
+      session_shard.sessions.reset(new SessionTable(&session_reclaimer_));
+    }
+    if (session_mode_ == kSignedToken) {
+      token_signer_.reset(new SessionTokenSigner(token_secret));
+    }
   }
 
   SessionManager::~SessionManager() {
+    {
+      lock_guard<mutex> lock(mutex_expire_thread_);
+      stop_expire_thread_ = true;
+    }
+    expire_thread_condition_.notify_all();
+    if (expire_thread_.joinable()) {
+      expire_thread_.join();
+    }
+    // The last snapshot lets a restarted server keep every session.
+    if (!snapshot_file_name_.empty()) {
+      SaveSessions(snapshot_file_name_);
+    }
   }
 
   bool SessionManager::IsExistSessionId(string_t session_id) {
-    // ToDo: Implement to check whether the given session id exists in session_.
-    return false;
+    if (session_mode_ == kSignedToken) {
+      return VerifyToken(session_id, nullptr, nullptr, nullptr);
+    }
+    SessionKey session_key;
+    if (!SessionKey::FromString(session_id, &session_key)) {
+      return false;
+    }
+    if (lazy_expiry_.load(memory_order_relaxed)) {
+      return CheckLazyExpiry(session_key, CoarseClock::GetInstance().Now());
+    }
+    return GetSessionShard(session_key).sessions->Contains(session_key);
   }
 
   Session SessionManager::CreateSession(string_t user_id) {
-    // ToDo: Implement to create session id of the given user id.
+    return CreateSession(user_id, CoarseClock::GetInstance().Now());
+  }
+
+  Session SessionManager::CreateSession(string_t user_id, time_t now) {
+    if (session_mode_ == kSignedToken) {
+      Session session;
+      session.user_id = user_id;
+      session.last_activity_time = now;
+      session.session_id = token_signer_->Issue(
+          user_id, session.last_activity_time + kSignedTokenLifetime);
+      return session;
+    }
+
+    // Sweeping locks user shards, so it is done before the user is locked.
+    const bool lazy_expiry = lazy_expiry_.load(memory_order_relaxed);
+    if (lazy_expiry) {
+      SweepSessions(now);
+    }
+
+    // The user shard stays locked, so concurrent logins of the same user
+    // cannot exceed kMaxSessionsPerUser.
+    UserShard& user_shard = GetUserShard(user_id);
+    lock_guard<mutex> user_lock(user_shard.mutex_shard);
+    UserSessionSet& user_sessions =
+        user_shard.user_id_to_session_keys[user_id];
+    while (user_sessions.size() >= kMaxSessionsPerUser) {
+      EvictLeastRecentSession(&user_sessions);
+    }
+
     Session session;
+    session.user_id = user_id;
+    session.last_activity_time = now;
+    SessionKey session_key;
+    while (true) {
+      session_key = GenerateSessionKey();
+      session.session_id = session_key.ToString();
+      SessionShard& session_shard = GetSessionShard(session_key);
+      lock_guard<mutex> session_lock(session_shard.mutex_shard);
+      // The session ID must be unique.
+      if (session_shard.sessions->Insert(session_key, user_id, now)) {
+        if (!lazy_expiry) {
+          session_shard.session_expire_wheel.Schedule(
+              session_key, now + kSessionAliveTime);
+        }
+        break;
+      }
+    }
+    user_sessions.Add(session_key);
     return session;
   }
 
   bool SessionManager::DeleteSession(string_t session_id) {
-    // ToDo: Implement to delete the given session id.
-    return false;
+    if (session_mode_ == kSignedToken) {
+      time_t expire_time;
+      uint64_t token_mac;
+      if (!VerifyToken(session_id, nullptr, &expire_time, &token_mac)) {
+        return false;
+      }
+      return token_revocation_set_.Revoke(token_mac, expire_time,
+                                          CoarseClock::GetInstance().Now());
+    }
+    SessionKey session_key;
+    if (!SessionKey::FromString(session_id, &session_key)) {
+      return false;
+    }
+    string_t user_id;
+    {
+      SessionShard& session_shard = GetSessionShard(session_key);
+      lock_guard<mutex> lock(session_shard.mutex_shard);
+      if (!session_shard.sessions->Erase(session_key, &user_id)) {
+        return false;
+      }
+      session_shard.session_expire_wheel.Cancel(session_key);
+    }
+    RemoveUserMapping(user_id, session_key);
+    return true;
+  }
+
+  size_t SessionManager::DeleteUserSessions(const string_t& user_id) {
+    if (session_mode_ == kSignedToken) {
+      RevokeUserTokens(user_id, CoarseClock::GetInstance().Now());
+      return 0;
+    }
+    UserSessionSet user_sessions;
+    {
+      UserShard& user_shard = GetUserShard(user_id);
+      lock_guard<mutex> lock(user_shard.mutex_shard);
+      const auto user_it = user_shard.user_id_to_session_keys.find(user_id);
+      if (user_it == user_shard.user_id_to_session_keys.end()) {
+        return 0;
+      }
+      user_sessions = user_it->second;
+      user_shard.user_id_to_session_keys.erase(user_it);
+    }
+
+    size_t deleted_count = 0;
+    for (size_t i = 0; i < user_sessions.size(); ++i) {
+      SessionShard& session_shard = GetSessionShard(user_sessions[i]);
+      lock_guard<mutex> lock(session_shard.mutex_shard);
+      if (session_shard.sessions->Erase(user_sessions[i], nullptr)) {
+        session_shard.session_expire_wheel.Cancel(user_sessions[i]);
+        ++deleted_count;
+      }
+    }
+    return deleted_count;
   }
 
   bool SessionManager::RenewLastActivityTime(string_t session_id) {
-    // ToDo: Implement to renew last_activity_time of the given session id.
-    // ToDo: Set last_activity_time to the current time.
-    return false;
+    // A token cannot be renewed. It is only checked.
+    if (session_mode_ == kSignedToken) {
+      return VerifyToken(session_id, nullptr, nullptr, nullptr);
+    }
+    SessionKey session_key;
+    if (!SessionKey::FromString(session_id, &session_key)) {
+      return false;
+    }
+    return RenewSessionKey(session_key);
+  }
+
+  bool SessionManager::RenewLastActivityTime(const char* session_id,
+                                             size_t size) {
+    if (session_mode_ == kSignedToken) {
+      // A token is ASCII, so other characters only fail the check.
+      return VerifyToken(string_t(session_id, session_id + size), nullptr,
+                         nullptr, nullptr);
+    }
+    SessionKey session_key;
+    if (!SessionKey::FromBytes(session_id, size, &session_key)) {
+      return false;
+    }
+    return RenewSessionKey(session_key);
   }
 
-  const string_t SessionManager::GenerateSessionId() {
-    // ToDo: Return random session id using kSessionValue and kSessionLength.
-    // ToDo: The session ID must be a unique value.
-    // ToDo: Use random function of rand_, session_generator_.
-    return UU("");
+  bool SessionManager::RenewSessionKey(const SessionKey& session_key) {
+    if (lazy_expiry_.load(memory_order_relaxed) &&
+        !CheckLazyExpiry(session_key, CoarseClock::GetInstance().Now())) {
+      return false;
+    }
+    // The expire thread reschedules the session when its slot comes due.
+    return GetSessionShard(session_key).sessions->Touch(
+        session_key, CoarseClock::GetInstance().Now());
+  }
+
+  SessionKey SessionManager::GenerateSessionKey() {
+    // Uniqueness is checked by CreateSession in the session shard.
+    thread_local mt19937_64 generator = [] {
+      random_device random;
+      seed_seq seed{random(), random(), random(), random(),
+                    random(), random(), random(), random()};
+      return mt19937_64(seed);
+    }();
+
+    // One draw gives kCharactersPerDraw 6-bit values. Values out of
+    // kSessionValue are dropped, so every character is equally likely.
+    SessionKey session_key;
+    size_t length = 0;
+    while (length < kSessionLength) {
+      uint64_t draw = generator();
+      for (int i = 0; i < kCharactersPerDraw && length < kSessionLength;
+           ++i, draw >>= kCharacterBits) {
+        const size_t value = draw & ((1 << kCharacterBits) - 1);
+        if (value < kSessionValue.size()) {
+          session_key.bytes[length++] =
+              static_cast<unsigned char>(kSessionValue[value]);
+        }
+      }
+    }
+    return session_key;
   }
 
   bool SessionManager::GetUserIDFromSessionId(string_t session_id, 
                                               string_t* out_user_id) {
-    // ToDo: Save user id of the given session id into out_user_id. 
-    // ToDo: If it fails return false.
-    return false;
+    if (session_mode_ == kSignedToken) {
+      return VerifyToken(session_id, out_user_id, nullptr, nullptr);
+    }
+    SessionKey session_key;
+    if (!SessionKey::FromString(session_id, &session_key)) {
+      return false;
+    }
+    if (lazy_expiry_.load(memory_order_relaxed) &&
+        !CheckLazyExpiry(session_key, CoarseClock::GetInstance().Now())) {
+      return false;
+    }
+    return GetSessionShard(session_key).sessions->GetUserId(session_key,
+                                                             out_user_id);
   }
 
   void SessionManager::RunSessionExpireThread() {
-    // ToDo: Run a thread to remove expired session.
-    // ToDo: If a session's last_activity_time is over kSessionAliveTime from
-    // ToDo: the current time, delete the session.
-    // ToDo: Run this the above logic every kSessionCheckInterval.
+    // Tokens expire by themselves.
+    if (session_mode_ == kSignedToken || lazy_expiry_ ||
+        expire_thread_.joinable()) {
+      return;
+    }
+    expire_thread_ = thread([this] {
+      unique_lock<mutex> lock(mutex_expire_thread_);
+      time_t last_snapshot_time = CoarseClock::GetInstance().Now();
+      while (!expire_thread_condition_.wait_for(
+                 lock, chrono::seconds(kSessionCheckInterval),
+                 [this] { return stop_expire_thread_; })) {
+        const string_t snapshot_file_name = snapshot_file_name_;
+        lock.unlock();
+        const time_t now = CoarseClock::GetInstance().Now();
+        ExpireSessions(now);
+        if (!snapshot_file_name.empty() &&
+            now - last_snapshot_time >= kSessionSnapshotInterval) {
+          SaveSessions(snapshot_file_name);
+          last_snapshot_time = now;
+        }
+        lock.lock();
+      }
+    });
+  }
+
+  void SessionManager::EnableLazyExpiry() {
+    lazy_expiry_ = true;
+  }
+
+  bool SessionManager::EnableSessionSnapshot(
+      const string_t& snapshot_file_name) {
+    // Signed tokens outlive a restart by themselves.
+    if (session_mode_ == kSignedToken) {
+      return false;
+    }
+    {
+      lock_guard<mutex> lock(mutex_expire_thread_);
+      snapshot_file_name_ = snapshot_file_name;
+    }
+    vector<Session> sessions;
+    if (!SessionSnapshot::Load(snapshot_file_name, &sessions)) {
+      return false;
+    }
+    RestoreSessions(sessions, CoarseClock::GetInstance().Now());
+    info("Restored sessions from snapshot: {}",
+         to_utf8string(snapshot_file_name));
+    return true;
+  }
+
+  void SessionManager::ExpireSessions(time_t now) {
+    for (auto& session_shard : session_shards_) {
+      // <session_key, user_id> of the expired sessions.
+      vector<pair<SessionKey, string_t>> expired_sessions;
+      {
+        lock_guard<mutex> lock(session_shard.mutex_shard);
+        vector<SessionKey> expired_session_keys;
+        session_shard.session_expire_wheel.Advance(now,
+                                                   &expired_session_keys);
+        for (const auto& session_key : expired_session_keys) {
+          time_t last_activity_time;
+          if (!session_shard.sessions->GetLastActivityTime(
+                  session_key, &last_activity_time)) {
+            continue;
+          }
+          // Renewed after it was scheduled: schedule it again.
+          if (last_activity_time + kSessionAliveTime > now) {
+            session_shard.session_expire_wheel.Schedule(
+                session_key, last_activity_time + kSessionAliveTime);
+            continue;
+          }
+          string_t user_id;
+          session_shard.sessions->Erase(session_key, &user_id);
+          expired_sessions.emplace_back(session_key, user_id);
+        }
+      }
+
+      // The session shard is unlocked before a user shard is locked.
+      for (const auto& expired_session : expired_sessions) {
+        RemoveUserMapping(expired_session.second, expired_session.first);
+      }
+    }
+  }
+
+  void SessionManager::SweepSessions(time_t now) {
+    SessionShard& session_shard =
+        session_shards_[next_sweep_shard_++ % kSessionShardCount];
+    // <session_key, user_id> of the expired sessions.
+    vector<pair<SessionKey, string_t>> expired_sessions;
+    {
+      lock_guard<mutex> lock(session_shard.mutex_shard);
+      vector<SessionKey> idle_session_keys;
+      session_shard.sessions->CollectIdleSessions(
+          &session_shard.sweep_slot, kLazySweepSlotCount,
+          now - kSessionAliveTime, &idle_session_keys);
+      for (const auto& session_key : idle_session_keys) {
+        string_t user_id;
+        session_shard.sessions->Erase(session_key, &user_id);
+        expired_sessions.emplace_back(session_key, user_id);
+      }
+    }
+
+    // The session shard is unlocked before a user shard is locked.
+    for (const auto& expired_session : expired_sessions) {
+      RemoveUserMapping(expired_session.second, expired_session.first);
+    }
+  }
+
+  bool SessionManager::CheckLazyExpiry(const SessionKey& session_key,
+                                       time_t now) {
+    SessionShard& session_shard = GetSessionShard(session_key);
+    time_t last_activity_time;
+    if (!session_shard.sessions->GetLastActivityTime(session_key,
+                                                     &last_activity_time)) {
+      return false;
+    }
+    if (last_activity_time + kSessionAliveTime > now) {
+      return true;
+    }
+
+    string_t user_id;
+    {
+      lock_guard<mutex> lock(session_shard.mutex_shard);
+      // Another request may have renewed or deleted it meanwhile.
+      if (!session_shard.sessions->GetLastActivityTime(session_key,
+                                                       &last_activity_time)) {
+        return false;
+      }
+      if (last_activity_time + kSessionAliveTime > now) {
+        return true;
+      }
+      session_shard.sessions->Erase(session_key, &user_id);
+    }
+    RemoveUserMapping(user_id, session_key);
+    return false;
+  }
+
+  bool SessionManager::SaveSessions(const string_t& snapshot_file_name) {
+    vector<Session> sessions;
+    for (auto& session_shard : session_shards_) {
+      session_shard.sessions->GetSessions(&sessions);
+    }
+    return SessionSnapshot::Save(snapshot_file_name, sessions);
+  }
+
+  void SessionManager::RestoreSessions(const vector<Session>& sessions,
+                                       time_t now) {
+    for (const auto& session : sessions) {
+      SessionKey session_key;
+      if (session.last_activity_time + kSessionAliveTime <= now ||
+          !SessionKey::FromString(session.session_id, &session_key)) {
+        continue;
+      }
+      UserShard& user_shard = GetUserShard(session.user_id);
+      lock_guard<mutex> user_lock(user_shard.mutex_shard);
+      // The user is only added once a session of the user is inserted, so
+      // a skipped session leaves no empty entry behind.
+      auto user_it = user_shard.user_id_to_session_keys.find(session.user_id);
+      if (user_it != user_shard.user_id_to_session_keys.end() &&
+          user_it->second.size() >= kMaxSessionsPerUser) {
+        continue;
+      }
+      SessionShard& session_shard = GetSessionShard(session_key);
+      lock_guard<mutex> session_lock(session_shard.mutex_shard);
+      if (!session_shard.sessions->Insert(session_key, session.user_id,
+                                          session.last_activity_time)) {
+        continue;
+      }
+      if (!lazy_expiry_) {
+        session_shard.session_expire_wheel.Schedule(
+            session_key, session.last_activity_time + kSessionAliveTime);
+      }
+      if (user_it == user_shard.user_id_to_session_keys.end()) {
+        user_it = user_shard.user_id_to_session_keys
+                      .emplace(session.user_id, UserSessionSet())
+                      .first;
+      }
+      user_it->second.Add(session_key);
+    }
+  }
+
+  SessionManager::SessionMode SessionManager::session_mode() const {
+    return session_mode_;
+  }
+
+  void SessionManager::RevokeUserTokens(const string_t& user_id, time_t now) {
+    lock_guard<mutex> lock(mutex_user_logout_times_);
+    // Logouts everywhere are rare, so the whole map is swept here.
+    for (auto logout_it = user_logout_times_.begin();
+         logout_it != user_logout_times_.end();) {
+      if (logout_it->second + kSignedTokenLifetime < now) {
+        logout_it = user_logout_times_.erase(logout_it);
+      } else {
+        ++logout_it;
+      }
+    }
+    user_logout_times_[user_id] = now;
+    user_logout_count_.store(user_logout_times_.size());
+  }
+
+  bool SessionManager::IsIssuedAfterUserLogout(const string_t& user_id,
+                                               time_t expire_time) {
+    if (user_logout_count_.load() == 0) {
+      return true;
+    }
+    lock_guard<mutex> lock(mutex_user_logout_times_);
+    const auto logout_it = user_logout_times_.find(user_id);
+    return logout_it == user_logout_times_.end() ||
+           expire_time - kSignedTokenLifetime > logout_it->second;
+  }
+
+  bool SessionManager::VerifyToken(const string_t& token,
+                                   string_t* out_user_id,
+                                   time_t* out_expire_time,
+                                   uint64_t* out_token_mac) {
+    string_t user_id;
+    time_t expire_time;
+    uint64_t token_mac;
+    if (!token_signer_->Verify(token, CoarseClock::GetInstance().Now(),
+                               &user_id, &expire_time, &token_mac)) {
+      return false;
+    }
+    if (token_revocation_set_.IsRevoked(token_mac) ||
+        !IsIssuedAfterUserLogout(user_id, expire_time)) {
+      return false;
+    }
+    if (out_user_id != nullptr) {
+      *out_user_id = move(user_id);
+    }
+    if (out_expire_time != nullptr) {
+      *out_expire_time = expire_time;
+    }
+    if (out_token_mac != nullptr) {
+      *out_token_mac = token_mac;
+    }
+    return true;
+  }
+
+  SessionManager::SessionShard& SessionManager::GetSessionShard(
+      const SessionKey& session_key) {
+    return session_shards_[session_key.Hash() % kSessionShardCount];
+  }
+
+  SessionManager::UserShard& SessionManager::GetUserShard(
+      const string_t& user_id) {
+    return user_shards_[hash<string_t>{}(user_id) % kSessionShardCount];
+  }
+
+  void SessionManager::RemoveUserMapping(const string_t& user_id,
+                                         const SessionKey& session_key) {
+    UserShard& user_shard = GetUserShard(user_id);
+    lock_guard<mutex> lock(user_shard.mutex_shard);
+    const auto user_it = user_shard.user_id_to_session_keys.find(user_id);
+    if (user_it == user_shard.user_id_to_session_keys.end()) {
+      return;
+    }
+    user_it->second.Remove(session_key);
+    if (user_it->second.empty()) {
+      user_shard.user_id_to_session_keys.erase(user_it);
+    }
+  }
+
+  void SessionManager::EvictLeastRecentSession(
+      UserSessionSet* user_sessions) {
+    // A key whose session is already gone is removed first.
+    size_t evict_index = 0;
+    time_t evict_activity_time = 0;
+    for (size_t i = 0; i < user_sessions->size(); ++i) {
+      time_t last_activity_time;
+      if (!GetSessionShard((*user_sessions)[i]).sessions->GetLastActivityTime(
+              (*user_sessions)[i], &last_activity_time)) {
+        evict_index = i;
+        break;
+      }
+      if (i == 0 || last_activity_time < evict_activity_time) {
+        evict_index = i;
+        evict_activity_time = last_activity_time;
+      }
+    }
+
+    const SessionKey session_key = (*user_sessions)[evict_index];
+    {
+      SessionShard& session_shard = GetSessionShard(session_key);
+      lock_guard<mutex> lock(session_shard.mutex_shard);
+      if (session_shard.sessions->Erase(session_key, nullptr)) {
+        session_shard.session_expire_wheel.Cancel(session_key);
+      }
+    }
+    user_sessions->Remove(session_key);
   }
 
 } // namespace chatserver
@@ -5,18 +5,69 @@
 #ifndef CHATSERVER_SESSIONMANAGER_H_
 #define CHATSERVER_SESSIONMANAGER_H_
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
 #include <future>
 #include <map>
+#include <memory>
 #include <mutex>
-#include <random>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "cpprest/details/basic_types.h"
+#include "epoch_reclaimer.h"
 #include "session.h"
+#include "session_snapshot.h"
+#include "session_table.h"
+#include "session_token.h"
+#include "timing_wheel.h"
+#include "token_revocation_set.h"
+#include "user_session_set.h"
 
 // This class is designed to manage a session for each connected account.
 // A session should be established after each account logins. If there is no
 // activity during the specified alive time, a session is deleted automatically.
-// All functions that access session_ have guarded with a mutex lock.
+// Expire times are kept in a hierarchical timing wheel, so the expire thread
+// touches only the sessions whose slot comes due.
+//
+// Checking, renewing and reading a session take no lock: sessions are kept
+// in a lock-free SessionTable and renewing is a relaxed atomic store of the
+// last activity time. The wheel is not updated on renewal. When the slot of a
+// renewed session comes due, the session is scheduled again from its last
+// activity time instead of being deleted.
+//
+// A user can have up to kMaxSessionsPerUser sessions, one for each device.
+// The session keys of a user are kept in a UserSessionSet, so logging out
+// everywhere and enforcing the limit touch only the sessions of that user.
+// When the limit is reached, the least recently active session is deleted.
+//
+// Sessions are split into kSessionShardCount shards by the hash of the
+// session ID, and user IDs into as many shards by the hash of the user ID.
+// Each shard has its own mutex for creating and deleting sessions. A
+// function locks at most one user shard and then one session shard, always
+// in this order.
+//
+// With EnableLazyExpiry, no expire thread runs and the wheel is not used.
+// A lookup that finds an expired session deletes it, and every CreateSession
+// sweeps kLazySweepSlotCount slots of one session shard, so idle sessions
+// are deleted at a bounded cost per login and an idle server never wakes up.
+//
+// Sessions can be kept across restarts: EnableSessionSnapshot loads a
+// snapshot file (SessionSnapshot), and the expire thread saves it every
+// kSessionSnapshotInterval and once more when the manager is destroyed.
+// Sessions that expired while the server was down are dropped on load.
+//
+// In kSignedToken mode no session is stored. CreateSession issues a signed
+// token (SessionTokenSigner) carrying the user ID and an expire time, and a
+// session is checked by verifying the token. Servers sharing the token secret
+// accept each other's tokens. A token lives kSignedTokenLifetime from its
+// creation; activity does not extend it. DeleteSession (logout) puts the
+// token into a TokenRevocationSet until it expires, and DeleteUserSessions
+// rejects the tokens of the user issued up to then. Both revocations are
+// in-process: another server sharing the secret accepts a revoked token
+// until it expires, so the lifetime is kept short.
 //
 // Example:
 //   SessionManager session_manager;
@@ -43,49 +94,219 @@ namespace chatserver {
 
   class SessionManager {
    public:
-    // Close the thread for the session expire when the class is ended.
+    // Maximum number of sessions of a user.
+    static const size_t kMaxSessionsPerUser = 8;
+
+    // Where sessions are kept.
+    enum SessionMode {
+      // Random session IDs in the session tables.
+      kStoredSession,
+      // Signed tokens verified by computation.
+      kSignedToken
+    };
+
+    // Keep sessions in the session tables.
     SessionManager();
 
+    // Keep sessions in the given mode. token_secret is the MAC key of
+    // kSignedToken mode. Servers validating each other's tokens must share
+    // it; an empty secret makes tokens valid in this process only.
+    SessionManager(SessionMode session_mode, const std::string& token_secret);
+
     // Close the thread for the session expire when the class is ended.
     ~SessionManager();
 
     // Check the given session ID exists.
     bool IsExistSessionId(utility::string_t session_id);
 
-    // Create a session ID for a given user ID.
-    // If the user ID has session, renew session alive time.
+    // Create a new session for a given user ID. If the user already has
+    // kMaxSessionsPerUser sessions, the least recently active one is deleted.
     Session CreateSession(utility::string_t user_id);
 
     // Delete the given session with session_id.
     bool DeleteSession(utility::string_t session_id);
 
+    // Delete every session of the user (logout everywhere). Return the
+    // number of deleted sessions. Tokens cannot be listed or counted, so in
+    // kSignedToken mode it rejects every token of the user issued up to now,
+    // including in the current second, and returns 0.
+    size_t DeleteUserSessions(const utility::string_t& user_id);
+
+    // Where sessions are kept.
+    SessionMode session_mode() const;
+
     // Update the last alive time for the session with a given session_id.
     bool RenewLastActivityTime(utility::string_t session_id);
 
+    // Same as above with the characters of the session ID. The ID is copied
+    // into a string only in kSignedToken mode.
+    bool RenewLastActivityTime(const char* session_id, size_t size);
+
     // Get the user ID corresponding to the given session ID.
     // Return false If the given ID has no session.
     bool GetUserIDFromSessionId(utility::string_t session_id, 
                                 utility::string_t* out_user_id);
 
     // Execute thread that deletes sessions that are over alive time.
+    // It does nothing in lazy expiry mode.
     void RunSessionExpireThread();
+
+    // Delete expired sessions on lookup and on login instead of in the
+    // expire thread. Call it before any session is created. Snapshots are
+    // then saved only when the manager is destroyed.
+    void EnableLazyExpiry();
+
+    // Load the sessions of the snapshot file and save them into it
+    // periodically from now on. Call it before RunSessionExpireThread.
+    // Return false if no session could be loaded from the file.
+    bool EnableSessionSnapshot(const utility::string_t& snapshot_file_name);
     
    private:
-    // Create session id of length kSessionLength using alphabet and number.
-    const utility::string_t GenerateSessionId();
+    // Creates sessions at a given time in tests of expiry.
+    friend class SessionManagerTestPeer;
+
+    // Create a session as if the user logged in at now.
+    Session CreateSession(utility::string_t user_id, std::time_t now);
+
+    // Create session key of length kSessionLength using alphabet and number.
+    // Each thread has its own generator, so no lock is taken.
+    static SessionKey GenerateSessionKey();
+
+    // Delete the sessions whose expire time passed until now.
+    void ExpireSessions(std::time_t now);
+
+    // Delete the expired sessions in the next kLazySweepSlotCount slots of
+    // the next session shard.
+    void SweepSessions(std::time_t now);
+
+    // Update the last alive time for the session of the key.
+    bool RenewSessionKey(const SessionKey& session_key);
+
+    // Check the session exists and delete it if it expired at now. Return
+    // true if the session is alive. Lazy expiry mode only.
+    bool CheckLazyExpiry(const SessionKey& session_key, std::time_t now);
+
+    // Save every session into the snapshot file.
+    bool SaveSessions(const utility::string_t& snapshot_file_name);
+
+    // Add the sessions that have not expired at now.
+    void RestoreSessions(const std::vector<Session>& sessions,
+                         std::time_t now);
+
+    // Reject every token of the user issued up to now. Drop the entries of
+    // users whose revoked tokens have expired.
+    void RevokeUserTokens(const utility::string_t& user_id, std::time_t now);
+
+    // Check the token was issued after the last logout everywhere of its
+    // user.
+    bool IsIssuedAfterUserLogout(const utility::string_t& user_id,
+                                 std::time_t expire_time);
+
+    // Check the token is signed, unexpired and not revoked. Output
+    // parameters are the same as SessionTokenSigner::Verify.
+    bool VerifyToken(const utility::string_t& token,
+                     utility::string_t* out_user_id,
+                     std::time_t* out_expire_time,
+                     uint64_t* out_token_mac);
+
+    // Number of session shards and user shards.
+    static const size_t kSessionShardCount = 16;
+
+    // Partition of sessions by hash(session_id).
+    struct SessionShard {
+      SessionShard();
+
+      // Store session information. Read without a lock, written under
+      // mutex_shard.
+      std::unique_ptr<SessionTable> sessions;
+
+      // Expire times of sessions: <session_id, expire time>
+      // An expire time can be earlier than the renewed one.
+      TimingWheel session_expire_wheel;
+
+      // Next slot of sessions to sweep in lazy expiry mode.
+      size_t sweep_slot;
+
+      // Mutex for member variables: writes of sessions, session_expire_wheel,
+      // sweep_slot
+      std::mutex mutex_shard;
+    };
+
+    // Partition of users by hash(user_id).
+    struct UserShard {
+      // Store session keys of each user <user_id, session keys>
+      // A key can point to a session that has just been deleted until
+      // RemoveUserMapping removes it.
+      std::map<utility::string_t, UserSessionSet> user_id_to_session_keys;
+
+      // Mutex for member variable: user_id_to_session_keys
+      std::mutex mutex_shard;
+    };
+
+    // Get the shard the given session ID belongs to.
+    SessionShard& GetSessionShard(const SessionKey& session_key);
+
+    // Get the shard the given user ID belongs to.
+    UserShard& GetUserShard(const utility::string_t& user_id);
+
+    // Delete the least recently active session of the user. The user shard
+    // of the user must be locked.
+    void EvictLeastRecentSession(UserSessionSet* user_sessions);
+
+    // Remove session_key from the session keys of the user ID.
+    void RemoveUserMapping(const utility::string_t& user_id,
+                           const SessionKey& session_key);
+
+    // Where sessions are kept.
+    const SessionMode session_mode_;
+
+    // Expired sessions are deleted on lookup and on login.
+    std::atomic<bool> lazy_expiry_;
+
+    // Next session shard to sweep in lazy expiry mode.
+    std::atomic<size_t> next_sweep_shard_;
+
+    // Issues and verifies tokens in kSignedToken mode, nullptr otherwise.
+    std::unique_ptr<SessionTokenSigner> token_signer_;
+
+    // Logged out tokens in kSignedToken mode.
+    TokenRevocationSet token_revocation_set_;
+
+    // Time of the last logout everywhere of each user in kSignedToken mode.
+    // Tokens of the user issued up to then are rejected. An entry is
+    // dropped once those tokens have expired.
+    std::map<utility::string_t, std::time_t> user_logout_times_;
+
+    // Number of entries of user_logout_times_. Read without the lock.
+    std::atomic<size_t> user_logout_count_;
+
+    // Mutex for member variables: user_logout_times_, user_logout_count_
+    std::mutex mutex_user_logout_times_;
+
+    // Frees sessions removed from the session tables. It is declared
+    // before the shards to outlive them.
+    EpochReclaimer session_reclaimer_;
+
+    // Session shards.
+    std::array<SessionShard, kSessionShardCount> session_shards_;
+
+    // User shards.
+    std::array<UserShard, kSessionShardCount> user_shards_;
+
+    // Mutex for member variables: stop_expire_thread_, snapshot_file_name_
+    std::mutex mutex_expire_thread_;
 
-    // Store session information <session_id, Session>
-    std::map<utility::string_t, Session> sessions_;
+    // Snapshot file of the sessions. Empty if snapshots are disabled.
+    utility::string_t snapshot_file_name_;
 
-    // Store user_id mapping with session_id <user_id, session_id>
-    std::map<utility::string_t, utility::string_t> user_id_to_session_id_;
+    // Wake up the expire thread to stop.
+    std::condition_variable expire_thread_condition_;
 
-    // Mutex for member variables: sessions_, user_id_to_session_id_
-    std::mutex mutex_sessions_;
+    // Ask the expire thread to stop.
+    bool stop_expire_thread_;
 
-    // Internal members to generate randomized identifiers.
-    std::mt19937 rand_;
-    std::uniform_int_distribution<> session_generator_;
+    // Thread that deletes expired sessions every kSessionCheckInterval.
+    std::thread expire_thread_;
   };
 
 } // namespace chatserver
@@ -0,0 +1,340 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "session_snapshot.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "cpprest/asyncrt_utils.h"
+#include "spdlog/spdlog.h"
+
+using namespace std;
+using ::utility::conversions::to_string_t;
+using ::utility::conversions::to_utf8string;
+using ::utility::string_t;
+using ::spdlog::error;
+
+namespace chatserver {
+
+  // Magic number at the start of a snapshot file.
+  const char kSnapshotMagic[4] = {'C', 'S', 'S', 'N'};
+  // Version of the snapshot file format.
+  const uint32_t kSnapshotVersion = 1;
+  // Suffix of the temporary file written before the rename.
+  const string_t kTemporarySuffix = UU(".tmp");
+  // FNV-1a 64-bit parameters of the checksum.
+  const uint64_t kChecksumOffset = 0xCBF29CE484222325ULL;
+  const uint64_t kChecksumPrime = 0x100000001B3ULL;
+
+  namespace {
+
+    struct SnapshotHeader {
+      char magic[4];
+      uint32_t version;
+      uint32_t record_count;
+      uint32_t reserved;
+      uint64_t checksum;
+    };
+
+    // Session in the form it is saved.
+    struct SnapshotRecord {
+      SessionKey session_key;
+      int64_t last_activity_time;
+      string user_id;
+    };
+
+    // Size of a record without the user ID.
+    const size_t kRecordFixedSize =
+        SessionKey::kLength + sizeof(int64_t) + sizeof(uint32_t);
+
+    uint64_t Checksum(const unsigned char* data, size_t size) {
+      uint64_t checksum = kChecksumOffset;
+      for (size_t i = 0; i < size; ++i) {
+        checksum = (checksum ^ data[i]) * kChecksumPrime;
+      }
+      return checksum;
+    }
+
+    // File mapped into memory. It is unmapped when the object is destroyed.
+    class MappedFile {
+     public:
+      MappedFile() : data_(nullptr), size_(0) {
+#ifdef _WIN32
+        file_ = INVALID_HANDLE_VALUE;
+        mapping_ = nullptr;
+#else
+        file_ = -1;
+#endif
+      }
+
+      ~MappedFile() {
+        Close();
+      }
+
+      // Create the file with the given size and map it for writing.
+      bool Create(const string_t& file_name, size_t size) {
+#ifdef _WIN32
+        file_ = CreateFileW(file_name.c_str(), GENERIC_READ | GENERIC_WRITE,
+                            0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) {
+          return false;
+        }
+        const uint64_t mapping_size = size;
+        mapping_ = CreateFileMappingW(
+            file_, nullptr, PAGE_READWRITE,
+            static_cast<DWORD>(mapping_size >> 32),
+            static_cast<DWORD>(mapping_size & 0xFFFFFFFF), nullptr);
+        if (mapping_ == nullptr) {
+          return false;
+        }
+        data_ = static_cast<unsigned char*>(
+            MapViewOfFile(mapping_, FILE_MAP_WRITE, 0, 0, size));
+#else
+        file_ = open(to_utf8string(file_name).c_str(),
+                     O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (file_ < 0 || ftruncate(file_, static_cast<off_t>(size)) != 0) {
+          return false;
+        }
+        void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                          file_, 0);
+        data_ = data == MAP_FAILED ? nullptr
+                                   : static_cast<unsigned char*>(data);
+#endif
+        size_ = size;
+        return data_ != nullptr;
+      }
+
+      // Map the existing file for reading.
+      bool Open(const string_t& file_name) {
+#ifdef _WIN32
+        file_ = CreateFileW(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+        LARGE_INTEGER file_size;
+        if (file_ == INVALID_HANDLE_VALUE ||
+            !GetFileSizeEx(file_, &file_size) || file_size.QuadPart == 0) {
+          return false;
+        }
+        mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0,
+                                      nullptr);
+        if (mapping_ == nullptr) {
+          return false;
+        }
+        size_ = static_cast<size_t>(file_size.QuadPart);
+        data_ = static_cast<unsigned char*>(
+            MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+#else
+        file_ = open(to_utf8string(file_name).c_str(), O_RDONLY);
+        struct stat file_stat;
+        if (file_ < 0 || fstat(file_, &file_stat) != 0 ||
+            file_stat.st_size == 0) {
+          return false;
+        }
+        size_ = static_cast<size_t>(file_stat.st_size);
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, file_, 0);
+        data_ = data == MAP_FAILED ? nullptr
+                                   : static_cast<unsigned char*>(data);
+#endif
+        return data_ != nullptr;
+      }
+
+      // Write the mapped pages to the disk.
+      bool Flush() {
+#ifdef _WIN32
+        return FlushViewOfFile(data_, size_) && FlushFileBuffers(file_);
+#else
+        return msync(data_, size_, MS_SYNC) == 0;
+#endif
+      }
+
+      void Close() {
+#ifdef _WIN32
+        if (data_ != nullptr) {
+          UnmapViewOfFile(data_);
+        }
+        if (mapping_ != nullptr) {
+          CloseHandle(mapping_);
+        }
+        if (file_ != INVALID_HANDLE_VALUE) {
+          CloseHandle(file_);
+        }
+        file_ = INVALID_HANDLE_VALUE;
+        mapping_ = nullptr;
+#else
+        if (data_ != nullptr) {
+          munmap(data_, size_);
+        }
+        if (file_ >= 0) {
+          close(file_);
+        }
+        file_ = -1;
+#endif
+        data_ = nullptr;
+        size_ = 0;
+      }
+
+      unsigned char* data() const { return data_; }
+      size_t size() const { return size_; }
+
+     private:
+#ifdef _WIN32
+      HANDLE file_;
+      HANDLE mapping_;
+#else
+      int file_;
+#endif
+      unsigned char* data_;
+      size_t size_;
+    };
+
+    // Replace the snapshot file by the temporary file.
+    bool MoveSnapshotFile(const string_t& temporary_file_name,
+                     const string_t& file_name) {
+#ifdef _WIN32
+      return MoveFileExW(temporary_file_name.c_str(), file_name.c_str(),
+                         MOVEFILE_REPLACE_EXISTING |
+                             MOVEFILE_WRITE_THROUGH) != 0;
+#else
+      return rename(to_utf8string(temporary_file_name).c_str(),
+                    to_utf8string(file_name).c_str()) == 0;
+#endif
+    }
+
+  } // namespace
+
+  bool SessionSnapshot::Save(const string_t& file_name,
+                             const vector<Session>& sessions) {
+    vector<SnapshotRecord> records;
+    records.reserve(sessions.size());
+    size_t file_size = sizeof(SnapshotHeader);
+    for (const auto& session : sessions) {
+      SnapshotRecord record;
+      if (!SessionKey::FromString(session.session_id, &record.session_key)) {
+        continue;
+      }
+      record.last_activity_time = session.last_activity_time;
+      record.user_id = to_utf8string(session.user_id);
+      file_size += kRecordFixedSize + record.user_id.size();
+      records.push_back(move(record));
+    }
+
+    const string_t temporary_file_name = file_name + kTemporarySuffix;
+    {
+      MappedFile mapped_file;
+      if (!mapped_file.Create(temporary_file_name, file_size)) {
+        error("Can't create session snapshot: {}",
+              to_utf8string(temporary_file_name));
+        return false;
+      }
+
+      unsigned char* position = mapped_file.data() + sizeof(SnapshotHeader);
+      for (const auto& record : records) {
+        const uint32_t user_id_size =
+            static_cast<uint32_t>(record.user_id.size());
+        memcpy(position, record.session_key.bytes, SessionKey::kLength);
+        position += SessionKey::kLength;
+        memcpy(position, &record.last_activity_time,
+               sizeof(record.last_activity_time));
+        position += sizeof(record.last_activity_time);
+        memcpy(position, &user_id_size, sizeof(user_id_size));
+        position += sizeof(user_id_size);
+        memcpy(position, record.user_id.data(), user_id_size);
+        position += user_id_size;
+      }
+
+      SnapshotHeader header;
+      memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+      header.version = kSnapshotVersion;
+      header.record_count = static_cast<uint32_t>(records.size());
+      header.reserved = 0;
+      header.checksum =
+          Checksum(mapped_file.data() + sizeof(SnapshotHeader),
+                   file_size - sizeof(SnapshotHeader));
+      memcpy(mapped_file.data(), &header, sizeof(header));
+
+      if (!mapped_file.Flush()) {
+        error("Can't flush session snapshot: {}",
+              to_utf8string(temporary_file_name));
+        return false;
+      }
+    }
+
+    if (!MoveSnapshotFile(temporary_file_name, file_name)) {
+      error("Can't replace session snapshot: {}", to_utf8string(file_name));
+      return false;
+    }
+    return true;
+  }
+
+  bool SessionSnapshot::Load(const string_t& file_name,
+                             vector<Session>* out_sessions) {
+    MappedFile mapped_file;
+    if (!mapped_file.Open(file_name)) {
+      return false;
+    }
+
+    SnapshotHeader header;
+    if (mapped_file.size() < sizeof(header)) {
+      error("Session snapshot is too short: {}", to_utf8string(file_name));
+      return false;
+    }
+    memcpy(&header, mapped_file.data(), sizeof(header));
+    if (memcmp(header.magic, kSnapshotMagic, sizeof(header.magic)) != 0 ||
+        header.version != kSnapshotVersion ||
+        header.checksum !=
+            Checksum(mapped_file.data() + sizeof(header),
+                     mapped_file.size() - sizeof(header))) {
+      error("Session snapshot is damaged: {}", to_utf8string(file_name));
+      return false;
+    }
+
+    vector<Session> sessions;
+    sessions.reserve(header.record_count);
+    const unsigned char* position = mapped_file.data() + sizeof(header);
+    const unsigned char* end = mapped_file.data() + mapped_file.size();
+    for (uint32_t i = 0; i < header.record_count; ++i) {
+      if (static_cast<size_t>(end - position) < kRecordFixedSize) {
+        error("Session snapshot is damaged: {}", to_utf8string(file_name));
+        return false;
+      }
+      SessionKey session_key;
+      int64_t last_activity_time;
+      uint32_t user_id_size;
+      memcpy(session_key.bytes, position, SessionKey::kLength);
+      position += SessionKey::kLength;
+      memcpy(&last_activity_time, position, sizeof(last_activity_time));
+      position += sizeof(last_activity_time);
+      memcpy(&user_id_size, position, sizeof(user_id_size));
+      position += sizeof(user_id_size);
+      if (static_cast<size_t>(end - position) < user_id_size) {
+        error("Session snapshot is damaged: {}", to_utf8string(file_name));
+        return false;
+      }
+
+      Session session;
+      session.session_id = session_key.ToString();
+      session.user_id = to_string_t(
+          string(reinterpret_cast<const char*>(position), user_id_size));
+      session.last_activity_time = static_cast<time_t>(last_activity_time);
+      sessions.push_back(session);
+      position += user_id_size;
+    }
+    out_sessions->swap(sessions);
+    return true;
+  }
+
+} // namespace chatserver
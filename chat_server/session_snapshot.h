@@ -0,0 +1,44 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_SESSIONSNAPSHOT_H_
+#define CHATSERVER_SESSIONSNAPSHOT_H_
+
+#include <vector>
+
+#include "cpprest/details/basic_types.h"
+#include "session.h"
+
+// This class is designed to save sessions into a snapshot file and load them
+// back, so that a restarted server keeps its users logged in.
+// The file is written through a memory mapping into a temporary file, which
+// is flushed and then renamed over the snapshot file. A crash while saving
+// leaves the previous snapshot intact. A checksum rejects damaged files.
+// File format (native byte order):
+//   header: "CSSN", version, record count, reserved, checksum of records
+//   record: session ID (32 bytes), last activity time (int64),
+//           user ID size (uint32), user ID (UTF-8)
+// Example:
+//   vector<Session> sessions;
+//   SessionSnapshot::Save(UU("sessions.snapshot"), sessions);
+//   SessionSnapshot::Load(UU("sessions.snapshot"), &sessions);
+
+namespace chatserver {
+
+  class SessionSnapshot {
+   public:
+    // Save the sessions into the snapshot file. Sessions whose ID is not a
+    // SessionKey are skipped.
+    static bool Save(const utility::string_t& file_name,
+                     const std::vector<Session>& sessions);
+
+    // Load the sessions of the snapshot file. Return false if the file does
+    // not exist or is damaged.
+    static bool Load(const utility::string_t& file_name,
+                     std::vector<Session>* out_sessions);
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_SESSIONSNAPSHOT_H_ // CHATSERVER_SESSIONSNAPSHOT_H_
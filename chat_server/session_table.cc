@@ -0,0 +1,244 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "session_table.h"
+
+#include <algorithm>
+
+using namespace std;
+using ::utility::string_t;
+
+namespace chatserver {
+
+  // Size of the first slot array (2^kInitialCapacityBits).
+  const int kInitialCapacityBits = 4;
+  // Fibonacci hashing multiplier. It spreads every bit of the hash over the
+  // slot index, since the session shard is chosen by the low bits.
+  const uint64_t kHashMultiplier = 0x9E3779B97F4A7C15ULL;
+
+  SessionTable::Record* const SessionTable::kTombstone =
+      reinterpret_cast<SessionTable::Record*>(uintptr_t(1));
+
+  SessionTable::Buckets::Buckets(int capacity_bits)
+      : capacity_bits(capacity_bits),
+        capacity(size_t(1) << capacity_bits),
+        slots(new atomic<Record*>[size_t(1) << capacity_bits]) {
+    for (size_t i = 0; i < capacity; ++i) {
+      slots[i].store(nullptr, memory_order_relaxed);
+    }
+  }
+
+  SessionTable::SessionTable(EpochReclaimer* epoch_reclaimer)
+      : epoch_reclaimer_(epoch_reclaimer),
+        buckets_(new Buckets(kInitialCapacityBits)),
+        record_count_(0),
+        used_slot_count_(0) {
+  }
+
+  SessionTable::~SessionTable() {
+    Buckets* buckets = buckets_.load();
+    for (size_t i = 0; i < buckets->capacity; ++i) {
+      Record* record = buckets->slots[i].load();
+      if (record != kTombstone) {
+        delete record;
+      }
+    }
+    delete buckets;
+  }
+
+  bool SessionTable::Contains(const SessionKey& session_key) {
+    EpochReclaimer::ReadGuard guard(epoch_reclaimer_);
+    return Find(session_key) != nullptr;
+  }
+
+  bool SessionTable::Touch(const SessionKey& session_key, time_t now) {
+    EpochReclaimer::ReadGuard guard(epoch_reclaimer_);
+    Record* record = Find(session_key);
+    if (record == nullptr) {
+      return false;
+    }
+    // Readers of the time need no ordering with other data. Renewals within
+    // the same clock tick skip the store, so the cache line of a busy
+    // session is not written by every request.
+    if (record->last_activity_time.load(memory_order_relaxed) < now) {
+      record->last_activity_time.store(now, memory_order_relaxed);
+    }
+    return true;
+  }
+
+  bool SessionTable::GetUserId(const SessionKey& session_key,
+                               string_t* out_user_id) {
+    EpochReclaimer::ReadGuard guard(epoch_reclaimer_);
+    const Record* record = Find(session_key);
+    if (record == nullptr) {
+      return false;
+    }
+    if (out_user_id != nullptr) {
+      *out_user_id = record->user_id;
+    }
+    return true;
+  }
+
+  bool SessionTable::GetLastActivityTime(const SessionKey& session_key,
+                                         time_t* out_last_activity_time) {
+    EpochReclaimer::ReadGuard guard(epoch_reclaimer_);
+    const Record* record = Find(session_key);
+    if (record == nullptr) {
+      return false;
+    }
+    *out_last_activity_time =
+        record->last_activity_time.load(memory_order_relaxed);
+    return true;
+  }
+
+  void SessionTable::GetSessions(vector<Session>* out_sessions) {
+    EpochReclaimer::ReadGuard guard(epoch_reclaimer_);
+    const Buckets* buckets = buckets_.load();
+    for (size_t i = 0; i < buckets->capacity; ++i) {
+      const Record* record = buckets->slots[i].load();
+      if (record == nullptr || record == kTombstone) {
+        continue;
+      }
+      Session session;
+      session.session_id = record->key.ToString();
+      session.user_id = record->user_id;
+      session.last_activity_time =
+          record->last_activity_time.load(memory_order_relaxed);
+      out_sessions->push_back(session);
+    }
+  }
+
+  void SessionTable::CollectIdleSessions(
+      size_t* slot_cursor, size_t slot_count, time_t idle_time,
+      vector<SessionKey>* out_session_keys) const {
+    const Buckets* buckets = buckets_.load();
+    slot_count = min(slot_count, buckets->capacity);
+    for (size_t i = 0; i < slot_count; ++i) {
+      const size_t slot = (*slot_cursor + i) & (buckets->capacity - 1);
+      const Record* record = buckets->slots[slot].load();
+      if (record != nullptr && record != kTombstone &&
+          record->last_activity_time.load(memory_order_relaxed) <=
+              idle_time) {
+        out_session_keys->push_back(record->key);
+      }
+    }
+    *slot_cursor = (*slot_cursor + slot_count) & (buckets->capacity - 1);
+  }
+
+  bool SessionTable::Insert(const SessionKey& session_key,
+                            const string_t& user_id,
+                            time_t last_activity_time) {
+    if (Find(session_key) != nullptr) {
+      return false;
+    }
+
+    // Keep the load under 3/4 so that probing always meets an empty slot.
+    Buckets* buckets = buckets_.load();
+    if ((used_slot_count_ + 1) * 4 > buckets->capacity * 3) {
+      int capacity_bits = kInitialCapacityBits;
+      while ((size_t(1) << capacity_bits) < (record_count_ + 1) * 2) {
+        ++capacity_bits;
+      }
+      Rehash(capacity_bits);
+      buckets = buckets_.load();
+    }
+
+    const size_t key_hash = session_key.Hash();
+    size_t slot = HomeSlot(*buckets, key_hash);
+    while (true) {
+      Record* record = buckets->slots[slot].load(memory_order_relaxed);
+      if (record == nullptr || record == kTombstone) {
+        if (record == nullptr) {
+          ++used_slot_count_;
+        }
+        break;
+      }
+      slot = (slot + 1) & (buckets->capacity - 1);
+    }
+    // The record is fully built before readers can see it.
+    buckets->slots[slot].store(new Record(session_key, key_hash, user_id,
+                                          last_activity_time));
+    ++record_count_;
+    return true;
+  }
+
+  bool SessionTable::Erase(const SessionKey& session_key,
+                           string_t* out_user_id) {
+    Buckets* buckets = buckets_.load();
+    const size_t slot = FindSlot(*buckets, session_key,
+                                 session_key.Hash());
+    if (slot == buckets->capacity) {
+      return false;
+    }
+    Record* record = buckets->slots[slot].load();
+    if (out_user_id != nullptr) {
+      *out_user_id = record->user_id;
+    }
+    buckets->slots[slot].store(kTombstone);
+    --record_count_;
+    epoch_reclaimer_->Retire([record] { delete record; });
+    return true;
+  }
+
+  size_t SessionTable::size() const {
+    return record_count_;
+  }
+
+  SessionTable::Record* SessionTable::Find(
+      const SessionKey& session_key) const {
+    const Buckets* buckets = buckets_.load();
+    const size_t slot = FindSlot(*buckets, session_key,
+                                 session_key.Hash());
+    if (slot == buckets->capacity) {
+      return nullptr;
+    }
+    return buckets->slots[slot].load();
+  }
+
+  size_t SessionTable::FindSlot(const Buckets& buckets,
+                                const SessionKey& session_key,
+                                size_t key_hash) const {
+    size_t slot = HomeSlot(buckets, key_hash);
+    for (size_t probe = 0; probe < buckets.capacity; ++probe) {
+      const Record* record = buckets.slots[slot].load();
+      if (record == nullptr) {
+        break;
+      }
+      if (record != kTombstone && record->hash == key_hash &&
+          record->key == session_key) {
+        return slot;
+      }
+      slot = (slot + 1) & (buckets.capacity - 1);
+    }
+    return buckets.capacity;
+  }
+
+  size_t SessionTable::HomeSlot(const Buckets& buckets,
+                                size_t key_hash) const {
+    return static_cast<size_t>((uint64_t(key_hash) * kHashMultiplier) >>
+                               (64 - buckets.capacity_bits));
+  }
+
+  void SessionTable::Rehash(int capacity_bits) {
+    Buckets* old_buckets = buckets_.load();
+    Buckets* new_buckets = new Buckets(capacity_bits);
+    for (size_t i = 0; i < old_buckets->capacity; ++i) {
+      Record* record = old_buckets->slots[i].load(memory_order_relaxed);
+      if (record == nullptr || record == kTombstone) {
+        continue;
+      }
+      size_t slot = HomeSlot(*new_buckets, record->hash);
+      while (new_buckets->slots[slot].load(memory_order_relaxed) != nullptr) {
+        slot = (slot + 1) & (new_buckets->capacity - 1);
+      }
+      new_buckets->slots[slot].store(record, memory_order_relaxed);
+    }
+    used_slot_count_ = record_count_;
+
+    // Records move to the new array. Only the old array is retired.
+    buckets_.store(new_buckets);
+    epoch_reclaimer_->Retire([old_buckets] { delete old_buckets; });
+  }
+
+} // namespace chatserver
@@ -0,0 +1,141 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_SESSIONTABLE_H_
+#define CHATSERVER_SESSIONTABLE_H_
+
+#include <atomic>
+#include <ctime>
+#include <memory>
+#include <vector>
+
+#include "cpprest/details/basic_types.h"
+#include "epoch_reclaimer.h"
+#include "session.h"
+
+// This class is designed to store sessions so that they can be read without
+// a lock. Sessions live in an open-addressing hash table (linear probing) of
+// atomic pointers to SessionRecord. Keys are fixed-width SessionKey values
+// compared with SIMD, so a probe reads one cache line per record. Readers
+// probe the table inside an epoch read guard, and a removed session or a
+// replaced table is freed by the EpochReclaimer once no reader can still see
+// it. Renewing the last activity time is a relaxed atomic store on the
+// session record.
+// Reading functions are lock-free and can be called from any thread. Writing
+// functions (Insert, Erase) must be serialized by the caller.
+// Example:
+//   EpochReclaimer epoch_reclaimer;
+//   SessionTable session_table(&epoch_reclaimer);
+//   Writer (holding the shard mutex):
+//     session_table.Insert(session_key, user_id, time(nullptr));
+//   Reader (any thread):
+//     if (session_table.Touch(session_key, time(nullptr))) {
+//       The session exists and is renewed.
+//     }
+
+namespace chatserver {
+
+  class SessionTable {
+   public:
+    // Retired records and tables are handed to epoch_reclaimer, which must
+    // outlive the table.
+    explicit SessionTable(EpochReclaimer* epoch_reclaimer);
+
+    // Free every record. No reader may be active.
+    ~SessionTable();
+
+    SessionTable(const SessionTable&) = delete;
+    SessionTable& operator=(const SessionTable&) = delete;
+
+    // Check the given session ID exists. Lock-free.
+    bool Contains(const SessionKey& session_key);
+
+    // Set the last activity time of the session to now, unless it is already
+    // now or later. Return false if the session does not exist. Lock-free.
+    bool Touch(const SessionKey& session_key, std::time_t now);
+
+    // Get the user ID of the session. Return false if the session does not
+    // exist. Lock-free.
+    bool GetUserId(const SessionKey& session_key,
+                   utility::string_t* out_user_id);
+
+    // Get the last activity time of the session. Return false if the session
+    // does not exist. Lock-free.
+    bool GetLastActivityTime(const SessionKey& session_key,
+                             std::time_t* out_last_activity_time);
+
+    // Append every session in the table to out_sessions. Sessions added or
+    // removed meanwhile may be missed. Lock-free.
+    void GetSessions(std::vector<Session>* out_sessions);
+
+    // Scan slot_count slots from *slot_cursor, wrapping around the table,
+    // and append the sessions last active at or before idle_time to
+    // out_session_keys. *slot_cursor moves past the scanned slots.
+    // Writers only.
+    void CollectIdleSessions(size_t* slot_cursor, size_t slot_count,
+                             std::time_t idle_time,
+                             std::vector<SessionKey>* out_session_keys) const;
+
+    // Add the session. Return false if the session ID already exists.
+    // Writers must be serialized.
+    bool Insert(const SessionKey& session_key,
+                const utility::string_t& user_id,
+                std::time_t last_activity_time);
+
+    // Remove the session and get its user ID; out_user_id can be nullptr.
+    // Return false if the session does not exist. Writers must be
+    // serialized.
+    bool Erase(const SessionKey& session_key,
+               utility::string_t* out_user_id);
+
+    // Number of sessions.
+    size_t size() const;
+
+   private:
+    // Only last_activity_time of a record changes after it is published.
+    typedef SessionRecord Record;
+
+    // Marks a slot whose record is removed. Probing continues past it.
+    static Record* const kTombstone;
+
+    // Slot array of the table. Its size is a power of two.
+    struct Buckets {
+      explicit Buckets(int capacity_bits);
+
+      const int capacity_bits;
+      const size_t capacity;
+      std::unique_ptr<std::atomic<Record*>[]> slots;
+    };
+
+    // Find the record of the session ID. The caller must be a writer or hold
+    // a read guard, and the record is valid as long as it does.
+    Record* Find(const SessionKey& session_key) const;
+
+    // Find the slot of the session ID. Return capacity if it is not found.
+    size_t FindSlot(const Buckets& buckets,
+                    const SessionKey& session_key,
+                    size_t key_hash) const;
+
+    // First slot to probe for the hash.
+    size_t HomeSlot(const Buckets& buckets, size_t key_hash) const;
+
+    // Replace the slot array by one with the given size, without tombstones.
+    void Rehash(int capacity_bits);
+
+    // Frees removed records and replaced slot arrays.
+    EpochReclaimer* epoch_reclaimer_;
+
+    // Current slot array.
+    std::atomic<Buckets*> buckets_;
+
+    // Number of records. Written by writers only.
+    size_t record_count_;
+
+    // Number of records and tombstones. Written by writers only.
+    size_t used_slot_count_;
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_SESSIONTABLE_H_ // CHATSERVER_SESSIONTABLE_H_
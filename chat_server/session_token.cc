@@ -0,0 +1,198 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "session_token.h"
+
+#include <random>
+
+#include "cpprest/asyncrt_utils.h"
+#include "spdlog/spdlog.h"
+
+using namespace std;
+using ::utility::conversions::to_string_t;
+using ::utility::conversions::to_utf8string;
+using ::utility::string_t;
+using ::spdlog::warn;
+
+namespace chatserver {
+
+  // Separator of the parts of a token.
+  const char kTokenSeparator = '.';
+  // Hexadecimal digits.
+  const char kHexDigits[] = "0123456789abcdef";
+  // Number of hexadecimal digits of a MAC.
+  const size_t kMacDigits = 16;
+  // Maximum number of digits of an expire time.
+  const size_t kMaxExpireTimeDigits = 18;
+  // Keys deriving the MAC key from a secret.
+  const uint64_t kDeriveKey0 = 0x0706050403020100ULL;
+  const uint64_t kDeriveKey1 = 0x0F0E0D0C0B0A0908ULL;
+
+  namespace {
+
+    uint64_t RotateLeft(uint64_t value, int bits) {
+      return (value << bits) | (value >> (64 - bits));
+    }
+
+    void SipRound(uint64_t* v0, uint64_t* v1, uint64_t* v2, uint64_t* v3) {
+      *v0 += *v1; *v1 = RotateLeft(*v1, 13); *v1 ^= *v0;
+      *v0 = RotateLeft(*v0, 32);
+      *v2 += *v3; *v3 = RotateLeft(*v3, 16); *v3 ^= *v2;
+      *v0 += *v3; *v3 = RotateLeft(*v3, 21); *v3 ^= *v0;
+      *v2 += *v1; *v1 = RotateLeft(*v1, 17); *v1 ^= *v2;
+      *v2 = RotateLeft(*v2, 32);
+    }
+
+    // SipHash-2-4 of data with the key (key0, key1).
+    uint64_t SipHash24(uint64_t key0, uint64_t key1, const string& data) {
+      uint64_t v0 = 0x736F6D6570736575ULL ^ key0;
+      uint64_t v1 = 0x646F72616E646F6DULL ^ key1;
+      uint64_t v2 = 0x6C7967656E657261ULL ^ key0;
+      uint64_t v3 = 0x7465646279746573ULL ^ key1;
+
+      const size_t size = data.size();
+      const size_t block_end = size - size % 8;
+      for (size_t i = 0; i < block_end; i += 8) {
+        uint64_t block = 0;
+        for (size_t j = 0; j < 8; ++j) {
+          block |= uint64_t(static_cast<unsigned char>(data[i + j]))
+                   << (8 * j);
+        }
+        v3 ^= block;
+        SipRound(&v0, &v1, &v2, &v3);
+        SipRound(&v0, &v1, &v2, &v3);
+        v0 ^= block;
+      }
+
+      uint64_t last_block = uint64_t(size) << 56;
+      for (size_t j = 0; j < size % 8; ++j) {
+        last_block |=
+            uint64_t(static_cast<unsigned char>(data[block_end + j]))
+            << (8 * j);
+      }
+      v3 ^= last_block;
+      SipRound(&v0, &v1, &v2, &v3);
+      SipRound(&v0, &v1, &v2, &v3);
+      v0 ^= last_block;
+
+      v2 ^= 0xFF;
+      for (int i = 0; i < 4; ++i) {
+        SipRound(&v0, &v1, &v2, &v3);
+      }
+      return v0 ^ v1 ^ v2 ^ v3;
+    }
+
+    // Value of a hexadecimal digit, or -1.
+    int HexValue(char digit) {
+      if (digit >= '0' && digit <= '9') {
+        return digit - '0';
+      }
+      if (digit >= 'a' && digit <= 'f') {
+        return digit - 'a' + 10;
+      }
+      return -1;
+    }
+
+  } // namespace
+
+  SessionTokenSigner::SessionTokenSigner(const string& secret) {
+    if (secret.empty()) {
+      warn("No session token secret, tokens are valid in this process only");
+      random_device random;
+      key0_ = (uint64_t(random()) << 32) | random();
+      key1_ = (uint64_t(random()) << 32) | random();
+      return;
+    }
+    key0_ = SipHash24(kDeriveKey0, kDeriveKey1, secret);
+    key1_ = SipHash24(kDeriveKey1, kDeriveKey0, secret);
+  }
+
+  string_t SessionTokenSigner::Issue(const string_t& user_id,
+                                     time_t expire_time) const {
+    string token;
+    for (const char character : to_utf8string(user_id)) {
+      const unsigned char byte = static_cast<unsigned char>(character);
+      token += kHexDigits[byte >> 4];
+      token += kHexDigits[byte & 0xF];
+    }
+    token += kTokenSeparator;
+    token += to_string(static_cast<int64_t>(expire_time));
+
+    const uint64_t mac = Mac(token);
+    token += kTokenSeparator;
+    for (int shift = 60; shift >= 0; shift -= 4) {
+      token += kHexDigits[(mac >> shift) & 0xF];
+    }
+    return to_string_t(token);
+  }
+
+  bool SessionTokenSigner::Verify(const string_t& token, time_t now,
+                                  string_t* out_user_id,
+                                  time_t* out_expire_time,
+                                  uint64_t* out_token_mac) const {
+    const string token_utf8 = to_utf8string(token);
+    const size_t user_end = token_utf8.find(kTokenSeparator);
+    if (user_end == string::npos || user_end % 2 != 0) {
+      return false;
+    }
+    const size_t expire_end = token_utf8.find(kTokenSeparator, user_end + 1);
+    if (expire_end == string::npos ||
+        expire_end - user_end - 1 > kMaxExpireTimeDigits ||
+        token_utf8.size() - expire_end - 1 != kMacDigits) {
+      return false;
+    }
+
+    // Expire time.
+    int64_t expire_time = 0;
+    for (size_t i = user_end + 1; i < expire_end; ++i) {
+      if (token_utf8[i] < '0' || token_utf8[i] > '9') {
+        return false;
+      }
+      expire_time = expire_time * 10 + (token_utf8[i] - '0');
+    }
+    if (expire_end == user_end + 1 || expire_time <= now) {
+      return false;
+    }
+
+    // MAC.
+    uint64_t token_mac = 0;
+    for (size_t i = expire_end + 1; i < token_utf8.size(); ++i) {
+      const int digit = HexValue(token_utf8[i]);
+      if (digit < 0) {
+        return false;
+      }
+      token_mac = (token_mac << 4) | static_cast<uint64_t>(digit);
+    }
+    if (token_mac != Mac(token_utf8.substr(0, expire_end))) {
+      return false;
+    }
+
+    // User ID.
+    string user_id;
+    for (size_t i = 0; i < user_end; i += 2) {
+      const int high = HexValue(token_utf8[i]);
+      const int low = HexValue(token_utf8[i + 1]);
+      if (high < 0 || low < 0) {
+        return false;
+      }
+      user_id += static_cast<char>((high << 4) | low);
+    }
+
+    if (out_user_id != nullptr) {
+      *out_user_id = to_string_t(user_id);
+    }
+    if (out_expire_time != nullptr) {
+      *out_expire_time = static_cast<time_t>(expire_time);
+    }
+    if (out_token_mac != nullptr) {
+      *out_token_mac = token_mac;
+    }
+    return true;
+  }
+
+  uint64_t SessionTokenSigner::Mac(const string& signed_part) const {
+    return SipHash24(key0_, key1_, signed_part);
+  }
+
+} // namespace chatserver
@@ -0,0 +1,63 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_SESSIONTOKEN_H_
+#define CHATSERVER_SESSIONTOKEN_H_
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+#include "cpprest/details/basic_types.h"
+
+// This class is designed to issue and verify self-contained session tokens.
+// A token carries the user ID, the expire time and a MAC (SipHash-2-4 keyed
+// by a secret) over both:
+//   hex(utf8(user_id)).expire_time.hex(mac)
+// Verifying a token is pure computation, so servers that share the secret
+// can verify each other's tokens without sharing memory.
+// The class is thread-safe.
+// Example:
+//   SessionTokenSigner token_signer("shared secret");
+//   string_t token = token_signer.Issue(UU("kaist"), time(nullptr) + 3600);
+//   string_t user_id;
+//   if (token_signer.Verify(token, time(nullptr), &user_id, nullptr,
+//                           nullptr)) {
+//     Valid token of user_id.
+//   }
+
+namespace chatserver {
+
+  class SessionTokenSigner {
+   public:
+    // Derive the MAC key from secret. An empty secret means a random key,
+    // valid only in this process.
+    explicit SessionTokenSigner(const std::string& secret);
+
+    // Issue a token of the user ID that expires at expire_time.
+    utility::string_t Issue(const utility::string_t& user_id,
+                            std::time_t expire_time) const;
+
+    // Check the token is well-formed, has a valid MAC and is not expired at
+    // now. Output parameters can be nullptr.
+    //  - out_user_id: User ID of the token.
+    //  - out_expire_time: Expire time of the token.
+    //  - out_token_mac: MAC of the token, which identifies the token.
+    bool Verify(const utility::string_t& token, std::time_t now,
+                utility::string_t* out_user_id,
+                std::time_t* out_expire_time,
+                uint64_t* out_token_mac) const;
+
+   private:
+    // MAC of the signed part of a token.
+    uint64_t Mac(const std::string& signed_part) const;
+
+    // SipHash key.
+    uint64_t key0_;
+    uint64_t key1_;
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_SESSIONTOKEN_H_ // CHATSERVER_SESSIONTOKEN_H_
@@ -0,0 +1,145 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "subscriber_queue.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+using ::utility::string_t;
+
+namespace chatserver {
+
+  SubscriberQueue::Metrics SubscriberQueue::Counters::Load() const {
+    Metrics metrics;
+    metrics.dropped_messages = dropped_messages.load();
+    metrics.gap_notices = gap_notices.load();
+    metrics.resync_notices = resync_notices.load();
+    metrics.disconnects = disconnects.load();
+    return metrics;
+  }
+
+  SubscriberQueue::SubscriberQueue(size_t capacity,
+                                   OverflowPolicy overflow_policy,
+                                   Counters* counters)
+      : message_count_(0),
+        capacity_(max(capacity, static_cast<size_t>(1))),
+        overflow_policy_(overflow_policy),
+        counters_(counters) {
+  }
+
+  bool SubscriberQueue::Push(const string_t& chat_room, uint64_t sequence,
+                             shared_ptr<const string> message) {
+    if (resync_rooms_.count(chat_room) != 0) {
+      // The subscriber reads the room again, this message included.
+      ++counters_->dropped_messages;
+      return true;
+    }
+    if (message_count_ >= capacity_) {
+      switch (overflow_policy_) {
+        case kDropOldest:
+          DropOldestMessage();
+          break;
+        case kResync:
+          DropAllMessages();
+          if (resync_rooms_.count(chat_room) != 0) {
+            ++counters_->dropped_messages;
+            return true;
+          }
+          break;
+        case kDisconnect:
+          ++counters_->disconnects;
+          return false;
+      }
+    }
+
+    Item item;
+    item.type = kMessageItem;
+    item.chat_room = chat_room;
+    item.sequence = sequence;
+    item.gap_begin = 0;
+    item.message = move(message);
+    items_.push_back(move(item));
+    ++message_count_;
+    return true;
+  }
+
+  bool SubscriberQueue::Pop(Item* out_item) {
+    if (items_.empty()) {
+      return false;
+    }
+    *out_item = move(items_.front());
+    items_.pop_front();
+    if (out_item->type == kMessageItem) {
+      --message_count_;
+    } else if (out_item->type == kResyncItem) {
+      resync_rooms_.erase(out_item->chat_room);
+    }
+    return true;
+  }
+
+  size_t SubscriberQueue::message_count() const {
+    return message_count_;
+  }
+
+  void SubscriberQueue::DropOldestMessage() {
+    // Gap items gather in front of the messages.
+    auto message_it = items_.begin();
+    while (message_it->type != kMessageItem) {
+      ++message_it;
+    }
+    ++counters_->dropped_messages;
+    --message_count_;
+
+    for (auto gap_it = items_.begin(); gap_it != message_it; ++gap_it) {
+      if (gap_it->type == kGapItem &&
+          gap_it->chat_room == message_it->chat_room &&
+          gap_it->sequence + 1 == message_it->sequence) {
+        gap_it->sequence = message_it->sequence;
+        items_.erase(message_it);
+        return;
+      }
+    }
+    ++counters_->gap_notices;
+    message_it->type = kGapItem;
+    message_it->gap_begin = message_it->sequence - 1;
+    message_it->message.reset();
+  }
+
+  void SubscriberQueue::DropAllMessages() {
+    vector<Item> resync_items;
+    for (const auto& item : items_) {
+      // Cursor before the first message of the item.
+      uint64_t cursor = item.sequence;
+      if (item.type == kMessageItem) {
+        cursor = item.sequence - 1;
+      } else if (item.type == kGapItem) {
+        cursor = item.gap_begin;
+      }
+      const auto resync_it = find_if(
+          resync_items.begin(), resync_items.end(),
+          [&](const Item& resync_item) {
+            return resync_item.chat_room == item.chat_room;
+          });
+      if (resync_it != resync_items.end()) {
+        resync_it->sequence = min(resync_it->sequence, cursor);
+        continue;
+      }
+      if (resync_rooms_.insert(item.chat_room).second) {
+        ++counters_->resync_notices;
+      }
+      Item resync_item;
+      resync_item.type = kResyncItem;
+      resync_item.chat_room = item.chat_room;
+      resync_item.sequence = cursor;
+      resync_item.gap_begin = 0;
+      resync_items.push_back(move(resync_item));
+    }
+    counters_->dropped_messages += message_count_;
+    message_count_ = 0;
+    items_.assign(resync_items.begin(), resync_items.end());
+  }
+
+} // namespace chatserver
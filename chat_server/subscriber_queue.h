@@ -0,0 +1,138 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_SUBSCRIBERQUEUE_H_
+#define CHATSERVER_SUBSCRIBERQUEUE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "cpprest/details/basic_types.h"
+
+// This class is designed to bound the pushed messages waiting for one slow
+// subscriber, so that the subscriber neither grows server memory nor stalls
+// the broadcaster. The messages are shared buffers, so a queued message
+// costs a pointer. When the queue is full, the overflow policy decides:
+//   kDropOldest: the oldest message is dropped, and a gap item tells the
+//                subscriber which cursors of its room it missed.
+//   kResync:     every queued message is dropped, and one resync item per
+//                room tells the subscriber to read the room again from a
+//                cursor. Messages of the room are dropped until then.
+//   kDisconnect: the message is refused and the subscriber must be closed.
+// Drops are counted in Counters shared by the queues of a server.
+// The class is not thread-safe.
+// Example:
+//   SubscriberQueue::Counters counters;
+//   SubscriberQueue subscriber_queue(256, SubscriberQueue::kResync,
+//                                    &counters);
+//   Broadcast:
+//     if (!subscriber_queue.Push(chat_room, sequence, message)) {
+//       Disconnect the subscriber.
+//     }
+//   The subscriber can take more:
+//     SubscriberQueue::Item item;
+//     while (subscriber_queue.Pop(&item)) {
+//       Send the item.
+//     }
+
+namespace chatserver {
+
+  class SubscriberQueue {
+   public:
+    // What to do when a message is pushed to a full queue.
+    enum OverflowPolicy { kDropOldest, kResync, kDisconnect };
+
+    // Type of a queued item.
+    enum ItemType {
+      // A pushed message.
+      kMessageItem,
+      // Messages dropped by kDropOldest.
+      kGapItem,
+      // Messages dropped by kResync.
+      kResyncItem
+    };
+
+    struct Item {
+      ItemType type;
+      utility::string_t chat_room;
+      // kMessageItem: cursor after the message. kGapItem: cursor after the
+      // last dropped message. kResyncItem: cursor to read the room from.
+      uint64_t sequence;
+      // kGapItem: cursor before the first dropped message.
+      uint64_t gap_begin;
+      // kMessageItem: the shared message.
+      std::shared_ptr<const std::string> message;
+    };
+
+    // Drop counters.
+    struct Metrics {
+      // Messages dropped by any policy.
+      uint64_t dropped_messages;
+
+      // Gap items made by kDropOldest.
+      uint64_t gap_notices;
+
+      // Resync items made by kResync.
+      uint64_t resync_notices;
+
+      // Subscribers refused by kDisconnect.
+      uint64_t disconnects;
+    };
+
+    // Counters shared by the queues of a server.
+    struct Counters {
+      std::atomic<uint64_t> dropped_messages{0};
+      std::atomic<uint64_t> gap_notices{0};
+      std::atomic<uint64_t> resync_notices{0};
+      std::atomic<uint64_t> disconnects{0};
+
+      Metrics Load() const;
+    };
+
+    // At most capacity messages are queued. counters must outlive the queue.
+    SubscriberQueue(size_t capacity, OverflowPolicy overflow_policy,
+                    Counters* counters);
+
+    // Queue the message of the chat room whose cursor after it is sequence.
+    // Return false if the queue is full and the policy is kDisconnect.
+    bool Push(const utility::string_t& chat_room, uint64_t sequence,
+              std::shared_ptr<const std::string> message);
+
+    // Take the first item. Return false if the queue is empty.
+    bool Pop(Item* out_item);
+
+    // Number of queued messages, without gap and resync items.
+    size_t message_count() const;
+
+   private:
+    // Replace the oldest message with a gap item, or extend the gap item of
+    // its room.
+    void DropOldestMessage();
+
+    // Replace every queued message and gap item with a resync item of its
+    // room.
+    void DropAllMessages();
+
+    std::deque<Item> items_;
+
+    // Number of kMessageItem in items_.
+    size_t message_count_;
+
+    // Rooms with a kResyncItem in items_.
+    std::set<utility::string_t> resync_rooms_;
+
+    const size_t capacity_;
+
+    const OverflowPolicy overflow_policy_;
+
+    Counters* counters_;
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_SUBSCRIBERQUEUE_H_ // CHATSERVER_SUBSCRIBERQUEUE_H_
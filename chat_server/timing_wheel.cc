@@ -0,0 +1,119 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "timing_wheel.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace chatserver {
+
+  TimingWheel::TimingWheel(time_t start_time)
+      : current_time_(start_time) {
+  }
+
+  void TimingWheel::Schedule(const SessionKey& key, time_t expire_time) {
+    auto entry_it = entries_.find(key);
+    if (entry_it == entries_.end()) {
+      // The node is created in a temporary slot and spliced into place.
+      Slot new_node;
+      new_node.push_back(key);
+      Entry entry;
+      entry.expire_time = expire_time;
+      entry.position = new_node.begin();
+      entry_it = entries_.emplace(key, entry).first;
+      Place(&entry_it->second, &new_node, current_time_ + 1);
+      return;
+    }
+
+    Entry& entry = entry_it->second;
+    entry.expire_time = expire_time;
+    Place(&entry, &slots_[entry.level][entry.slot], current_time_ + 1);
+  }
+
+  void TimingWheel::Cancel(const SessionKey& key) {
+    const auto entry_it = entries_.find(key);
+    if (entry_it == entries_.end()) {
+      return;
+    }
+    const Entry& entry = entry_it->second;
+    slots_[entry.level][entry.slot].erase(entry.position);
+    entries_.erase(entry_it);
+  }
+
+  void TimingWheel::Advance(time_t now, vector<SessionKey>* expired_keys) {
+    if (entries_.empty()) {
+      current_time_ = max(current_time_, now);
+      return;
+    }
+
+    while (current_time_ < now) {
+      ++current_time_;
+
+      // Slots of the higher levels whose period starts now move down first.
+      for (size_t level = kLevelCount - 1; level > 0; --level) {
+        const int shift = kSlotBits * static_cast<int>(level);
+        if ((current_time_ & ((time_t(1) << shift) - 1)) == 0) {
+          Cascade(level, (current_time_ >> shift) & (kSlotCount - 1));
+        }
+      }
+
+      Slot expiring_slot;
+      expiring_slot.swap(slots_[0][current_time_ & (kSlotCount - 1)]);
+      while (!expiring_slot.empty()) {
+        const SessionKey& key = expiring_slot.front();
+        const auto entry_it = entries_.find(key);
+        if (entry_it->second.expire_time <= current_time_) {
+          expired_keys->push_back(key);
+          entries_.erase(entry_it);
+          expiring_slot.pop_front();
+        } else {
+          Place(&entry_it->second, &expiring_slot, current_time_ + 1);
+        }
+      }
+    }
+  }
+
+  size_t TimingWheel::size() const {
+    return entries_.size();
+  }
+
+  void TimingWheel::Place(Entry* entry, Slot* from_slot,
+                          time_t earliest_time) {
+    // A key that is already due goes to the earliest slot still to come.
+    time_t expire_time = max(entry->expire_time, earliest_time);
+    size_t level = 0;
+    while (level + 1 < kLevelCount &&
+           expire_time - current_time_ >=
+               (time_t(1) << (kSlotBits * static_cast<int>(level + 1)))) {
+      ++level;
+    }
+
+    // Beyond the wheel: wait in the farthest slot and cascade again.
+    const time_t wheel_span =
+        time_t(1) << (kSlotBits * static_cast<int>(kLevelCount));
+    if (expire_time - current_time_ >= wheel_span) {
+      expire_time = current_time_ + wheel_span - 1;
+    }
+
+    const size_t slot = (expire_time >> (kSlotBits * static_cast<int>(level)))
+                        & (kSlotCount - 1);
+    Slot& to_slot = slots_[level][slot];
+    to_slot.splice(to_slot.end(), *from_slot, entry->position);
+    entry->level = level;
+    entry->slot = slot;
+  }
+
+  void TimingWheel::Cascade(size_t level, size_t slot) {
+    Slot cascading_slot;
+    cascading_slot.swap(slots_[level][slot]);
+    while (!cascading_slot.empty()) {
+      // The level 0 slot of current_time_ is processed right after.
+      Place(&entries_.find(cascading_slot.front())->second, &cascading_slot,
+            current_time_);
+    }
+  }
+
+} // namespace chatserver
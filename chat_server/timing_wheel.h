@@ -0,0 +1,99 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_TIMINGWHEEL_H_
+#define CHATSERVER_TIMINGWHEEL_H_
+
+#include <array>
+#include <ctime>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "session.h"
+
+// This class is designed to track expire times of many session keys with a
+// hierarchical timing wheel. Keys are fixed-size SessionKey values, so a
+// slot node and a map entry hold no heap string. Level 0 has one slot per
+// second, and each higher level has slots kSlotCount times longer. A key sits
+// in the slot of its expire time at the lowest level that can hold it, and is
+// moved to a lower level when the wheel reaches its slot (cascade).
+// Scheduling, rescheduling and canceling a key are O(1). Advancing the wheel
+// touches only the keys in the slots it passes, not every key.
+// The class is NOT thread-safe.
+// Example:
+//   TimingWheel timing_wheel(time(nullptr));
+//   timing_wheel.Schedule(session_key, time(nullptr) + 30);
+//   ...
+//   vector<SessionKey> expired_keys;
+//   timing_wheel.Advance(time(nullptr), &expired_keys);
+
+namespace chatserver {
+
+  class TimingWheel {
+   public:
+    // Start the wheel at the given time (second).
+    explicit TimingWheel(std::time_t start_time);
+
+    // Schedule the key to expire at expire_time. A key that is already
+    // scheduled is moved to the new slot.
+    void Schedule(const SessionKey& key, std::time_t expire_time);
+
+    // Remove the key from the wheel.
+    void Cancel(const SessionKey& key);
+
+    // Advance the wheel second by second up to now and append the keys that
+    // expired on the way into expired_keys. Expired keys leave the wheel.
+    void Advance(std::time_t now, std::vector<SessionKey>* expired_keys);
+
+    // Number of scheduled keys.
+    size_t size() const;
+
+   private:
+    // Number of slots in a level (2^kSlotBits).
+    static const int kSlotBits = 6;
+    static const size_t kSlotCount = size_t(1) << kSlotBits;
+
+    // Number of levels. The wheel covers kSlotCount^kLevelCount seconds,
+    // later expire times wait in the last level and cascade again.
+    static const size_t kLevelCount = 3;
+
+    // Keys in a slot. Nodes are moved between slots with splice.
+    typedef std::list<SessionKey> Slot;
+
+    // Position of a scheduled key.
+    struct Entry {
+      std::time_t expire_time;
+      size_t level;
+      size_t slot;
+      Slot::iterator position;
+    };
+
+    // Move the node of the entry from from_slot into the slot of its expire
+    // time. Expire times before earliest_time use the slot of earliest_time.
+    void Place(Entry* entry, Slot* from_slot, std::time_t earliest_time);
+
+    // Move every key of the given slot to the level below.
+    void Cascade(size_t level, size_t slot);
+
+    // slots_[level][slot]
+    std::array<std::array<Slot, kSlotCount>, kLevelCount> slots_;
+
+    // Hash function of entries_.
+    struct KeyHash {
+      size_t operator()(const SessionKey& key) const {
+        return key.Hash();
+      }
+    };
+
+    // Scheduled keys: <key, Entry>
+    std::unordered_map<SessionKey, Entry, KeyHash> entries_;
+
+    // Time the wheel has advanced to.
+    std::time_t current_time_;
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_TIMINGWHEEL_H_ // CHATSERVER_TIMINGWHEEL_H_
@@ -0,0 +1,44 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "token_revocation_set.h"
+
+using namespace std;
+
+namespace chatserver {
+
+  TokenRevocationSet::TokenRevocationSet() : revoked_token_count_(0) {
+  }
+
+  bool TokenRevocationSet::Revoke(uint64_t token_mac, time_t expire_time,
+                                  time_t now) {
+    lock_guard<shared_timed_mutex> lock(mutex_revoked_tokens_);
+    // Expired tokens are dropped from the earliest on, so each token is
+    // dropped once.
+    while (!expire_queue_.empty() && expire_queue_.top().first <= now) {
+      revoked_tokens_.erase(expire_queue_.top().second);
+      expire_queue_.pop();
+    }
+    const bool is_revoked =
+        revoked_tokens_.emplace(token_mac, expire_time).second;
+    if (is_revoked) {
+      expire_queue_.emplace(expire_time, token_mac);
+    }
+    revoked_token_count_.store(revoked_tokens_.size(), memory_order_release);
+    return is_revoked;
+  }
+
+  bool TokenRevocationSet::IsRevoked(uint64_t token_mac) const {
+    if (revoked_token_count_.load(memory_order_acquire) == 0) {
+      return false;
+    }
+    shared_lock<shared_timed_mutex> lock(mutex_revoked_tokens_);
+    return revoked_tokens_.count(token_mac) != 0;
+  }
+
+  size_t TokenRevocationSet::size() const {
+    return revoked_token_count_.load();
+  }
+
+} // namespace chatserver
@@ -0,0 +1,75 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_TOKENREVOCATIONSET_H_
+#define CHATSERVER_TOKENREVOCATIONSET_H_
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <queue>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// This class is designed to remember revoked (logged out) session tokens
+// until they expire. A token is identified by its MAC. Entries are dropped
+// once the token expires, since an expired token is rejected anyway, so the
+// set only holds tokens logged out within one token lifetime.
+// Checking an empty set costs one atomic load. Otherwise checks share a
+// reader-writer lock, and a revocation takes it exclusively for one insert
+// plus dropping the tokens that expired since the last revocation.
+// Example:
+//   TokenRevocationSet token_revocation_set;
+//   Logout:
+//     token_revocation_set.Revoke(token_mac, expire_time, time(nullptr));
+//   Request:
+//     if (token_revocation_set.IsRevoked(token_mac)) {
+//       Logged out token.
+//     }
+
+namespace chatserver {
+
+  class TokenRevocationSet {
+   public:
+    TokenRevocationSet();
+
+    // Revoke the token until its expire time. Return false if the token is
+    // already revoked.
+    bool Revoke(uint64_t token_mac, std::time_t expire_time, std::time_t now);
+
+    // Check the token is revoked.
+    bool IsRevoked(uint64_t token_mac) const;
+
+    // Number of revoked tokens kept. Expired tokens are dropped by the next
+    // revocation.
+    size_t size() const;
+
+   private:
+    // Revoked tokens: <token MAC, expire time>
+    typedef std::unordered_map<uint64_t, std::time_t> RevokedTokenMap;
+
+    // Revoked tokens ordered by expire time, earliest first:
+    // <expire time, token MAC>
+    typedef std::priority_queue<std::pair<std::time_t, uint64_t>,
+                                std::vector<std::pair<std::time_t, uint64_t>>,
+                                std::greater<std::pair<std::time_t, uint64_t>>>
+        ExpireQueue;
+
+    RevokedTokenMap revoked_tokens_;
+    ExpireQueue expire_queue_;
+
+    // Number of tokens in revoked_tokens_. Read without the lock.
+    std::atomic<size_t> revoked_token_count_;
+
+    // Mutex for member variables: revoked_tokens_, expire_queue_,
+    // revoked_token_count_. Readers take it shared, writers exclusively.
+    mutable std::shared_timed_mutex mutex_revoked_tokens_;
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_TOKENREVOCATIONSET_H_ // CHATSERVER_TOKENREVOCATIONSET_H_
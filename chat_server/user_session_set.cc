@@ -0,0 +1,68 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "user_session_set.h"
+
+using namespace std;
+
+namespace chatserver {
+
+  UserSessionSet::UserSessionSet() : size_(0) {
+  }
+
+  bool UserSessionSet::Add(const SessionKey& session_key) {
+    if (Find(session_key) != size_) {
+      return false;
+    }
+    if (size_ < kInlineSessionCount) {
+      inline_sessions_[size_] = session_key;
+    } else {
+      overflow_sessions_.push_back(session_key);
+    }
+    ++size_;
+    return true;
+  }
+
+  bool UserSessionSet::Remove(const SessionKey& session_key) {
+    const size_t index = Find(session_key);
+    if (index == size_) {
+      return false;
+    }
+    // Shift the later keys to keep the order.
+    for (size_t i = index; i + 1 < size_; ++i) {
+      At(i) = At(i + 1);
+    }
+    if (size_ > kInlineSessionCount) {
+      overflow_sessions_.pop_back();
+    }
+    --size_;
+    return true;
+  }
+
+  bool UserSessionSet::Contains(const SessionKey& session_key) const {
+    return Find(session_key) != size_;
+  }
+
+  const SessionKey& UserSessionSet::operator[](size_t index) const {
+    return index < kInlineSessionCount
+               ? inline_sessions_[index]
+               : overflow_sessions_[index - kInlineSessionCount];
+  }
+
+  size_t UserSessionSet::Find(const SessionKey& session_key) const {
+    for (size_t i = 0; i < size_; ++i) {
+      if ((*this)[i] == session_key) {
+        return i;
+      }
+    }
+    return size_;
+  }
+
+  SessionKey& UserSessionSet::At(size_t index) {
+    return index < kInlineSessionCount
+               ? inline_sessions_[index]
+               : overflow_sessions_[index - kInlineSessionCount];
+  }
+
+} // namespace chatserver
@@ -0,0 +1,69 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_USERSESSIONSET_H_
+#define CHATSERVER_USERSESSIONSET_H_
+
+#include <array>
+#include <vector>
+
+#include "session.h"
+
+// This class is designed to keep the session keys of one user.
+// Most users have one or two sessions, so the first kInlineSessionCount keys
+// are stored in the object itself and only further keys take heap memory.
+// Keys keep the order they were added in.
+// The class is not thread-safe.
+// Example:
+//   UserSessionSet user_sessions;
+//   user_sessions.Add(session_key);
+//   for (size_t i = 0; i < user_sessions.size(); ++i) {
+//     Use user_sessions[i].
+//   }
+//   user_sessions.Remove(session_key);
+
+namespace chatserver {
+
+  class UserSessionSet {
+   public:
+    // Number of keys stored without heap memory.
+    static const size_t kInlineSessionCount = 2;
+
+    UserSessionSet();
+
+    // Add the session key. Return false if it is already in the set.
+    bool Add(const SessionKey& session_key);
+
+    // Remove the session key. Return false if it is not in the set.
+    bool Remove(const SessionKey& session_key);
+
+    // Check the session key is in the set.
+    bool Contains(const SessionKey& session_key) const;
+
+    // Session key at index, in the order of Add.
+    const SessionKey& operator[](size_t index) const;
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+   private:
+    // Index of the session key, or size_ if it is not in the set.
+    size_t Find(const SessionKey& session_key) const;
+
+    // Session key at index.
+    SessionKey& At(size_t index);
+
+    // Number of session keys.
+    size_t size_;
+
+    // First kInlineSessionCount session keys.
+    std::array<SessionKey, kInlineSessionCount> inline_sessions_;
+
+    // Session keys after the first kInlineSessionCount.
+    std::vector<SessionKey> overflow_sessions_;
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_USERSESSIONSET_H_ // CHATSERVER_USERSESSIONSET_H_
@@ -0,0 +1,288 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "websocket_protocol.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <vector>
+
+#include "cpprest/asyncrt_utils.h"
+
+using namespace std;
+using ::utility::conversions::to_base64;
+using ::utility::conversions::to_utf8string;
+
+namespace chatserver {
+
+  // GUID appended to the key of a handshake (RFC 6455 section 1.3).
+  const char kHandshakeGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+  // End of the HTTP header.
+  const char kHeaderEnd[] = "\r\n\r\n";
+  // Bits of the first two bytes of a frame.
+  const unsigned char kFinalFrameBit = 0x80;
+  const unsigned char kReservedBits = 0x70;
+  const unsigned char kOpcodeBits = 0x0F;
+  const unsigned char kMaskBit = 0x80;
+  const unsigned char kPayloadSizeBits = 0x7F;
+  // Payload size codes of 16-bit and 64-bit extended sizes.
+  const unsigned char kPayloadSize16 = 126;
+  const unsigned char kPayloadSize64 = 127;
+  // Maximum payload size of a control frame.
+  const size_t kMaxControlPayloadSize = 125;
+
+  namespace {
+
+    // SHA-1 digest of the data, only used for the handshake accept key.
+    array<unsigned char, 20> Sha1(const string& data) {
+      uint32_t state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476,
+                           0xC3D2E1F0};
+      string message = data;
+      const uint64_t bit_size = static_cast<uint64_t>(data.size()) * 8;
+      message.push_back(static_cast<char>(0x80));
+      while (message.size() % 64 != 56) {
+        message.push_back('\0');
+      }
+      for (int shift = 56; shift >= 0; shift -= 8) {
+        message.push_back(static_cast<char>((bit_size >> shift) & 0xFF));
+      }
+
+      const auto rotate = [](uint32_t value, int bits) {
+        return (value << bits) | (value >> (32 - bits));
+      };
+      for (size_t block = 0; block < message.size(); block += 64) {
+        uint32_t words[80];
+        for (int i = 0; i < 16; ++i) {
+          words[i] = 0;
+          for (int j = 0; j < 4; ++j) {
+            words[i] = (words[i] << 8) |
+                       static_cast<unsigned char>(message[block + i * 4 + j]);
+          }
+        }
+        for (int i = 16; i < 80; ++i) {
+          words[i] = rotate(
+              words[i - 3] ^ words[i - 8] ^ words[i - 14] ^ words[i - 16], 1);
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3],
+                 e = state[4];
+        for (int i = 0; i < 80; ++i) {
+          uint32_t f, k;
+          if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+          } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+          } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+          } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+          }
+          const uint32_t temp = rotate(a, 5) + f + e + k + words[i];
+          e = d;
+          d = c;
+          c = rotate(b, 30);
+          b = a;
+          a = temp;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+      }
+
+      array<unsigned char, 20> digest;
+      for (int i = 0; i < 20; ++i) {
+        digest[i] = static_cast<unsigned char>(
+            state[i / 4] >> (24 - (i % 4) * 8));
+      }
+      return digest;
+    }
+
+    string ToLower(string text) {
+      transform(text.begin(), text.end(), text.begin(), [](char character) {
+        return static_cast<char>(
+            tolower(static_cast<unsigned char>(character)));
+      });
+      return text;
+    }
+
+    string Trim(const string& text) {
+      const size_t begin = text.find_first_not_of(" \t");
+      if (begin == string::npos) {
+        return string();
+      }
+      return text.substr(begin, text.find_last_not_of(" \t") - begin + 1);
+    }
+
+  } // namespace
+
+  bool WebSocketProtocol::ParseHandshake(const string& request,
+                                         Handshake* out_handshake) {
+    const size_t header_end = request.find(kHeaderEnd);
+    if (header_end == string::npos || header_end > kMaxHandshakeSize) {
+      return false;
+    }
+
+    // Request line: GET /path?query HTTP/1.1
+    size_t line_end = request.find("\r\n");
+    const string request_line = request.substr(0, line_end);
+    const size_t target_begin = request_line.find(' ');
+    const size_t target_end = request_line.rfind(' ');
+    if (request_line.compare(0, 4, "GET ") != 0 ||
+        target_end <= target_begin + 1 ||
+        request_line.compare(target_end + 1, string::npos, "HTTP/1.1") != 0) {
+      return false;
+    }
+    const string target =
+        request_line.substr(target_begin + 1, target_end - target_begin - 1);
+    const size_t query_begin = target.find('?');
+    Handshake handshake;
+    handshake.path = target.substr(0, query_begin);
+    if (query_begin != string::npos) {
+      handshake.query = target.substr(query_begin + 1);
+    }
+
+    bool is_upgrade = false;
+    bool is_connection_upgrade = false;
+    bool is_version_13 = false;
+    while (line_end < header_end) {
+      const size_t line_begin = line_end + 2;
+      line_end = request.find("\r\n", line_begin);
+      const string line = request.substr(line_begin, line_end - line_begin);
+      const size_t colon = line.find(':');
+      if (colon == string::npos) {
+        continue;
+      }
+      const string name = ToLower(Trim(line.substr(0, colon)));
+      const string value = Trim(line.substr(colon + 1));
+      if (name == "upgrade") {
+        is_upgrade = ToLower(value) == "websocket";
+      } else if (name == "connection") {
+        is_connection_upgrade =
+            ToLower(value).find("upgrade") != string::npos;
+      } else if (name == "sec-websocket-version") {
+        is_version_13 = value == "13";
+      } else if (name == "sec-websocket-key") {
+        handshake.key = value;
+      }
+    }
+    if (!is_upgrade || !is_connection_upgrade || !is_version_13 ||
+        handshake.key.empty()) {
+      return false;
+    }
+    *out_handshake = handshake;
+    return true;
+  }
+
+  string WebSocketProtocol::BuildHandshakeResponse(const string& key) {
+    return "HTTP/1.1 101 Switching Protocols\r\n"
+           "Upgrade: websocket\r\n"
+           "Connection: Upgrade\r\n"
+           "Sec-WebSocket-Accept: " + ComputeAcceptKey(key) + "\r\n\r\n";
+  }
+
+  string WebSocketProtocol::BuildRejectResponse(int status_code,
+                                                const string& reason) {
+    return "HTTP/1.1 " + to_string(status_code) + " " + reason + "\r\n"
+           "Content-Length: 0\r\n"
+           "Connection: close\r\n\r\n";
+  }
+
+  string WebSocketProtocol::ComputeAcceptKey(const string& key) {
+    const array<unsigned char, 20> digest = Sha1(key + kHandshakeGuid);
+    return to_utf8string(
+        to_base64(vector<unsigned char>(digest.begin(), digest.end())));
+  }
+
+  string WebSocketProtocol::EncodeFrame(Opcode opcode,
+                                        const string& payload) {
+    string frame = EncodeFrameHeader(opcode, payload.size());
+    frame.append(payload);
+    return frame;
+  }
+
+  string WebSocketProtocol::EncodeFrameHeader(Opcode opcode,
+                                              size_t payload_size) {
+    string header;
+    header.reserve(10);
+    header.push_back(static_cast<char>(kFinalFrameBit | opcode));
+    if (payload_size < kPayloadSize16) {
+      header.push_back(static_cast<char>(payload_size));
+    } else if (payload_size <= 0xFFFF) {
+      header.push_back(static_cast<char>(kPayloadSize16));
+      header.push_back(static_cast<char>(payload_size >> 8));
+      header.push_back(static_cast<char>(payload_size & 0xFF));
+    } else {
+      header.push_back(static_cast<char>(kPayloadSize64));
+      const uint64_t extended_size = payload_size;
+      for (int shift = 56; shift >= 0; shift -= 8) {
+        header.push_back(static_cast<char>((extended_size >> shift) & 0xFF));
+      }
+    }
+    return header;
+  }
+
+  WebSocketProtocol::DecodeResult WebSocketProtocol::DecodeFrame(
+      const char* data, size_t size, Frame* out_frame,
+      size_t* out_frame_size) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    if (size < 2) {
+      return kFrameIncomplete;
+    }
+    const unsigned char opcode = bytes[0] & kOpcodeBits;
+    const bool is_control = (opcode & 0x8) != 0;
+    if ((bytes[0] & kReservedBits) != 0 ||
+        (bytes[0] & kFinalFrameBit) == 0 || opcode == kContinuation ||
+        (bytes[1] & kMaskBit) == 0) {
+      // Extensions, fragments and unmasked client frames are not supported.
+      return kFrameError;
+    }
+    if (opcode != kText && opcode != kBinary && opcode != kClose &&
+        opcode != kPing && opcode != kPong) {
+      return kFrameError;
+    }
+
+    size_t header_size = 2;
+    uint64_t payload_size = bytes[1] & kPayloadSizeBits;
+    if (payload_size == kPayloadSize16 || payload_size == kPayloadSize64) {
+      const size_t extended_size = payload_size == kPayloadSize16 ? 2 : 8;
+      if (size < header_size + extended_size) {
+        return kFrameIncomplete;
+      }
+      payload_size = 0;
+      for (size_t i = 0; i < extended_size; ++i) {
+        payload_size = (payload_size << 8) | bytes[header_size + i];
+      }
+      header_size += extended_size;
+    }
+    if (payload_size > kMaxPayloadSize ||
+        (is_control && payload_size > kMaxControlPayloadSize)) {
+      return kFrameError;
+    }
+
+    const size_t mask_size = 4;
+    const size_t frame_size = header_size + mask_size +
+                              static_cast<size_t>(payload_size);
+    if (size < frame_size) {
+      return kFrameIncomplete;
+    }
+    const unsigned char* mask = bytes + header_size;
+    const char* payload = data + header_size + mask_size;
+    out_frame->opcode = static_cast<Opcode>(opcode);
+    out_frame->payload.resize(static_cast<size_t>(payload_size));
+    for (size_t i = 0; i < payload_size; ++i) {
+      out_frame->payload[i] =
+          static_cast<char>(payload[i] ^ mask[i % mask_size]);
+    }
+    *out_frame_size = frame_size;
+    return kFrameDecoded;
+  }
+
+} // namespace chatserver
@@ -0,0 +1,104 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_WEBSOCKETPROTOCOL_H_
+#define CHATSERVER_WEBSOCKETPROTOCOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// This class is designed to encode and decode the server side of the
+// WebSocket protocol (RFC 6455): the opening handshake and the frames.
+// It works on raw bytes and keeps no state, so WebSocketServer feeds it the
+// bytes it received and sends the bytes it returns.
+// Limits of this implementation:
+//  - A client frame must be masked and must not be fragmented.
+//  - A frame payload is at most kMaxPayloadSize bytes.
+// Example:
+//   WebSocketProtocol::Handshake handshake;
+//   if (WebSocketProtocol::ParseHandshake(request, &handshake)) {
+//     send(WebSocketProtocol::BuildHandshakeResponse(handshake.key));
+//   }
+//   WebSocketProtocol::Frame frame;
+//   size_t frame_size;
+//   if (WebSocketProtocol::DecodeFrame(data, size, &frame, &frame_size) ==
+//       WebSocketProtocol::kFrameDecoded) {
+//     use frame.payload, then drop frame_size bytes of data.
+//   }
+
+namespace chatserver {
+
+  class WebSocketProtocol {
+   public:
+    // Frame opcodes.
+    enum Opcode {
+      kContinuation = 0x0,
+      kText = 0x1,
+      kBinary = 0x2,
+      kClose = 0x8,
+      kPing = 0x9,
+      kPong = 0xA
+    };
+
+    // Result of DecodeFrame.
+    enum DecodeResult {
+      kFrameDecoded,
+      // More bytes are needed.
+      kFrameIncomplete,
+      // The bytes break the protocol or the limits; close the connection.
+      kFrameError
+    };
+
+    // Opening handshake request of a client.
+    struct Handshake {
+      // Path and query string of the request URL, still percent-encoded.
+      std::string path;
+      std::string query;
+      // Value of the Sec-WebSocket-Key header.
+      std::string key;
+    };
+
+    // Decoded frame. The payload is unmasked.
+    struct Frame {
+      Opcode opcode;
+      std::string payload;
+    };
+
+    // Maximum size of a frame payload.
+    static const size_t kMaxPayloadSize = 64 * 1024;
+
+    // Maximum size of a handshake request.
+    static const size_t kMaxHandshakeSize = 8 * 1024;
+
+    // Parse a whole handshake request (up to the empty line). Return false if
+    // it is not a valid WebSocket upgrade request.
+    static bool ParseHandshake(const std::string& request,
+                               Handshake* out_handshake);
+
+    // Response that accepts the handshake of the given key.
+    static std::string BuildHandshakeResponse(const std::string& key);
+
+    // Response that rejects the handshake with the HTTP status.
+    static std::string BuildRejectResponse(int status_code,
+                                           const std::string& reason);
+
+    // Sec-WebSocket-Accept value of a Sec-WebSocket-Key value.
+    static std::string ComputeAcceptKey(const std::string& key);
+
+    // Encode an unmasked server frame.
+    static std::string EncodeFrame(Opcode opcode, const std::string& payload);
+
+    // Encode the header of an unmasked server frame. The payload follows it.
+    static std::string EncodeFrameHeader(Opcode opcode, size_t payload_size);
+
+    // Decode the first frame of data. On kFrameDecoded, out_frame_size is the
+    // number of bytes of the frame.
+    static DecodeResult DecodeFrame(const char* data, size_t size,
+                                    Frame* out_frame, size_t* out_frame_size);
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_WEBSOCKETPROTOCOL_H_ // CHATSERVER_WEBSOCKETPROTOCOL_H_
@@ -0,0 +1,577 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "websocket_server.h"
+
+#include <deque>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "spdlog/spdlog.h"
+#include "websocket_protocol.h"
+
+using namespace std;
+using ::spdlog::error;
+using ::spdlog::warn;
+
+namespace chatserver {
+
+  // Maximum number of bytes queued to a connection.
+  const size_t kMaxOutgoingSize = 1024 * 1024;
+  // Maximum number of connections.
+  const size_t kMaxConnectionCount = 10000;
+  // Size of the buffer of a socket read.
+  const size_t kReadBufferSize = 16 * 1024;
+  // Status code of a close frame: normal closure.
+  const char kNormalClosure[] = {'\x03', '\xE8'};
+
+  namespace {
+
+#ifdef _WIN32
+    typedef WSAPOLLFD PollDescriptor;
+    const WebSocketServer::SocketHandle kInvalidSocket = INVALID_SOCKET;
+    const int kSendFlags = 0;
+
+    int PollSockets(vector<PollDescriptor>* descriptors) {
+      return WSAPoll(descriptors->data(),
+                     static_cast<ULONG>(descriptors->size()), -1);
+    }
+
+    void CloseSocket(WebSocketServer::SocketHandle socket) {
+      closesocket(socket);
+    }
+
+    bool SetNonBlocking(WebSocketServer::SocketHandle socket) {
+      u_long mode = 1;
+      return ioctlsocket(socket, FIONBIO, &mode) == 0;
+    }
+
+    // The last socket call failed only because it would block.
+    bool IsWouldBlock() {
+      return WSAGetLastError() == WSAEWOULDBLOCK;
+    }
+#else
+    typedef pollfd PollDescriptor;
+    const WebSocketServer::SocketHandle kInvalidSocket = -1;
+#ifdef MSG_NOSIGNAL
+    const int kSendFlags = MSG_NOSIGNAL;
+#else
+    const int kSendFlags = 0;
+#endif
+
+    int PollSockets(vector<PollDescriptor>* descriptors) {
+      return poll(descriptors->data(),
+                  static_cast<nfds_t>(descriptors->size()), -1);
+    }
+
+    void CloseSocket(WebSocketServer::SocketHandle socket) {
+      close(socket);
+    }
+
+    bool SetNonBlocking(WebSocketServer::SocketHandle socket) {
+      const int flags = fcntl(socket, F_GETFL, 0);
+      return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+
+    // The last socket call failed only because it would block.
+    bool IsWouldBlock() {
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+#endif
+
+    PollDescriptor MakePollDescriptor(WebSocketServer::SocketHandle socket,
+                                      short events) {
+      PollDescriptor descriptor;
+      descriptor.fd = socket;
+      descriptor.events = events;
+      descriptor.revents = 0;
+      return descriptor;
+    }
+
+  } // namespace
+
+  struct WebSocketServer::Connection {
+    explicit Connection(SocketHandle socket)
+        : socket(socket), is_handshaken(false), is_open(false),
+          close_after_write(false), outgoing_offset(0), outgoing_size(0) {
+    }
+
+    // Queue bytes to be written.
+    void QueueOutgoing(shared_ptr<const string> data) {
+      outgoing_size += data->size();
+      outgoing.push_back(move(data));
+    }
+
+    void ClearOutgoing() {
+      outgoing.clear();
+      outgoing_offset = 0;
+      outgoing_size = 0;
+    }
+
+    SocketHandle socket;
+    // Bytes read but not processed yet. Only the event loop uses it.
+    string incoming;
+    // The handshake request is processed. Only the event loop uses it.
+    bool is_handshaken;
+    // The handshake is accepted, so messages can be sent.
+    bool is_open;
+    // Close the connection when outgoing is written.
+    bool close_after_write;
+    // Buffers queued to be written. A shared message is queued as is after
+    // a frame header of its own.
+    deque<shared_ptr<const string>> outgoing;
+    // Bytes of outgoing.front() already written.
+    size_t outgoing_offset;
+    // Bytes queued in outgoing and not written.
+    size_t outgoing_size;
+  };
+
+  WebSocketServer::WebSocketServer()
+      : next_connection_id_(0),
+        stop_event_loop_(false),
+        listen_socket_(kInvalidSocket),
+        wake_socket_(kInvalidSocket),
+        port_(0) {
+  }
+
+  WebSocketServer::~WebSocketServer() {
+    Close();
+  }
+
+  void WebSocketServer::SetOpenHandler(OpenHandler open_handler) {
+    open_handler_ = move(open_handler);
+  }
+
+  void WebSocketServer::SetMessageHandler(MessageHandler message_handler) {
+    message_handler_ = move(message_handler);
+  }
+
+  void WebSocketServer::SetCloseHandler(CloseHandler close_handler) {
+    close_handler_ = move(close_handler);
+  }
+
+  void WebSocketServer::SetWritableHandler(
+      WritableHandler writable_handler) {
+    writable_handler_ = move(writable_handler);
+  }
+
+  bool WebSocketServer::Open(uint16_t port) {
+    if (event_loop_thread_.joinable()) {
+      error("WebSocket server is already opened");
+      return false;
+    }
+#ifdef _WIN32
+    WSADATA wsa_data;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+      error("Can't start Winsock");
+      return false;
+    }
+#endif
+
+    // Listening socket on every local address.
+    listen_socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    const int reuse_address = 1;
+    socklen_t address_size = sizeof(address);
+    if (listen_socket_ == kInvalidSocket ||
+        setsockopt(listen_socket_, SOL_SOCKET, SO_REUSEADDR,
+                   reinterpret_cast<const char*>(&reuse_address),
+                   sizeof(reuse_address)) != 0 ||
+        ::bind(listen_socket_, reinterpret_cast<sockaddr*>(&address),
+               sizeof(address)) != 0 ||
+        listen(listen_socket_, SOMAXCONN) != 0 ||
+        !SetNonBlocking(listen_socket_) ||
+        getsockname(listen_socket_, reinterpret_cast<sockaddr*>(&address),
+                    &address_size) != 0) {
+      error("Can't listen on WebSocket port {}", port);
+      Close();
+      return false;
+    }
+    port_ = ntohs(address.sin_port);
+
+    // Wake socket: a loopback UDP socket that sends to itself.
+    wake_socket_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    sockaddr_in wake_address = {};
+    wake_address.sin_family = AF_INET;
+    wake_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address_size = sizeof(wake_address);
+    if (wake_socket_ == kInvalidSocket ||
+        ::bind(wake_socket_, reinterpret_cast<sockaddr*>(&wake_address),
+               sizeof(wake_address)) != 0 ||
+        getsockname(wake_socket_, reinterpret_cast<sockaddr*>(&wake_address),
+                    &address_size) != 0 ||
+        connect(wake_socket_, reinterpret_cast<sockaddr*>(&wake_address),
+                sizeof(wake_address)) != 0 ||
+        !SetNonBlocking(wake_socket_)) {
+      error("Can't make the WebSocket wake socket");
+      Close();
+      return false;
+    }
+
+    stop_event_loop_ = false;
+    event_loop_thread_ = thread(&WebSocketServer::RunEventLoop, this);
+    return true;
+  }
+
+  void WebSocketServer::Close() {
+    if (event_loop_thread_.joinable()) {
+      {
+        lock_guard<mutex> lock(mutex_connections_);
+        stop_event_loop_ = true;
+      }
+      WakeEventLoop();
+      event_loop_thread_.join();
+    }
+
+    vector<uint64_t> connection_ids;
+    {
+      lock_guard<mutex> lock(mutex_connections_);
+      for (const auto& connection : connections_) {
+        connection_ids.push_back(connection.first);
+      }
+    }
+    for (const uint64_t connection_id : connection_ids) {
+      DropConnection(connection_id);
+    }
+
+    const bool is_opened = listen_socket_ != kInvalidSocket ||
+                           wake_socket_ != kInvalidSocket;
+    if (listen_socket_ != kInvalidSocket) {
+      CloseSocket(listen_socket_);
+      listen_socket_ = kInvalidSocket;
+    }
+    if (wake_socket_ != kInvalidSocket) {
+      CloseSocket(wake_socket_);
+      wake_socket_ = kInvalidSocket;
+    }
+#ifdef _WIN32
+    if (is_opened) {
+      WSACleanup();
+    }
+#endif
+  }
+
+  uint16_t WebSocketServer::port() const {
+    return port_;
+  }
+
+  bool WebSocketServer::Send(uint64_t connection_id, const string& text) {
+    return Send(connection_id, make_shared<const string>(text));
+  }
+
+  bool WebSocketServer::Send(uint64_t connection_id,
+                             const shared_ptr<const string>& text) {
+    bool needs_wake;
+    {
+      lock_guard<mutex> lock(mutex_connections_);
+      const auto connection_it = connections_.find(connection_id);
+      if (connection_it == connections_.end()) {
+        return false;
+      }
+      Connection& connection = *connection_it->second;
+      if (!connection.is_open || connection.close_after_write) {
+        return false;
+      }
+      if (connection.outgoing_size + text->size() > kMaxOutgoingSize) {
+        // The client does not read; drop it rather than buffer forever.
+        warn("WebSocket connection {} is too slow, closing it",
+             connection_id);
+        connection.ClearOutgoing();
+        connection.close_after_write = true;
+        needs_wake = true;
+      } else {
+        needs_wake = connection.outgoing.empty();
+        connection.QueueOutgoing(make_shared<const string>(
+            WebSocketProtocol::EncodeFrameHeader(WebSocketProtocol::kText,
+                                                 text->size())));
+        connection.QueueOutgoing(text);
+      }
+    }
+    if (needs_wake) {
+      WakeEventLoop();
+    }
+    return true;
+  }
+
+  void WebSocketServer::CloseConnection(uint64_t connection_id) {
+    {
+      lock_guard<mutex> lock(mutex_connections_);
+      const auto connection_it = connections_.find(connection_id);
+      if (connection_it == connections_.end() ||
+          connection_it->second->close_after_write) {
+        return;
+      }
+      Connection& connection = *connection_it->second;
+      if (connection.is_open) {
+        connection.QueueOutgoing(
+            make_shared<const string>(WebSocketProtocol::EncodeFrame(
+                WebSocketProtocol::kClose,
+                string(kNormalClosure, sizeof(kNormalClosure)))));
+      }
+      connection.close_after_write = true;
+    }
+    WakeEventLoop();
+  }
+
+  size_t WebSocketServer::connection_count() const {
+    lock_guard<mutex> lock(mutex_connections_);
+    return connections_.size();
+  }
+
+  void WebSocketServer::RunEventLoop() {
+    vector<PollDescriptor> descriptors;
+    vector<uint64_t> descriptor_connection_ids;
+    while (true) {
+      descriptors.clear();
+      descriptor_connection_ids.clear();
+      descriptors.push_back(MakePollDescriptor(listen_socket_, POLLIN));
+      descriptors.push_back(MakePollDescriptor(wake_socket_, POLLIN));
+      {
+        lock_guard<mutex> lock(mutex_connections_);
+        if (stop_event_loop_) {
+          return;
+        }
+        for (const auto& connection : connections_) {
+          short events = POLLIN;
+          if (!connection.second->outgoing.empty() ||
+              connection.second->close_after_write) {
+            events |= POLLOUT;
+          }
+          descriptors.push_back(
+              MakePollDescriptor(connection.second->socket, events));
+          descriptor_connection_ids.push_back(connection.first);
+        }
+      }
+
+      if (PollSockets(&descriptors) < 0) {
+        if (IsWouldBlock()) {
+          continue;
+        }
+        error("WebSocket poll failed");
+        return;
+      }
+
+      if ((descriptors[1].revents & POLLIN) != 0) {
+        char buffer[64];
+        while (recv(wake_socket_, buffer, sizeof(buffer), 0) > 0) {
+        }
+      }
+      if ((descriptors[0].revents & POLLIN) != 0) {
+        AcceptConnections();
+      }
+
+      for (size_t i = 0; i < descriptor_connection_ids.size(); ++i) {
+        const short revents = descriptors[i + 2].revents;
+        if (revents == 0) {
+          continue;
+        }
+        const uint64_t connection_id = descriptor_connection_ids[i];
+        Connection* connection;
+        {
+          lock_guard<mutex> lock(mutex_connections_);
+          connection = connections_.at(connection_id).get();
+        }
+        bool is_alive = (revents & (POLLERR | POLLNVAL)) == 0;
+        if (is_alive && (revents & (POLLIN | POLLHUP)) != 0) {
+          is_alive = ReadConnection(connection_id, connection);
+        }
+        if (is_alive && (revents & POLLOUT) != 0) {
+          bool is_drained = false;
+          is_alive = WriteConnection(connection, &is_drained);
+          // The handler runs without the lock; it may call Send.
+          if (is_alive && is_drained && writable_handler_) {
+            writable_handler_(connection_id);
+          }
+        }
+        if (!is_alive) {
+          DropConnection(connection_id);
+        }
+      }
+    }
+  }
+
+  void WebSocketServer::AcceptConnections() {
+    while (true) {
+      const SocketHandle socket = accept(listen_socket_, nullptr, nullptr);
+      if (socket == kInvalidSocket) {
+        return;
+      }
+      const int no_delay = 1;
+      setsockopt(socket, IPPROTO_TCP, TCP_NODELAY,
+                 reinterpret_cast<const char*>(&no_delay), sizeof(no_delay));
+      lock_guard<mutex> lock(mutex_connections_);
+      if (connections_.size() >= kMaxConnectionCount ||
+          !SetNonBlocking(socket)) {
+        warn("WebSocket connection is refused");
+        CloseSocket(socket);
+        continue;
+      }
+      connections_[next_connection_id_++] = make_unique<Connection>(socket);
+    }
+  }
+
+  bool WebSocketServer::ReadConnection(uint64_t connection_id,
+                                       Connection* connection) {
+    char buffer[kReadBufferSize];
+    const auto received_size =
+        recv(connection->socket, buffer, sizeof(buffer), 0);
+    if (received_size == 0) {
+      return false;
+    }
+    if (received_size < 0) {
+      return IsWouldBlock();
+    }
+    {
+      lock_guard<mutex> lock(mutex_connections_);
+      if (connection->close_after_write) {
+        // Closing: the rest of the input is ignored.
+        return true;
+      }
+    }
+    connection->incoming.append(buffer, static_cast<size_t>(received_size));
+
+    if (!connection->is_handshaken) {
+      const size_t header_end = connection->incoming.find("\r\n\r\n");
+      if (header_end == string::npos) {
+        return connection->incoming.size() <=
+               WebSocketProtocol::kMaxHandshakeSize;
+      }
+      connection->is_handshaken = true;
+      WebSocketProtocol::Handshake handshake;
+      const bool is_valid = WebSocketProtocol::ParseHandshake(
+          connection->incoming, &handshake);
+      // The handler runs without the lock; it may call Send of others.
+      const bool is_accepted =
+          is_valid && (!open_handler_ ||
+                       open_handler_(connection_id, handshake.path,
+                                     handshake.query));
+      connection->incoming.erase(0, header_end + 4);
+
+      lock_guard<mutex> lock(mutex_connections_);
+      if (is_accepted) {
+        connection->QueueOutgoing(make_shared<const string>(
+            WebSocketProtocol::BuildHandshakeResponse(handshake.key)));
+        connection->is_open = true;
+      } else {
+        connection->ClearOutgoing();
+        connection->QueueOutgoing(make_shared<const string>(is_valid
+            ? WebSocketProtocol::BuildRejectResponse(403, "Forbidden")
+            : WebSocketProtocol::BuildRejectResponse(400, "Bad Request")));
+        connection->close_after_write = true;
+        return true;
+      }
+    }
+    return ProcessFrames(connection_id, connection);
+  }
+
+  bool WebSocketServer::ProcessFrames(uint64_t connection_id,
+                                      Connection* connection) {
+    size_t offset = 0;
+    bool is_closing = false;
+    while (!is_closing) {
+      WebSocketProtocol::Frame frame;
+      size_t frame_size;
+      const WebSocketProtocol::DecodeResult result =
+          WebSocketProtocol::DecodeFrame(
+              connection->incoming.data() + offset,
+              connection->incoming.size() - offset, &frame, &frame_size);
+      if (result == WebSocketProtocol::kFrameIncomplete) {
+        break;
+      }
+      if (result == WebSocketProtocol::kFrameError) {
+        warn("WebSocket protocol error of connection {}", connection_id);
+        return false;
+      }
+      offset += frame_size;
+
+      if (frame.opcode == WebSocketProtocol::kText) {
+        if (message_handler_) {
+          message_handler_(connection_id, frame.payload);
+        }
+      } else if (frame.opcode == WebSocketProtocol::kPing ||
+                 frame.opcode == WebSocketProtocol::kClose) {
+        // Answer a ping with a pong and a close with a close.
+        lock_guard<mutex> lock(mutex_connections_);
+        if (connection->close_after_write) {
+          break;
+        }
+        const bool is_ping = frame.opcode == WebSocketProtocol::kPing;
+        connection->QueueOutgoing(
+            make_shared<const string>(WebSocketProtocol::EncodeFrame(
+                is_ping ? WebSocketProtocol::kPong
+                        : WebSocketProtocol::kClose,
+                is_ping ? frame.payload : frame.payload.substr(0, 2))));
+        if (!is_ping) {
+          connection->close_after_write = true;
+          is_closing = true;
+        }
+      }
+    }
+    connection->incoming.erase(0, offset);
+    return true;
+  }
+
+  bool WebSocketServer::WriteConnection(Connection* connection,
+                                        bool* out_is_drained) {
+    lock_guard<mutex> lock(mutex_connections_);
+    while (!connection->outgoing.empty()) {
+      const string& data = *connection->outgoing.front();
+      const auto sent_size =
+          send(connection->socket, data.data() + connection->outgoing_offset,
+               static_cast<int>(data.size() - connection->outgoing_offset),
+               kSendFlags);
+      if (sent_size < 0) {
+        return IsWouldBlock();
+      }
+      connection->outgoing_offset += static_cast<size_t>(sent_size);
+      connection->outgoing_size -= static_cast<size_t>(sent_size);
+      if (connection->outgoing_offset == data.size()) {
+        connection->outgoing.pop_front();
+        connection->outgoing_offset = 0;
+      }
+    }
+    *out_is_drained = connection->is_open;
+    return !connection->close_after_write;
+  }
+
+  void WebSocketServer::DropConnection(uint64_t connection_id) {
+    unique_ptr<Connection> connection;
+    {
+      lock_guard<mutex> lock(mutex_connections_);
+      const auto connection_it = connections_.find(connection_id);
+      if (connection_it == connections_.end()) {
+        return;
+      }
+      connection = move(connection_it->second);
+      connections_.erase(connection_it);
+    }
+    CloseSocket(connection->socket);
+    if (connection->is_open && close_handler_) {
+      close_handler_(connection_id);
+    }
+  }
+
+  void WebSocketServer::WakeEventLoop() {
+    const char wake_byte = 0;
+    send(wake_socket_, &wake_byte, 1, 0);
+  }
+
+} // namespace chatserver
@@ -0,0 +1,164 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#ifndef CHATSERVER_WEBSOCKETSERVER_H_
+#define CHATSERVER_WEBSOCKETSERVER_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// This class is designed to serve WebSocket connections, which cpprest only
+// provides on the client side. It listens on its own TCP port and runs one
+// event loop thread that polls every socket, so an open connection costs a
+// socket and its buffers but no thread.
+// The callbacks run on the event loop thread and must not block. Send can be
+// called from any thread: the frame is queued and the event loop writes it
+// when the socket is writable. A connection whose queue is over
+// kMaxOutgoingSize is closed instead of growing without limit. A sender that
+// paces itself sends more when the writable handler reports an empty queue.
+// Example:
+//   WebSocketServer websocket_server;
+//   websocket_server.SetOpenHandler(
+//       [](uint64_t connection_id, const string& path, const string& query) {
+//         return whether the connection is accepted;
+//       });
+//   websocket_server.SetMessageHandler(
+//       [&](uint64_t connection_id, const string& text) {
+//         websocket_server.Send(connection_id, reply);
+//       });
+//   websocket_server.Open(34569);
+//   ...
+//   websocket_server.Close();
+
+namespace chatserver {
+
+  class WebSocketServer {
+   public:
+    // Accept or reject a handshake of the path and query string (UTF-8,
+    // percent-encoded).
+    typedef std::function<bool(uint64_t connection_id,
+                               const std::string& path,
+                               const std::string& query)> OpenHandler;
+
+    // Called with each text message of a connection.
+    typedef std::function<void(uint64_t connection_id,
+                               const std::string& text)> MessageHandler;
+
+    // Called once when an accepted connection is closed.
+    typedef std::function<void(uint64_t connection_id)> CloseHandler;
+
+    // Called when every queued message of an open connection is written, so
+    // that the next ones can be sent.
+    typedef std::function<void(uint64_t connection_id)> WritableHandler;
+
+#ifdef _WIN32
+    typedef uintptr_t SocketHandle;
+#else
+    typedef int SocketHandle;
+#endif
+
+    WebSocketServer();
+
+    // Close the server.
+    ~WebSocketServer();
+
+    // Set the handlers. Call them before Open.
+    void SetOpenHandler(OpenHandler open_handler);
+    void SetMessageHandler(MessageHandler message_handler);
+    void SetCloseHandler(CloseHandler close_handler);
+    void SetWritableHandler(WritableHandler writable_handler);
+
+    // Listen on the port of every local address and run the event loop.
+    // Port 0 picks a free port.
+    bool Open(uint16_t port);
+
+    // Close every connection and join the event loop thread.
+    void Close();
+
+    // Port the server listens on.
+    uint16_t port() const;
+
+    // Queue a text message to the connection. Return false if the connection
+    // is not open or its queue is full.
+    bool Send(uint64_t connection_id, const std::string& text);
+
+    // Queue a shared text message to the connection without copying it. Only
+    // the frame header is made for the connection.
+    bool Send(uint64_t connection_id,
+              const std::shared_ptr<const std::string>& text);
+
+    // Close the connection after the queued messages are written.
+    void CloseConnection(uint64_t connection_id);
+
+    // Number of open connections.
+    size_t connection_count() const;
+
+   private:
+    // Socket state, defined in websocket_server.cc.
+    struct Connection;
+
+    // Poll the sockets, accept connections, read frames and write queued
+    // data until the server is closed.
+    void RunEventLoop();
+
+    // Accept the pending connections of the listening socket.
+    void AcceptConnections();
+
+    // Read from the connection and process the handshake or the frames.
+    // Return false if the connection must be dropped.
+    bool ReadConnection(uint64_t connection_id, Connection* connection);
+
+    // Process the complete frames of the connection. Return false if the
+    // connection must be dropped.
+    bool ProcessFrames(uint64_t connection_id, Connection* connection);
+
+    // Write the queued data of the connection. Return false if the
+    // connection must be dropped. out_is_drained is set if the queue of an
+    // open connection is fully written.
+    bool WriteConnection(Connection* connection, bool* out_is_drained);
+
+    // Remove the connection and call the close handler if it was accepted.
+    void DropConnection(uint64_t connection_id);
+
+    // Wake the event loop up from poll.
+    void WakeEventLoop();
+
+    OpenHandler open_handler_;
+    MessageHandler message_handler_;
+    CloseHandler close_handler_;
+    WritableHandler writable_handler_;
+
+    // Connections by connection ID.
+    std::unordered_map<uint64_t, std::unique_ptr<Connection>> connections_;
+
+    // Mutex for member variables: connections_, the queues of the
+    // connections, stop_event_loop_
+    mutable std::mutex mutex_connections_;
+
+    // ID of the next accepted connection.
+    uint64_t next_connection_id_;
+
+    // Ask the event loop to finish.
+    bool stop_event_loop_;
+
+    // Listening TCP socket.
+    SocketHandle listen_socket_;
+
+    // UDP socket connected to itself. A datagram on it wakes the event loop.
+    SocketHandle wake_socket_;
+
+    // Port of listen_socket_.
+    uint16_t port_;
+
+    std::thread event_loop_thread_;
+  };
+
+} // namespace chatserver
+
+#endif CHATSERVER_WEBSOCKETSERVER_H_ // CHATSERVER_WEBSOCKETSERVER_H_
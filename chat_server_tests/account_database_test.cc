@@ -2,9 +2,14 @@
 // Code style follows Google C++ Style Guide.
 // (https://google.github.io/styleguide/cppguide.html)
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 #include "gtest/gtest.h"
 #include "account_database.h"
 #include "chat_database.h"
+#include "spdlog/spdlog.h"
 
 using namespace std;
 using namespace utility;
@@ -64,4 +69,112 @@ TEST_F(AccountDatabaseTest, Initialization_Fail) {
   EXPECT_EQ(false, account_database_.Initialize(UU("abcdedef.txt")));
 }
 
+TEST_F(AccountDatabaseTest, SignUp_PersistedToFile) {
+  EXPECT_EQ(AccountDatabase::kAuthSuccess,
+            account_database_.SignUp(UU("newbie"), HashString(UU("qwerty12"))));
+  EXPECT_EQ(AccountDatabase::kDuplicateID,
+            account_database_.SignUp(UU("newbie"), HashString(UU("qwerty12"))));
+
+  // The acknowledged signup is in the file database.
+  AccountDatabase reloaded_database;
+  EXPECT_EQ(true, reloaded_database.Initialize(UU("accounts.txt")));
+  EXPECT_EQ(AccountDatabase::kDuplicateID,
+            reloaded_database.SignUp(UU("newbie"), HashString(UU("qwerty12"))));
+}
+
+TEST_F(AccountDatabaseTest, Login_Success) {
+  const string_t nonce = GenerateNonce();
+  EXPECT_EQ(AccountDatabase::kAuthSuccess,
+            account_database_.Login(UU("kaist"),
+                                    HashLoginPassword(UU("12345678"), nonce),
+                                    nonce));
+}
+
+TEST_F(AccountDatabaseTest, Login_Fail) {
+  const string_t nonce = GenerateNonce();
+  EXPECT_EQ(AccountDatabase::kIDNotExist,
+            account_database_.Login(UU("nobody"),
+                                    HashLoginPassword(UU("12345678"), nonce),
+                                    nonce));
+  EXPECT_EQ(AccountDatabase::kPasswordError,
+            account_database_.Login(UU("kaist"),
+                                    HashLoginPassword(UU("abcdefgh"), nonce),
+                                    nonce));
+}
+
+TEST_F(AccountDatabaseTest, Login_ReplayedNonce) {
+  const string_t nonce = GenerateNonce();
+  const string_t password = HashLoginPassword(UU("12345678"), nonce);
+  EXPECT_EQ(AccountDatabase::kAuthSuccess,
+            account_database_.Login(UU("kaist"), password, nonce));
+  EXPECT_EQ(AccountDatabase::kNonceReplayed,
+            account_database_.Login(UU("kaist"), password, nonce));
+}
+
+TEST_F(AccountDatabaseTest, SignUp_ConcurrentDuplicateID) {
+  const size_t kThreadCount = 16;
+  atomic<int> success_count(0);
+  vector<thread> threads;
+  for (size_t i = 0; i < kThreadCount; ++i) {
+    threads.emplace_back([this, &success_count] {
+      if (account_database_.SignUp(UU("racer"), HashString(UU("racer123"))) ==
+          AccountDatabase::kAuthSuccess) {
+        ++success_count;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(1, success_count.load());
+}
+
+// Login throughput at 1-64 threads while another thread keeps signing up.
+// Run with --gtest_also_run_disabled_tests.
+TEST_F(AccountDatabaseTest, DISABLED_Benchmark_LoginThroughput) {
+  const auto kMeasureTime = chrono::milliseconds(500);
+  int signup_index = 0;
+
+  for (size_t thread_count = 1; thread_count <= 64; thread_count *= 2) {
+    atomic<bool> running(true);
+    atomic<long long> login_count(0);
+
+    thread signup_thread([this, &running, &signup_index] {
+      while (running) {
+        account_database_.SignUp(
+            conversions::to_string_t("bench" + to_string(signup_index++)),
+            HashString(UU("benchmark")));
+      }
+    });
+
+    vector<thread> login_threads;
+    for (size_t i = 0; i < thread_count; ++i) {
+      login_threads.emplace_back([&, i] {
+        long long count = 0;
+        while (running) {
+          // Every login uses a new nonce like a real client.
+          const string_t nonce = conversions::to_string_t(
+              to_string(thread_count) + "_" + to_string(i) + "_" +
+              to_string(count));
+          account_database_.Login(UU("kaist"),
+                                  HashLoginPassword(UU("12345678"), nonce),
+                                  nonce);
+          ++count;
+        }
+        login_count += count;
+      });
+    }
+
+    this_thread::sleep_for(kMeasureTime);
+    running = false;
+    for (auto& login_thread : login_threads) {
+      login_thread.join();
+    }
+    signup_thread.join();
+
+    spdlog::info("threads: {}, logins/s: {}", thread_count,
+                 login_count * 1000 / kMeasureTime.count());
+  }
+}
+
 // ToDo: Implement unit tests.
\ No newline at end of file
@@ -0,0 +1,75 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "gtest/gtest.h"
+#include "account_writer.h"
+
+using namespace std;
+using namespace utility;
+using namespace chatserver;
+
+// Fixture class for account_writer.h testing.
+class AccountWriterTest : public ::testing::Test {
+ protected:
+  const string_t kFileName = UU("account_writer_test.txt");
+
+  void SetUp() override {
+    wofstream file(kFileName, wofstream::out | ofstream::trunc);
+    file.close();
+  }
+
+  void TearDown() override {
+    EXPECT_EQ(0, remove("account_writer_test.txt"));
+  }
+
+  vector<string_t> ReadLines() const {
+    wifstream file(kFileName);
+    vector<string_t> lines;
+    string_t line;
+    while (getline(file, line)) {
+      lines.push_back(line);
+    }
+    return lines;
+  }
+};
+
+TEST_F(AccountWriterTest, Append_Success) {
+  {
+    AccountWriter account_writer;
+    EXPECT_EQ(true, account_writer.Open(kFileName));
+    EXPECT_EQ(true, account_writer.Append(UU("kaist,1234")).get());
+    // The record is on disk before the writer is closed.
+    const vector<string_t> lines = ReadLines();
+    ASSERT_EQ(1, lines.size());
+    EXPECT_EQ(UU("kaist,1234"), lines[0]);
+  }
+}
+
+TEST_F(AccountWriterTest, Append_ConcurrentRecords) {
+  const size_t kThreadCount = 8;
+  const size_t kRecordsPerThread = 50;
+  {
+    AccountWriter account_writer;
+    EXPECT_EQ(true, account_writer.Open(kFileName));
+    vector<thread> threads;
+    for (size_t i = 0; i < kThreadCount; ++i) {
+      threads.emplace_back([&account_writer, i, kRecordsPerThread] {
+        for (size_t j = 0; j < kRecordsPerThread; ++j) {
+          const string_t record = conversions::to_string_t(
+              to_string(i) + "_" + to_string(j) + ",1234");
+          EXPECT_EQ(true, account_writer.Append(record).get());
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+  EXPECT_EQ(kThreadCount * kRecordsPerThread, ReadLines().size());
+}
+
+TEST_F(AccountWriterTest, Append_NotOpened) {
+  AccountWriter account_writer;
+  EXPECT_EQ(false, account_writer.Append(UU("kaist,1234")).get());
+}
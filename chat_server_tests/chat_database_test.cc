@@ -41,4 +41,127 @@ TEST_F(ChatDatabaseTest, Initialization_success) {
   EXPECT_EQ(true, chat_database_.Initialize(UU("chat_messages.txt"), UU("chat_room.txt")));
 }
 
-// ToDo: Implement unit tests.
\ No newline at end of file
+TEST_F(ChatDatabaseTest, GetChatMessages_Since) {
+  vector<ChatMessage> chat_messages;
+  size_t cursor = 0;
+  EXPECT_EQ(true, chat_database_.GetChatMessages(UU("a"), 1, &chat_messages,
+                                                 &cursor));
+  ASSERT_EQ(1, chat_messages.size());
+  EXPECT_EQ(UU("hello"), chat_messages[0].chat_message);
+  EXPECT_EQ(2, cursor);
+
+  // A cursor past the end reads nothing.
+  EXPECT_EQ(true, chat_database_.GetChatMessages(UU("a"), 5, &chat_messages,
+                                                 &cursor));
+  EXPECT_EQ(0, chat_messages.size());
+  EXPECT_EQ(2, cursor);
+
+  EXPECT_EQ(false, chat_database_.GetChatMessages(UU("z"), 0, &chat_messages,
+                                                  &cursor));
+}
+
+TEST_F(ChatDatabaseTest, StoreChatMessage_Success) {
+  string_t notified_room;
+  size_t notified_count = 0;
+  chat_database_.SetChatMessageListener(
+      [&](const ChatMessage& chat_message, size_t message_count) {
+        notified_room = chat_message.chat_room;
+        notified_count = message_count;
+      });
+  EXPECT_EQ(true, chat_database_.StoreChatMessage(
+                      ChatMessage(1583581787, UU("gsis"), UU("b"), UU("hi"))));
+  EXPECT_EQ(UU("b"), notified_room);
+  EXPECT_EQ(2, notified_count);
+
+  // The message is read back from the file database.
+  ChatDatabase reloaded_chat_database;
+  EXPECT_EQ(true, reloaded_chat_database.Initialize(UU("chat_messages.txt"),
+                                                    UU("chat_room.txt")));
+  vector<ChatMessage> chat_messages;
+  size_t cursor = 0;
+  EXPECT_EQ(true, reloaded_chat_database.GetChatMessages(
+                      UU("b"), 0, &chat_messages, &cursor));
+  ASSERT_EQ(2, chat_messages.size());
+  EXPECT_EQ(ChatMessage(1583581787, UU("gsis"), UU("b"), UU("hi")),
+            chat_messages[1]);
+}
+
+TEST_F(ChatDatabaseTest, StoreChatMessage_Fail) {
+  // Delimiter in the message.
+  EXPECT_EQ(false, chat_database_.StoreChatMessage(ChatMessage(
+                       1583581787, UU("gsis"), UU("b"),
+                       UU("a") + kParsingDelimeterChatDb + UU("b"))));
+  // Not exist chat room.
+  EXPECT_EQ(false, chat_database_.StoreChatMessage(
+                       ChatMessage(1583581787, UU("gsis"), UU("z"), UU("hi"))));
+}
+
+TEST_F(ChatDatabaseTest, StoreChatMessages_Success) {
+  vector<size_t> notified_counts;
+  chat_database_.SetChatMessageListener(
+      [&](const ChatMessage&, size_t message_count) {
+        notified_counts.push_back(message_count);
+      });
+  const vector<ChatMessage> messages = {
+      ChatMessage(1583581787, UU("gsis"), UU("a"), UU("one")),
+      ChatMessage(1583581787, UU("gsis"), UU("b"), UU("two")),
+      ChatMessage(1583581787, UU("gsis"), UU("a"), UU("three"))};
+  EXPECT_EQ(true, chat_database_.StoreChatMessages(messages));
+  ASSERT_EQ(3, notified_counts.size());
+  EXPECT_EQ(3, notified_counts[0]);
+  EXPECT_EQ(2, notified_counts[1]);
+  EXPECT_EQ(4, notified_counts[2]);
+
+  // The messages are read back from the file database.
+  ChatDatabase reloaded_chat_database;
+  EXPECT_EQ(true, reloaded_chat_database.Initialize(UU("chat_messages.txt"),
+                                                    UU("chat_room.txt")));
+  vector<ChatMessage> chat_messages;
+  size_t cursor = 0;
+  EXPECT_EQ(true, reloaded_chat_database.GetChatMessages(
+                      UU("a"), 2, &chat_messages, &cursor));
+  ASSERT_EQ(2, chat_messages.size());
+  EXPECT_EQ(messages[0], chat_messages[0]);
+  EXPECT_EQ(messages[2], chat_messages[1]);
+}
+
+TEST_F(ChatDatabaseTest, StoreChatMessages_FailStoresNone) {
+  // The second message names a chat room that does not exist.
+  EXPECT_EQ(false, chat_database_.StoreChatMessages(
+                       {ChatMessage(1583581787, UU("gsis"), UU("a"), UU("1")),
+                        ChatMessage(1583581787, UU("gsis"), UU("z"),
+                                    UU("2"))}));
+  vector<ChatMessage> chat_messages;
+  size_t cursor = 0;
+  EXPECT_EQ(true, chat_database_.GetChatMessages(UU("a"), 0, &chat_messages,
+                                                 &cursor));
+  EXPECT_EQ(2, cursor);
+}
+
+TEST_F(ChatDatabaseTest, StoreChatMessage_NonAsciiRoundTrip) {
+  const string_t chat_room = UU("\uBC29");
+  const ChatMessage message(1583581787, UU("gsis"), chat_room,
+                            UU("\uC548\uB155 \u00E9"));
+  EXPECT_EQ(true, chat_database_.CreateChatRoom(chat_room));
+  EXPECT_EQ(true, chat_database_.StoreChatMessage(message));
+
+  // The UTF-8 files are read back to the same text.
+  ChatDatabase reloaded_chat_database;
+  EXPECT_EQ(true, reloaded_chat_database.Initialize(UU("chat_messages.txt"),
+                                                    UU("chat_room.txt")));
+  EXPECT_EQ(true, reloaded_chat_database.IsExistChatRoom(chat_room));
+  vector<ChatMessage> chat_messages;
+  size_t cursor = 0;
+  EXPECT_EQ(true, reloaded_chat_database.GetChatMessages(
+                      chat_room, 0, &chat_messages, &cursor));
+  ASSERT_EQ(1, chat_messages.size());
+  EXPECT_EQ(message, chat_messages[0]);
+}
+
+TEST_F(ChatDatabaseTest, GetChatRoomList_Copy) {
+  const vector<string_t> chat_rooms = chat_database_.GetChatRoomList();
+  EXPECT_EQ(true, chat_database_.CreateChatRoom(UU("d")));
+  // The copy is not changed by a new chat room.
+  EXPECT_EQ(3, chat_rooms.size());
+  EXPECT_EQ(4, chat_database_.GetChatRoomList().size());
+}
@@ -0,0 +1,139 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include <algorithm>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "chat_message_decoder.h"
+
+using namespace std;
+using namespace utility;
+using namespace chatserver;
+
+namespace {
+
+  // Decode the body in chunks of chunk_size bytes.
+  ChatMessageDecoder::Status DecodeBody(ChatMessageDecoder* decoder,
+                                        const string& body,
+                                        size_t chunk_size) {
+    for (size_t i = 0; i < body.size(); i += chunk_size) {
+      const ChatMessageDecoder::Status status = decoder->Decode(
+          reinterpret_cast<const uint8_t*>(body.data()) + i,
+          min(chunk_size, body.size() - i));
+      if (status != ChatMessageDecoder::kDecoding) {
+        return status;
+      }
+    }
+    return decoder->Finish();
+  }
+
+} // namespace
+
+TEST(ChatMessageDecoderTest, Decode_JsonBody) {
+  ChatMessage chat_message;
+  ChatMessageDecoder decoder(ChatMessageDecoder::kJsonBody, 1024,
+                             &chat_message);
+  EXPECT_EQ(ChatMessageDecoder::kDecoded,
+            DecodeBody(&decoder,
+                       " {\"chat_room\": \"gsis\", \"other\": \"x\",\n"
+                       "  \"chat_message\": \"say \\\"hi\\\"\"} ",
+                       1));
+  EXPECT_EQ(UU("gsis"), chat_message.chat_room);
+  EXPECT_EQ(UU("say \"hi\""), chat_message.chat_message);
+}
+
+TEST(ChatMessageDecoderTest, Decode_JsonUnicode) {
+  ChatMessage chat_message;
+  ChatMessageDecoder decoder(ChatMessageDecoder::kJsonBody, 1024,
+                             &chat_message);
+  // UTF-8 text and \u escapes decode to the same characters.
+  EXPECT_EQ(ChatMessageDecoder::kDecoded,
+            DecodeBody(&decoder,
+                       "{\"chat_message\": \"\xEC\x95\x88\\uc548\"}", 3));
+  EXPECT_EQ(UU("\uC548\uC548"), chat_message.chat_message);
+}
+
+TEST(ChatMessageDecoderTest, Decode_JsonKeepsQueryRoom) {
+  ChatMessage chat_message;
+  chat_message.chat_room = UU("gsis");
+  ChatMessageDecoder decoder(ChatMessageDecoder::kJsonBody, 1024,
+                             &chat_message);
+  EXPECT_EQ(ChatMessageDecoder::kDecoded,
+            DecodeBody(&decoder, "{\"chat_message\": \"hi\"}", 4));
+  EXPECT_EQ(UU("gsis"), chat_message.chat_room);
+}
+
+TEST(ChatMessageDecoderTest, Decode_JsonMalformed) {
+  const string bodies[] = {
+      "", "{}", "{\"chat_message\": \"hi\"", "{\"chat_message\": 1}",
+      "{\"chat_message\": \"hi\",}", "{\"chat_message\": \"\\x\"}",
+      "{\"chat_message\": \"\\ud800\"}", "{\"chat_message\": \"\xFF\"}",
+      "{\"chat_message\": \"hi\"} x"};
+  for (const string& body : bodies) {
+    ChatMessage chat_message;
+    ChatMessageDecoder decoder(ChatMessageDecoder::kJsonBody, 1024,
+                               &chat_message);
+    EXPECT_EQ(ChatMessageDecoder::kMalformed,
+              DecodeBody(&decoder, body, 2)) << body;
+  }
+}
+
+TEST(ChatMessageDecoderTest, Decode_JsonArrayBody) {
+  const ChatMessage message_template(1583581787, UU("gsis"), UU("a"),
+                                     UU(""));
+  vector<ChatMessage> chat_messages;
+  ChatMessageDecoder decoder(1024, message_template, &chat_messages);
+  EXPECT_EQ(ChatMessageDecoder::kDecoded,
+            DecodeBody(&decoder,
+                       "[{\"chat_message\": \"one\"},\n"
+                       " {\"chat_room\": \"b\", \"chat_message\": \"two\"}]",
+                       5));
+  ASSERT_EQ(2, chat_messages.size());
+  EXPECT_EQ(ChatMessage(1583581787, UU("gsis"), UU("a"), UU("one")),
+            chat_messages[0]);
+  EXPECT_EQ(ChatMessage(1583581787, UU("gsis"), UU("b"), UU("two")),
+            chat_messages[1]);
+}
+
+TEST(ChatMessageDecoderTest, Decode_JsonArrayMalformed) {
+  const string bodies[] = {
+      "", "{\"chat_message\": \"hi\"}", "[{\"chat_message\": \"hi\"}",
+      "[{\"chat_message\": \"hi\"},]", "[{\"chat_room\": \"a\"}]",
+      "[\"hi\"]"};
+  for (const string& body : bodies) {
+    vector<ChatMessage> chat_messages;
+    ChatMessageDecoder decoder(
+        1024, ChatMessage(1583581787, UU("gsis"), UU("a"), UU("")),
+        &chat_messages);
+    EXPECT_EQ(ChatMessageDecoder::kMalformed,
+              DecodeBody(&decoder, body, 3)) << body;
+  }
+}
+
+TEST(ChatMessageDecoderTest, Decode_RawBody) {
+  ChatMessage chat_message;
+  ChatMessageDecoder decoder(ChatMessageDecoder::kRawBody, 1024,
+                             &chat_message);
+  // The UTF-8 sequence is split across chunks.
+  EXPECT_EQ(ChatMessageDecoder::kDecoded,
+            DecodeBody(&decoder, "hi \xEC\x95\x88", 4));
+  EXPECT_EQ(UU("hi \uC548"), chat_message.chat_message);
+}
+
+TEST(ChatMessageDecoderTest, Decode_RawTruncated) {
+  ChatMessage chat_message;
+  ChatMessageDecoder decoder(ChatMessageDecoder::kRawBody, 1024,
+                             &chat_message);
+  EXPECT_EQ(ChatMessageDecoder::kMalformed,
+            DecodeBody(&decoder, "hi \xEC\x95", 4));
+}
+
+TEST(ChatMessageDecoderTest, Decode_TooLarge) {
+  ChatMessage chat_message;
+  ChatMessageDecoder decoder(ChatMessageDecoder::kRawBody, 8,
+                             &chat_message);
+  EXPECT_EQ(ChatMessageDecoder::kTooLarge,
+            DecodeBody(&decoder, "more than eight bytes", 4));
+}
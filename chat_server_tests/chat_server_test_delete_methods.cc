@@ -12,5 +12,36 @@ using namespace utility;
 using namespace chatserver;
 using namespace chatservertests;
 using namespace web;
+using ::web::http::http_response;
+
+TEST_F(ChatServerTest, Delete_Logout_Success) {
+  ostringstream_t buf;
+  buf << "session" << UU("?session_id=") << CreateSessionId(UU("kaist"));
+  http_response response = http_client_->request(
+      http::methods::DEL, uri::encode_uri(buf.str())).get();
+  EXPECT_EQ(response.status_code(), http::status_codes::OK);
+
+  // The session is gone after logout.
+  response = http_client_->request(
+      http::methods::DEL, uri::encode_uri(buf.str())).get();
+  EXPECT_EQ(response.status_code(), http::status_codes::Forbidden);
+}
+
+TEST_F(ChatServerTest, Delete_LogoutAll_Success) {
+  const string_t other_session_id = CreateSessionId(UU("kaist"));
+  ostringstream_t buf;
+  buf << "session" << UU("?session_id=") << CreateSessionId(UU("kaist"))
+      << UU("&all=true");
+  http_response response = http_client_->request(
+      http::methods::DEL, uri::encode_uri(buf.str())).get();
+  EXPECT_EQ(response.status_code(), http::status_codes::OK);
+
+  // The other session of the user is gone too.
+  buf.str(string_t());
+  buf << "session" << UU("?session_id=") << other_session_id;
+  response = http_client_->request(
+      http::methods::DEL, uri::encode_uri(buf.str())).get();
+  EXPECT_EQ(response.status_code(), http::status_codes::Forbidden);
+}
 
 // ToDo: Implement unit tests.
\ No newline at end of file
@@ -24,6 +24,9 @@ namespace chatservertests {
     // Delimiter in the chat message file database.
     utility::string_t kParsingDelimeterChatDb = UU("|");
 
+    // Port of the WebSocket server.
+    const uint16_t kWebSocketPort = 34569;
+
     // Length of nonce
     const size_t kNonceLength = 10;
     // Nonce seed.
@@ -95,6 +98,7 @@ namespace chatservertests {
 
       EXPECT_EQ(concurrency::task_status::completed, 
                 chat_server_->OpenServer().wait());
+      EXPECT_EQ(true, chat_server_->OpenWebSocketServer(kWebSocketPort));
 
       // Make HTTP client for making a request to chat server.
       http_client_ = std::make_unique<web::http::client::http_client>(address);
@@ -104,6 +108,9 @@ namespace chatservertests {
       EXPECT_EQ(concurrency::task_status::completed, 
                 chat_server_->CloseServer().wait());
       chat_server_.reset();
+      // The databases keep their files open until they are destroyed.
+      account_database_.reset();
+      chat_database_.reset();
       EXPECT_EQ(0, remove("accounts_test_chat_server.txt"));
       EXPECT_EQ(0, remove("chat_message_test_chat_server.txt"));
       EXPECT_EQ(0, remove("chat_room_test_chat_server.txt"));
@@ -130,6 +137,11 @@ namespace chatservertests {
       return result;
     }
 
+    // Create a session of the given user without the login API.
+    utility::string_t CreateSessionId(const utility::string_t& user_id) {
+      return session_manager_->CreateSession(user_id).session_id;
+    }
+
    private:
     std::unique_ptr<chatserver::ChatDatabase> chat_database_;
     std::unique_ptr<chatserver::AccountDatabase> account_database_;
@@ -4,6 +4,7 @@
 
 #include "chat_server.h"
 #include "gtest/gtest.h"
+#include "cpprest/containerstream.h"
 #include "cpprest/http_client.h"
 #include "chat_server_test_fixture.h"
 
@@ -13,4 +14,52 @@ using namespace chatserver;
 using namespace chatservertests;
 using namespace web;
 
-// ToDo: Implement unit tests.
\ No newline at end of file
+TEST_F(ChatServerTest, Get_ChatMessage_LongPoll) {
+  const string_t session_id = CreateSessionId(UU("kaist"));
+  ostringstream_t buf;
+  buf << "chatmessage" << UU("?chat_room=") << "3" << UU("&session_id=")
+      << session_id << UU("&since=1&wait=10");
+  pplx::task<http::http_response> response_task = http_client_->request(
+      http::methods::GET, uri::encode_uri(buf.str()));
+
+  // The parked request is replied by the next message of the room.
+  ostringstream_t post_buf;
+  post_buf << "chatmessage" << UU("?chat_room=") << "3"
+           << UU("&chat_message=") << "hi" << UU("&session_id=")
+           << session_id;
+  EXPECT_EQ(http::status_codes::OK,
+            http_client_->request(http::methods::POST,
+                                  uri::encode_uri(post_buf.str()))
+                .get().status_code());
+
+  http::http_response response = response_task.get();
+  EXPECT_EQ(http::status_codes::OK, response.status_code());
+  json::value body = response.extract_json().get();
+  EXPECT_EQ(2, body[UU("cursor")].as_integer());
+  EXPECT_EQ(UU("hi"), body[UU("chat_messages")][0][UU("chat_message")]
+                          .as_string());
+}
+
+TEST_F(ChatServerTest, Get_ChatMessage_Stream) {
+  const string_t session_id = CreateSessionId(UU("kaist"));
+  ostringstream_t buf;
+  buf << "chatmessage/stream" << UU("?chat_room=") << "3"
+      << UU("&session_id=") << session_id;
+  http::http_request request(http::methods::GET);
+  request.set_request_uri(uri::encode_uri(buf.str()));
+  // Resume from the beginning of the room.
+  request.headers().add(UU("Last-Event-ID"), UU("0"));
+  http::http_response response = http_client_->request(request).get();
+  EXPECT_EQ(http::status_codes::OK, response.status_code());
+  EXPECT_EQ(UU("text/event-stream"), response.headers().content_type());
+
+  // The first event is the first message of the room.
+  concurrency::streams::container_buffer<vector<uint8_t>> event_buffer;
+  string events;
+  while (events.find("\n\n", events.find("id: 1")) == string::npos &&
+         response.body().read(event_buffer, 1).get() > 0) {
+    events.assign(event_buffer.collection().begin(),
+                  event_buffer.collection().end());
+  }
+  EXPECT_NE(string::npos, events.find("id: 1\nevent: chat_message\ndata: {"));
+}
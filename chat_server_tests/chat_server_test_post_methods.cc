@@ -27,4 +27,93 @@ TEST_F(ChatServerTest, Post_CreateAccount_Success) {
   EXPECT_EQ(response.status_code(), http::status_codes::OK);
 }
 
+TEST_F(ChatServerTest, Post_Login_Success) {
+  ostringstream_t buf;
+  const string_t nonce = GenerateNonce();
+  buf << "login" << UU("?id=") << "kaist"
+      << UU("&password=") << HashLoginPassword(UU("12345678"), nonce)
+      << UU("&nonce=") << nonce;
+  http_response response = http_client_->request(
+      http::methods::POST, uri::encode_uri(buf.str())).get();
+  EXPECT_EQ(response.status_code(), http::status_codes::OK);
+}
+
+TEST_F(ChatServerTest, Post_Login_Fail) {
+  ostringstream_t buf;
+  const string_t nonce = GenerateNonce();
+  buf << "login" << UU("?id=") << "kaist"
+      << UU("&password=") << HashLoginPassword(UU("wrong_pwd"), nonce)
+      << UU("&nonce=") << nonce;
+  http_response response = http_client_->request(
+      http::methods::POST, uri::encode_uri(buf.str())).get();
+  EXPECT_EQ(response.status_code(), http::status_codes::BadRequest);
+}
+
+TEST_F(ChatServerTest, Post_Login_MissingNonce) {
+  ostringstream_t buf;
+  buf << "login" << UU("?id=") << "kaist"
+      << UU("&password=") << HashString(UU("12345678"));
+  http_response response = http_client_->request(
+      http::methods::POST, uri::encode_uri(buf.str())).get();
+  EXPECT_EQ(response.status_code(), http::status_codes::BadRequest);
+}
+
+TEST_F(ChatServerTest, Post_UnknownPath_NotFound) {
+  http_response response = http_client_->request(
+      http::methods::POST, uri::encode_uri(UU("unknown"))).get();
+  EXPECT_EQ(response.status_code(), http::status_codes::NotFound);
+}
+
+TEST_F(ChatServerTest, Post_ChatMessage_JsonBody) {
+  const string_t session_id = CreateSessionId(UU("kaist"));
+  const string_t path =
+      uri::encode_uri(UU("chatmessage?session_id=") + session_id);
+  value body = value::object();
+  body[UU("chat_room")] = value::string(UU("3"));
+  body[UU("chat_message")] = value::string(UU("hi \"there\""));
+  http_response response =
+      http_client_->request(http::methods::POST, path, body).get();
+  EXPECT_EQ(response.status_code(), http::status_codes::OK);
+
+  // The body ends inside the object.
+  response = http_client_->request(http::methods::POST, path,
+                                   UU("{\"chat_room\": \"3\""),
+                                   UU("application/json")).get();
+  EXPECT_EQ(response.status_code(), http::status_codes::BadRequest);
+}
+
+TEST_F(ChatServerTest, Post_ChatMessage_TextBody) {
+  const string_t session_id = CreateSessionId(UU("kaist"));
+  http_response response = http_client_->request(
+      http::methods::POST,
+      uri::encode_uri(UU("chatmessage?chat_room=3&session_id=") +
+                      session_id),
+      UU("hi"), UU("text/plain")).get();
+  EXPECT_EQ(response.status_code(), http::status_codes::OK);
+
+  // A text body needs the chat room in the query.
+  response = http_client_->request(
+      http::methods::POST,
+      uri::encode_uri(UU("chatmessage?session_id=") + session_id),
+      UU("hi"), UU("text/plain")).get();
+  EXPECT_EQ(response.status_code(), http::status_codes::BadRequest);
+}
+
+TEST_F(ChatServerTest, Post_ChatMessageBatch) {
+  const string_t session_id = CreateSessionId(UU("kaist"));
+  const string_t path = uri::encode_uri(
+      UU("chatmessage/batch?chat_room=3&session_id=") + session_id);
+  value body = value::array(2);
+  body[0][UU("chat_message")] = value::string(UU("one"));
+  body[1][UU("chat_message")] = value::string(UU("two"));
+  http_response response =
+      http_client_->request(http::methods::POST, path, body).get();
+  EXPECT_EQ(response.status_code(), http::status_codes::OK);
+
+  // A message for a chat room that does not exist fails the whole batch.
+  body[1][UU("chat_room")] = value::string(UU("not exist room"));
+  response = http_client_->request(http::methods::POST, path, body).get();
+  EXPECT_EQ(response.status_code(), http::status_codes::BadRequest);
+}
+
 // ToDo: Implement unit tests.
\ No newline at end of file
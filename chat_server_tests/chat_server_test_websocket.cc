@@ -0,0 +1,108 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include <future>
+
+#include "chat_server.h"
+#include "gtest/gtest.h"
+#include "cpprest/http_client.h"
+#include "cpprest/ws_client.h"
+#include "chat_server_test_fixture.h"
+
+using namespace std;
+using namespace utility;
+using namespace chatserver;
+using namespace chatservertests;
+using namespace web;
+using ::web::websockets::client::websocket_callback_client;
+using ::web::websockets::client::websocket_incoming_message;
+using ::web::websockets::client::websocket_outgoing_message;
+
+TEST_F(ChatServerTest, WebSocket_SubscribeAndPush) {
+  const string_t session_id = CreateSessionId(UU("kaist"));
+  websocket_callback_client websocket_client;
+  promise<string> pushed_message;
+  websocket_client.set_message_handler(
+      [&pushed_message](const websocket_incoming_message& message) {
+        pushed_message.set_value(message.extract_string().get());
+      });
+  websocket_client.connect(
+      uri(UU("ws://localhost:34569/chatstream?session_id=") + session_id))
+      .wait();
+
+  websocket_outgoing_message subscribe_message;
+  subscribe_message.set_utf8_message(
+      "{\"type\": \"subscribe\", \"chat_room\": \"2\"}");
+  websocket_client.send(subscribe_message).wait();
+  websocket_outgoing_message chat_message;
+  chat_message.set_utf8_message(
+      "{\"type\": \"chat_message\", \"chat_room\": \"2\", "
+      "\"chat_message\": \"hi\"}");
+  websocket_client.send(chat_message).wait();
+
+  future<string> pushed = pushed_message.get_future();
+  ASSERT_EQ(future_status::ready, pushed.wait_for(chrono::seconds(5)));
+  json::value push =
+      json::value::parse(conversions::to_string_t(pushed.get()));
+  EXPECT_EQ(UU("chat_message"), push[UU("type")].as_string());
+  EXPECT_EQ(UU("kaist"), push[UU("user_id")].as_string());
+  EXPECT_EQ(UU("hi"), push[UU("chat_message")].as_string());
+  EXPECT_EQ(2, push[UU("cursor")].as_integer());
+  websocket_client.close().wait();
+}
+
+TEST_F(ChatServerTest, WebSocket_InvalidSession) {
+  websocket_callback_client websocket_client;
+  EXPECT_ANY_THROW(
+      websocket_client.connect(
+          uri(UU("ws://localhost:34569/chatstream?session_id=wrong")))
+      .wait());
+}
+
+TEST_F(ChatServerTest, WebSocket_SlowClientGetsGap) {
+  // A queue of one message overflows as soon as the sender falls behind.
+  chat_server_->SetSubscriberQueuePolicy(1, SubscriberQueue::kDropOldest);
+  const string_t session_id = CreateSessionId(UU("kaist"));
+  websocket_callback_client websocket_client;
+  promise<void> gap_received;
+  bool is_gap_received = false;
+  mutex mutex_gap_received;
+  websocket_client.set_message_handler(
+      [&](const websocket_incoming_message& message) {
+        json::value push = json::value::parse(
+            conversions::to_string_t(message.extract_string().get()));
+        lock_guard<mutex> lock(mutex_gap_received);
+        if (!is_gap_received && push[UU("type")].is_string() &&
+            push[UU("type")].as_string() == UU("gap")) {
+          is_gap_received = true;
+          gap_received.set_value();
+        }
+      });
+  websocket_client.connect(
+      uri(UU("ws://localhost:34569/chatstream?session_id=") + session_id))
+      .wait();
+  websocket_outgoing_message subscribe_message;
+  subscribe_message.set_utf8_message(
+      "{\"type\": \"subscribe\", \"chat_room\": \"3\"}");
+  websocket_client.send(subscribe_message).wait();
+
+  // One batch publishes its messages faster than one connection sends them.
+  json::value body = json::value::array(200);
+  for (size_t i = 0; i < 200; ++i) {
+    body[i][UU("chat_message")] = json::value::string(UU("flood"));
+  }
+  http::http_response response = http_client_->request(
+      http::methods::POST,
+      UU("chatmessage/batch?chat_room=3&session_id=") + session_id,
+      body).get();
+  ASSERT_EQ(http::status_codes::OK, response.status_code());
+
+  future<void> gap = gap_received.get_future();
+  ASSERT_EQ(future_status::ready, gap.wait_for(chrono::seconds(5)));
+  const SubscriberQueue::Metrics metrics =
+      chat_server_->GetSubscriberQueueMetrics();
+  EXPECT_LE(1u, metrics.dropped_messages);
+  EXPECT_LE(1u, metrics.gap_notices);
+  websocket_client.close().wait();
+}
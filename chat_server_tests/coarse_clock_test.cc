@@ -0,0 +1,31 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include <chrono>
+#include <ctime>
+#include <thread>
+
+#include "coarse_clock.h"
+#include "gtest/gtest.h"
+
+using namespace std;
+using namespace chatserver;
+
+TEST(CoarseClockTest, Now) {
+  const time_t before = time(nullptr);
+  const time_t now = CoarseClock::GetInstance().Now();
+  const time_t after = time(nullptr);
+  // The clock lags behind by at most one tick.
+  EXPECT_LE(before - 1, now);
+  EXPECT_GE(after, now);
+}
+
+TEST(CoarseClockTest, NowMilliseconds) {
+  CoarseClock& coarse_clock = CoarseClock::GetInstance();
+  const int64_t start = coarse_clock.NowMilliseconds();
+  this_thread::sleep_for(chrono::milliseconds(100));
+  const int64_t end = coarse_clock.NowMilliseconds();
+  EXPECT_LE(start + 50, end);
+  EXPECT_GE(start + 1000, end);
+}
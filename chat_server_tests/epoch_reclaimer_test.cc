@@ -0,0 +1,105 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "epoch_reclaimer.h"
+#include "gtest/gtest.h"
+
+using namespace std;
+using namespace chatserver;
+
+TEST(EpochReclaimerTest, Reclaim_NoReader) {
+  EpochReclaimer epoch_reclaimer;
+  bool freed = false;
+  epoch_reclaimer.Retire([&freed] { freed = true; });
+  epoch_reclaimer.Reclaim();
+  EXPECT_EQ(true, freed);
+}
+
+TEST(EpochReclaimerTest, Reclaim_WaitForReader) {
+  EpochReclaimer epoch_reclaimer;
+  bool freed = false;
+  {
+    EpochReclaimer::ReadGuard guard(&epoch_reclaimer);
+    epoch_reclaimer.Retire([&freed] { freed = true; });
+    epoch_reclaimer.Reclaim();
+    // The reader entered before the object was retired.
+    EXPECT_EQ(false, freed);
+  }
+  epoch_reclaimer.Reclaim();
+  EXPECT_EQ(true, freed);
+}
+
+TEST(EpochReclaimerTest, Reclaim_LaterReader) {
+  EpochReclaimer epoch_reclaimer;
+  bool freed = false;
+  epoch_reclaimer.Retire([&freed] { freed = true; });
+  // A reader entering after the retire cannot see the object.
+  EpochReclaimer::ReadGuard guard(&epoch_reclaimer);
+  epoch_reclaimer.Reclaim();
+  EXPECT_EQ(true, freed);
+}
+
+TEST(EpochReclaimerTest, Destructor_FreeRetired) {
+  bool freed = false;
+  {
+    EpochReclaimer epoch_reclaimer;
+    {
+      EpochReclaimer::ReadGuard guard(&epoch_reclaimer);
+      epoch_reclaimer.Retire([&freed] { freed = true; });
+    }
+  }
+  EXPECT_EQ(true, freed);
+}
+
+TEST(EpochReclaimerTest, Reclaim_ReadersEnterDuringReclaim) {
+  // Nodes are never freed by the test; a reclaimed node is only marked, so
+  // that a reader seeing a reclaimed node can be detected safely.
+  struct Node {
+    atomic<bool> is_reclaimed{false};
+  };
+  const int kNodeCount = 20000;
+  vector<unique_ptr<Node>> nodes;
+  for (int i = 0; i < kNodeCount; ++i) {
+    nodes.push_back(make_unique<Node>());
+  }
+
+  EpochReclaimer epoch_reclaimer;
+  atomic<Node*> head(nodes[0].get());
+  atomic<bool> is_writing(true);
+  atomic<int> reclaimed_reads(0);
+  vector<thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&] {
+      while (is_writing) {
+        EpochReclaimer::ReadGuard guard(&epoch_reclaimer);
+        Node* node = head.load();
+        for (int j = 0; j < 16; ++j) {
+          if (node->is_reclaimed) {
+            ++reclaimed_reads;
+          }
+        }
+      }
+    });
+  }
+  threads.emplace_back([&] {
+    while (is_writing) {
+      epoch_reclaimer.Reclaim();
+    }
+  });
+
+  for (int i = 1; i < kNodeCount; ++i) {
+    Node* old_node = head.exchange(nodes[i].get());
+    epoch_reclaimer.Retire([old_node] { old_node->is_reclaimed = true; });
+  }
+  is_writing = false;
+  for (auto& test_thread : threads) {
+    test_thread.join();
+  }
+  EXPECT_EQ(0, reclaimed_reads);
+}
@@ -0,0 +1,42 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "gtest/gtest.h"
+#include "event_stream.h"
+
+using namespace std;
+using namespace chatserver;
+
+TEST(EventStreamTest, FormatEvent) {
+  EXPECT_EQ("id: 3\nevent: chat_message\ndata: {\"a\":1}\n\n",
+            EventStream::FormatEvent(3, "chat_message", "{\"a\":1}"));
+  // Each line of the data is a data field.
+  EXPECT_EQ("id: 4\nevent: e\ndata: a\ndata: \ndata: b\n\n",
+            EventStream::FormatEvent(4, "e", "a\n\nb"));
+}
+
+TEST(EventStreamTest, WriteEvent_Consecutive) {
+  EventStream event_stream(5);
+  EXPECT_EQ(5, event_stream.last_event_id());
+  // Already written.
+  EXPECT_EQ(true, event_stream.WriteEvent(5, "e", "old"));
+  // An earlier event is still to be written.
+  EXPECT_EQ(true, event_stream.WriteEvent(7, "e", "later"));
+  EXPECT_EQ(5, event_stream.last_event_id());
+  EXPECT_EQ(true, event_stream.WriteEvent(6, "e", "next"));
+  EXPECT_EQ(6, event_stream.last_event_id());
+
+  event_stream.Close();
+  EXPECT_EQ(true, event_stream.is_closed());
+  EXPECT_EQ(false, event_stream.WriteEvent(7, "e", "closed"));
+}
+
+TEST(EventStreamTest, WriteHeartbeat) {
+  EventStream event_stream(5);
+  EXPECT_EQ(true, event_stream.WriteHeartbeat());
+  // A heartbeat is not an event.
+  EXPECT_EQ(5, event_stream.last_event_id());
+  event_stream.Close();
+  EXPECT_EQ(false, event_stream.WriteHeartbeat());
+}
@@ -0,0 +1,55 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include <future>
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+#include "hash_worker_pool.h"
+
+using namespace std;
+using namespace chatserver;
+
+TEST(HashWorkerPoolTest, Run_Success) {
+  HashWorkerPool hash_worker_pool(2, 16);
+  pplx::task<int> task;
+  EXPECT_EQ(true, hash_worker_pool.Run<int>([] { return 42; }, &task));
+  EXPECT_EQ(42, task.get());
+}
+
+TEST(HashWorkerPoolTest, Submit_QueueFull) {
+  HashWorkerPool hash_worker_pool(1, 2);
+  promise<void> release_worker;
+  shared_future<void> worker_released = release_worker.get_future().share();
+  promise<void> worker_started;
+
+  // Block the only worker thread, then fill the queue.
+  EXPECT_EQ(true, hash_worker_pool.Submit([&worker_started, worker_released] {
+    worker_started.set_value();
+    worker_released.wait();
+  }));
+  worker_started.get_future().wait();
+  EXPECT_EQ(true, hash_worker_pool.Submit([] {}));
+  EXPECT_EQ(true, hash_worker_pool.Submit([] {}));
+  EXPECT_EQ(false, hash_worker_pool.Submit([] {}));
+
+  HashWorkerPool::Metrics metrics = hash_worker_pool.GetMetrics();
+  EXPECT_EQ(2, metrics.queue_depth);
+  EXPECT_EQ(2, metrics.max_queue_depth);
+  EXPECT_EQ(1, metrics.rejected_jobs);
+
+  release_worker.set_value();
+}
+
+TEST(HashWorkerPoolTest, Run_Throws) {
+  HashWorkerPool hash_worker_pool(1, 16);
+  pplx::task<int> task;
+  EXPECT_EQ(true, hash_worker_pool.Run<int>(
+                      []() -> int { throw runtime_error("hash error"); },
+                      &task));
+  // The task fails instead of never completing, and the worker survives.
+  EXPECT_THROW(task.get(), runtime_error);
+  EXPECT_EQ(true, hash_worker_pool.Run<int>([] { return 42; }, &task));
+  EXPECT_EQ(42, task.get());
+}
@@ -0,0 +1,101 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "long_poll_registry.h"
+
+using namespace std;
+using namespace utility;
+using namespace chatserver;
+
+typedef LongPollRegistry::Reply Reply;
+
+TEST(LongPollRegistryTest, Notify_CompletesWaiter) {
+  LongPollRegistry long_poll_registry(16);
+  atomic<int> completed_count(0);
+  EXPECT_EQ(true, long_poll_registry.Park(UU("a"), 2, chrono::seconds(30),
+                                          [&](const Reply&) {
+                                            ++completed_count;
+                                          }));
+  EXPECT_EQ(1, long_poll_registry.size());
+
+  // A message of another room or an old count completes nothing.
+  long_poll_registry.Notify(UU("b"), 5, nullptr);
+  long_poll_registry.Notify(UU("a"), 2, nullptr);
+  EXPECT_EQ(0, completed_count);
+
+  long_poll_registry.Notify(UU("a"), 3, nullptr);
+  EXPECT_EQ(1, completed_count);
+  EXPECT_EQ(0, long_poll_registry.size());
+}
+
+TEST(LongPollRegistryTest, Notify_SharesReply) {
+  LongPollRegistry long_poll_registry(16);
+  Reply first_reply;
+  Reply second_reply;
+  Reply behind_reply = make_shared<const string>("not replied");
+  long_poll_registry.Park(UU("a"), 2, chrono::seconds(30),
+                          [&](const Reply& reply) { first_reply = reply; });
+  long_poll_registry.Park(UU("a"), 2, chrono::seconds(30),
+                          [&](const Reply& reply) { second_reply = reply; });
+  long_poll_registry.Park(UU("a"), 1, chrono::seconds(30),
+                          [&](const Reply& reply) { behind_reply = reply; });
+
+  // Only the requests right before the message get the reply.
+  const Reply reply = make_shared<const string>("message 3");
+  long_poll_registry.Notify(UU("a"), 3, reply);
+  EXPECT_EQ(reply, first_reply);
+  EXPECT_EQ(reply, second_reply);
+  EXPECT_EQ(nullptr, behind_reply);
+}
+
+TEST(LongPollRegistryTest, Park_StaleCursorCompletesImmediately) {
+  LongPollRegistry long_poll_registry(16);
+  long_poll_registry.Notify(UU("a"), 3, nullptr);
+  bool completed = false;
+  EXPECT_EQ(true, long_poll_registry.Park(UU("a"), 1, chrono::seconds(30),
+                                          [&](const Reply&) {
+                                            completed = true;
+                                          }));
+  EXPECT_EQ(true, completed);
+  EXPECT_EQ(0, long_poll_registry.size());
+}
+
+TEST(LongPollRegistryTest, Park_Timeout) {
+  LongPollRegistry long_poll_registry(16);
+  promise<void> completed;
+  EXPECT_EQ(true, long_poll_registry.Park(UU("a"), 0,
+                                          chrono::milliseconds(20),
+                                          [&](const Reply&) {
+                                            completed.set_value();
+                                          }));
+  EXPECT_EQ(future_status::ready,
+            completed.get_future().wait_for(chrono::seconds(5)));
+  EXPECT_EQ(0, long_poll_registry.size());
+}
+
+TEST(LongPollRegistryTest, Park_Full) {
+  LongPollRegistry long_poll_registry(1);
+  EXPECT_EQ(true, long_poll_registry.Park(UU("a"), 0, chrono::seconds(30),
+                                          [](const Reply&) {}));
+  EXPECT_EQ(false, long_poll_registry.Park(UU("a"), 0, chrono::seconds(30),
+                                           [](const Reply&) {}));
+}
+
+TEST(LongPollRegistryTest, Destructor_CompletesWaiters) {
+  int completed_count = 0;
+  {
+    LongPollRegistry long_poll_registry(16);
+    long_poll_registry.Park(UU("a"), 0, chrono::seconds(30),
+                            [&](const Reply&) { ++completed_count; });
+    long_poll_registry.Park(UU("b"), 0, chrono::seconds(30),
+                            [&](const Reply&) { ++completed_count; });
+  }
+  EXPECT_EQ(2, completed_count);
+}
@@ -0,0 +1,47 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "gtest/gtest.h"
+#include "nonce_replay_cache.h"
+
+using namespace std;
+using namespace utility;
+using namespace chatserver;
+
+TEST(NonceReplayCacheTest, CheckAndInsert_Replay) {
+  NonceReplayCache nonce_replay_cache(30, 1024);
+  EXPECT_EQ(NonceReplayCache::kFirstUse,
+            nonce_replay_cache.CheckAndInsert(UU("kaist"), UU("abc"), 1000));
+  EXPECT_EQ(NonceReplayCache::kReplayed,
+            nonce_replay_cache.CheckAndInsert(UU("kaist"), UU("abc"), 1010));
+  // The same nonce of another ID is not a replay.
+  EXPECT_EQ(NonceReplayCache::kFirstUse,
+            nonce_replay_cache.CheckAndInsert(UU("wsp"), UU("abc"), 1010));
+}
+
+TEST(NonceReplayCacheTest, CheckAndInsert_Expire) {
+  NonceReplayCache nonce_replay_cache(30, 1024);
+  EXPECT_EQ(NonceReplayCache::kFirstUse,
+            nonce_replay_cache.CheckAndInsert(UU("kaist"), UU("abc"), 1000));
+  // Remembered for the whole window.
+  EXPECT_EQ(NonceReplayCache::kReplayed,
+            nonce_replay_cache.CheckAndInsert(UU("kaist"), UU("abc"), 1029));
+  // Dropped with its bucket after the window.
+  EXPECT_EQ(NonceReplayCache::kFirstUse,
+            nonce_replay_cache.CheckAndInsert(UU("kaist"), UU("abc"), 1100));
+}
+
+TEST(NonceReplayCacheTest, CheckAndInsert_ShardFull) {
+  NonceReplayCache nonce_replay_cache(30, 2);
+  EXPECT_EQ(NonceReplayCache::kFirstUse,
+            nonce_replay_cache.CheckAndInsert(UU("kaist"), UU("a"), 1000));
+  EXPECT_EQ(NonceReplayCache::kFirstUse,
+            nonce_replay_cache.CheckAndInsert(UU("kaist"), UU("b"), 1000));
+  // A full shard is not a replay.
+  EXPECT_EQ(NonceReplayCache::kFull,
+            nonce_replay_cache.CheckAndInsert(UU("kaist"), UU("c"), 1000));
+  // Room is made when the old buckets leave the window.
+  EXPECT_EQ(NonceReplayCache::kFirstUse,
+            nonce_replay_cache.CheckAndInsert(UU("kaist"), UU("c"), 1100));
+}
@@ -0,0 +1,34 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "gtest/gtest.h"
+#include "rate_limiter.h"
+
+using namespace std;
+using namespace utility;
+using namespace chatserver;
+
+TEST(RateLimiterTest, TryAcquire_Burst) {
+  RateLimiter rate_limiter(3, 1);
+  EXPECT_EQ(true, rate_limiter.TryAcquire(UU("kaist"), 0));
+  EXPECT_EQ(true, rate_limiter.TryAcquire(UU("kaist"), 0));
+  EXPECT_EQ(true, rate_limiter.TryAcquire(UU("kaist"), 0));
+  EXPECT_EQ(false, rate_limiter.TryAcquire(UU("kaist"), 0));
+  // Another key has its own bucket.
+  EXPECT_EQ(true, rate_limiter.TryAcquire(UU("wsp"), 0));
+}
+
+TEST(RateLimiterTest, TryAcquire_Refill) {
+  RateLimiter rate_limiter(2, 2);
+  EXPECT_EQ(true, rate_limiter.TryAcquire(UU("kaist"), 1000));
+  EXPECT_EQ(true, rate_limiter.TryAcquire(UU("kaist"), 1000));
+  EXPECT_EQ(false, rate_limiter.TryAcquire(UU("kaist"), 1100));
+  // Two tokens per second: one token after 500 ms.
+  EXPECT_EQ(true, rate_limiter.TryAcquire(UU("kaist"), 1500));
+  EXPECT_EQ(false, rate_limiter.TryAcquire(UU("kaist"), 1500));
+  // The bucket never holds more than the burst.
+  EXPECT_EQ(true, rate_limiter.TryAcquire(UU("kaist"), 100000));
+  EXPECT_EQ(true, rate_limiter.TryAcquire(UU("kaist"), 100000));
+  EXPECT_EQ(false, rate_limiter.TryAcquire(UU("kaist"), 100000));
+}
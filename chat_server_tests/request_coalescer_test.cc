@@ -0,0 +1,109 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "request_coalescer.h"
+
+using namespace std;
+using namespace utility;
+using namespace chatserver;
+
+typedef RequestCoalescer::Response Response;
+
+namespace {
+
+  Response MakeResponse(const string& body) {
+    Response response;
+    response.is_found = true;
+    response.cursor = 1;
+    response.has_messages = true;
+    response.body = make_shared<const string>(body);
+    return response;
+  }
+
+} // namespace
+
+TEST(RequestCoalescerTest, Run_ComputesEachRequest) {
+  RequestCoalescer request_coalescer;
+  int compute_count = 0;
+  vector<shared_ptr<const string>> bodies;
+  for (int i = 0; i < 2; ++i) {
+    request_coalescer.Run(
+        UU("a"), 0,
+        [&] {
+          ++compute_count;
+          return MakeResponse("body");
+        },
+        [&](const Response& response) { bodies.push_back(response.body); });
+  }
+
+  // Requests that do not overlap compute their own response.
+  EXPECT_EQ(2, compute_count);
+  ASSERT_EQ(2, bodies.size());
+  EXPECT_NE(bodies[0], bodies[1]);
+  EXPECT_EQ(0, request_coalescer.coalesced_count());
+}
+
+TEST(RequestCoalescerTest, Run_SharesResponseWithJoinedRequests) {
+  RequestCoalescer request_coalescer;
+  int compute_count = 0;
+  vector<shared_ptr<const string>> bodies;
+  const RequestCoalescer::Callback callback =
+      [&](const Response& response) { bodies.push_back(response.body); };
+  const RequestCoalescer::Compute compute = [&] {
+    ++compute_count;
+    return MakeResponse("shared");
+  };
+  request_coalescer.Run(
+      UU("a"), 3,
+      [&] {
+        // Identical requests arriving while the response is computed join
+        // it. Another cursor or room computes its own.
+        request_coalescer.Run(UU("a"), 3, compute, callback);
+        request_coalescer.Run(UU("a"), 3, compute, callback);
+        request_coalescer.Run(UU("a"), 4, compute, callback);
+        request_coalescer.Run(UU("b"), 3, compute, callback);
+        return compute();
+      },
+      callback);
+
+  EXPECT_EQ(3, compute_count);
+  ASSERT_EQ(5, bodies.size());
+  // The first request replies first, then the joined requests.
+  EXPECT_EQ(bodies[2], bodies[3]);
+  EXPECT_EQ(bodies[2], bodies[4]);
+  EXPECT_NE(bodies[0], bodies[2]);
+  EXPECT_EQ(2, request_coalescer.coalesced_count());
+}
+
+TEST(RequestCoalescerTest, Run_ComputeThrows) {
+  RequestCoalescer request_coalescer;
+  vector<bool> failures;
+  const RequestCoalescer::Callback callback =
+      [&](const Response& response) { failures.push_back(response.is_failed); };
+  request_coalescer.Run(
+      UU("a"), 0,
+      [&]() -> Response {
+        request_coalescer.Run(UU("a"), 0, [] { return MakeResponse("x"); },
+                              callback);
+        throw bad_alloc();
+      },
+      callback);
+
+  // The joined request fails with the first one instead of waiting.
+  ASSERT_EQ(2, failures.size());
+  EXPECT_EQ(true, failures[0]);
+  EXPECT_EQ(true, failures[1]);
+
+  // The failed flight is over, so the next request computes again.
+  request_coalescer.Run(UU("a"), 0, [] { return MakeResponse("x"); },
+                        callback);
+  ASSERT_EQ(3, failures.size());
+  EXPECT_EQ(false, failures[2]);
+}
@@ -0,0 +1,67 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "gtest/gtest.h"
+#include "request_query.h"
+
+using namespace std;
+using namespace utility;
+using namespace chatserver;
+
+TEST(RequestQueryTest, Parse) {
+  RequestQuery request_query;
+  EXPECT_EQ(true, request_query.Parse(
+      UU("/login/"), UU("id=kaist&password=p%40ss&nonce=1&unknown=x")));
+  EXPECT_EQ(true, request_query.path() == "login");
+  EXPECT_EQ(true, request_query.Has(RequestQuery::kId));
+  EXPECT_EQ(UU("kaist"), request_query.GetString(RequestQuery::kId));
+  EXPECT_EQ(UU("p@ss"), request_query.GetString(RequestQuery::kPassword));
+  EXPECT_EQ(true, request_query.Get(RequestQuery::kNonce) == "1");
+  EXPECT_EQ(false, request_query.Has(RequestQuery::kSessionId));
+  EXPECT_EQ(true, request_query.Get(RequestQuery::kSessionId).empty());
+}
+
+TEST(RequestQueryTest, Parse_EncodedSeparator) {
+  RequestQuery request_query;
+  // An encoded '&' or '=' belongs to the value.
+  EXPECT_EQ(true, request_query.Parse(
+      UU("/chatmessage"), UU("chat_message=a%26b%3Dc&chat_room=%ED%95%9C")));
+  EXPECT_EQ(true, request_query.Get(RequestQuery::kChatMessage) == "a&b=c");
+  EXPECT_EQ(true,
+            request_query.Get(RequestQuery::kChatRoom) == "\xED\x95\x9C");
+  EXPECT_EQ(UU("\uD55C"), request_query.GetString(RequestQuery::kChatRoom));
+}
+
+TEST(RequestQueryTest, Parse_EmptyValueAndLastWins) {
+  RequestQuery request_query;
+  EXPECT_EQ(true, request_query.Parse(UU("/"), UU("all&id=a&id=b")));
+  EXPECT_EQ(true, request_query.path().empty());
+  EXPECT_EQ(true, request_query.Has(RequestQuery::kAll));
+  EXPECT_EQ(true, request_query.Get(RequestQuery::kAll).empty());
+  EXPECT_EQ(UU("b"), request_query.GetString(RequestQuery::kId));
+}
+
+TEST(RequestQueryTest, Parse_Malformed) {
+  RequestQuery request_query;
+  EXPECT_EQ(false, request_query.Parse(UU("/login"), UU("id=%4")));
+  EXPECT_EQ(false, request_query.Parse(UU("/login"), UU("id=%zz")));
+  EXPECT_EQ(false, request_query.Parse(UU("/log%"), UU("")));
+}
+
+TEST(RequestQueryTest, GetNumber) {
+  RequestQuery request_query;
+  EXPECT_EQ(true, request_query.Parse(UU("/chatmessage"),
+                                      UU("since=42&wait=3x")));
+  uint64_t number = 0;
+  EXPECT_EQ(true, request_query.GetNumber(RequestQuery::kSince, &number));
+  EXPECT_EQ(42, number);
+  EXPECT_EQ(false, request_query.GetNumber(RequestQuery::kWait, &number));
+  EXPECT_EQ(false, request_query.GetNumber(RequestQuery::kId, &number));
+}
+
+TEST(RequestQueryTest, Parse_SubPath) {
+  RequestQuery request_query;
+  EXPECT_EQ(true, request_query.Parse(UU("//chatmessage/stream/"), UU("")));
+  EXPECT_EQ(true, request_query.path() == "chatmessage/stream");
+}
@@ -0,0 +1,168 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "room_broadcaster.h"
+
+using namespace std;
+using namespace utility;
+using namespace chatserver;
+
+namespace {
+
+  // Serializer counting its calls.
+  RoomBroadcaster::Serializer CountingSerializer(atomic<int>* count) {
+    return [count](const ChatMessage& chat_message, uint64_t sequence) {
+      ++*count;
+      RoomBroadcaster::Payload payload;
+      payload.chat_message = make_shared<const string>(
+          conversions::to_utf8string(chat_message.chat_message));
+      payload.push_message =
+          make_shared<const string>(to_string(sequence));
+      return payload;
+    };
+  }
+
+  ChatMessage MakeChatMessage(const string_t& chat_room,
+                              const string_t& text) {
+    return ChatMessage(1583581787, UU("gsis"), chat_room, text);
+  }
+
+} // namespace
+
+TEST(RoomBroadcasterTest, Publish_SerializesOnce) {
+  atomic<int> serialize_count(0);
+  RoomBroadcaster room_broadcaster(CountingSerializer(&serialize_count));
+  vector<const string*> payloads;
+  for (int i = 0; i < 3; ++i) {
+    room_broadcaster.Subscribe(
+        UU("a"), [&](const RoomBroadcaster::Broadcast& broadcast) {
+          payloads.push_back(broadcast.payload.chat_message.get());
+          return true;
+        });
+  }
+  room_broadcaster.Publish(MakeChatMessage(UU("a"), UU("hi")), 1);
+  room_broadcaster.Flush();
+
+  // Every subscriber gets the same buffer.
+  EXPECT_EQ(1, serialize_count);
+  ASSERT_EQ(3, payloads.size());
+  EXPECT_EQ("hi", *payloads[0]);
+  EXPECT_EQ(payloads[0], payloads[1]);
+  EXPECT_EQ(payloads[0], payloads[2]);
+}
+
+TEST(RoomBroadcasterTest, Publish_OnlyRoomSubscribers) {
+  atomic<int> serialize_count(0);
+  RoomBroadcaster room_broadcaster(CountingSerializer(&serialize_count));
+  vector<uint64_t> sequences;
+  room_broadcaster.Subscribe(
+      UU("a"), [&](const RoomBroadcaster::Broadcast& broadcast) {
+        sequences.push_back(broadcast.sequence);
+        return true;
+      });
+  room_broadcaster.Publish(MakeChatMessage(UU("b"), UU("other room")), 1);
+  room_broadcaster.Publish(MakeChatMessage(UU("a"), UU("first")), 1);
+  room_broadcaster.Publish(MakeChatMessage(UU("a"), UU("second")), 2);
+  room_broadcaster.Flush();
+
+  // A message of a room without a subscriber is not serialized.
+  EXPECT_EQ(2, serialize_count);
+  ASSERT_EQ(2, sequences.size());
+  EXPECT_EQ(1, sequences[0]);
+  EXPECT_EQ(2, sequences[1]);
+}
+
+TEST(RoomBroadcasterTest, Subscriber_ReturnFalseUnsubscribes) {
+  atomic<int> serialize_count(0);
+  RoomBroadcaster room_broadcaster(CountingSerializer(&serialize_count));
+  int call_count = 0;
+  room_broadcaster.Subscribe(UU("a"),
+                             [&](const RoomBroadcaster::Broadcast&) {
+                               ++call_count;
+                               return false;
+                             });
+  EXPECT_EQ(1, room_broadcaster.subscriber_count(UU("a")));
+  room_broadcaster.Publish(MakeChatMessage(UU("a"), UU("1")), 1);
+  room_broadcaster.Publish(MakeChatMessage(UU("a"), UU("2")), 2);
+  room_broadcaster.Flush();
+  EXPECT_EQ(1, call_count);
+  EXPECT_EQ(0, room_broadcaster.subscriber_count(UU("a")));
+}
+
+TEST(RoomBroadcasterTest, Unsubscribe) {
+  atomic<int> serialize_count(0);
+  RoomBroadcaster room_broadcaster(CountingSerializer(&serialize_count));
+  int call_count = 0;
+  const uint64_t subscriber_id = room_broadcaster.Subscribe(
+      UU("a"), [&](const RoomBroadcaster::Broadcast&) {
+        ++call_count;
+        return true;
+      });
+  room_broadcaster.Unsubscribe(UU("a"), subscriber_id);
+  room_broadcaster.Publish(MakeChatMessage(UU("a"), UU("1")), 1);
+  room_broadcaster.Flush();
+  EXPECT_EQ(0, call_count);
+  EXPECT_EQ(0, room_broadcaster.subscriber_count(UU("a")));
+}
+
+TEST(RoomBroadcasterTest, Publish_Concurrent) {
+  atomic<int> serialize_count(0);
+  RoomBroadcaster room_broadcaster(CountingSerializer(&serialize_count));
+  atomic<int> listened_count(0);
+  room_broadcaster.SetListener(
+      [&](const RoomBroadcaster::Broadcast&) { ++listened_count; });
+
+  const int kThreadCount = 4;
+  const int kMessageCount = 1000;
+  vector<thread> threads;
+  for (int i = 0; i < kThreadCount; ++i) {
+    threads.emplace_back([&room_broadcaster, i] {
+      for (int j = 0; j < kMessageCount; ++j) {
+        room_broadcaster.Publish(MakeChatMessage(UU("a"), UU("m")),
+                                 i * kMessageCount + j + 1);
+      }
+    });
+  }
+  for (auto& publish_thread : threads) {
+    publish_thread.join();
+  }
+  room_broadcaster.Flush();
+  EXPECT_EQ(kThreadCount * kMessageCount, listened_count);
+  EXPECT_EQ(kThreadCount * kMessageCount, serialize_count);
+}
+
+TEST(RoomBroadcasterTest, Publish_NoReaderSkipsSerialize) {
+  atomic<int> serialize_count(0);
+  RoomBroadcaster room_broadcaster(CountingSerializer(&serialize_count));
+  atomic<int> listened_count(0);
+  bool is_payload_empty = false;
+  room_broadcaster.SetListener(
+      [&](const RoomBroadcaster::Broadcast& broadcast) {
+        ++listened_count;
+        is_payload_empty = broadcast.payload.chat_message == nullptr;
+      },
+      [](const string_t&) { return false; });
+  room_broadcaster.Publish(MakeChatMessage(UU("a"), UU("hi")), 1);
+  room_broadcaster.Flush();
+
+  // The listener still gets the sequence.
+  EXPECT_EQ(1, listened_count);
+  EXPECT_EQ(true, is_payload_empty);
+  EXPECT_EQ(0, serialize_count);
+
+  // A subscriber needs the payload.
+  room_broadcaster.Subscribe(
+      UU("a"), [](const RoomBroadcaster::Broadcast&) { return true; });
+  room_broadcaster.Publish(MakeChatMessage(UU("a"), UU("hi")), 2);
+  room_broadcaster.Flush();
+  EXPECT_EQ(false, is_payload_empty);
+  EXPECT_EQ(1, serialize_count);
+}
@@ -2,15 +2,37 @@
 // Code style follows Google C++ Style Guide.
 // (https://google.github.io/styleguide/cppguide.html)
 
+#include <atomic>
+#include <set>
+#include <thread>
+
 #include "gtest/gtest.h"
 #include "session_manager.h"
 
 #include "session.h"
+#include "session_snapshot.h"
+#include "cpprest/asyncrt_utils.h"
+#include "spdlog/spdlog.h"
 
 using namespace std;
 using namespace chrono;
 using namespace utility;
 using namespace chatserver;
+using ::utility::conversions::to_utf8string;
+
+namespace chatserver {
+
+  // Test seam of SessionManager.
+  class SessionManagerTestPeer {
+   public:
+    // Create a session as if the user logged in at now.
+    static Session CreateSession(SessionManager* session_manager,
+                                 const string_t& user_id, time_t now) {
+      return session_manager->CreateSession(user_id, now);
+    }
+  };
+
+} // namespace chatserver
 
 // Fixture class for session_manager.h testing.
 class SessionManagerTest : public ::testing::Test {
@@ -27,4 +49,262 @@ class SessionManagerTest : public ::testing::Test {
   }
 };
 
-// ToDo: Implement unit tests.
\ No newline at end of file
+TEST_F(SessionManagerTest, CreateSession_Success) {
+  EXPECT_EQ(32, kaist_session.session_id.size());
+  EXPECT_NE(kaist_session.session_id, wsp_session.session_id);
+  EXPECT_EQ(true, session_manager_.IsExistSessionId(kaist_session.session_id));
+  // Another login of the same user gets another session.
+  const Session second_session = session_manager_.CreateSession(UU("kaist"));
+  EXPECT_NE(kaist_session.session_id, second_session.session_id);
+  EXPECT_EQ(true, session_manager_.IsExistSessionId(kaist_session.session_id));
+  EXPECT_EQ(true, session_manager_.IsExistSessionId(second_session.session_id));
+}
+
+TEST_F(SessionManagerTest, CreateSession_EvictLeastRecent) {
+  vector<Session> sessions;
+  for (size_t i = 1; i < SessionManager::kMaxSessionsPerUser; ++i) {
+    sessions.push_back(session_manager_.CreateSession(UU("kaist")));
+  }
+  EXPECT_EQ(true, session_manager_.IsExistSessionId(kaist_session.session_id));
+
+  // The first session is the least recently active one.
+  session_manager_.CreateSession(UU("kaist"));
+  EXPECT_EQ(false,
+            session_manager_.IsExistSessionId(kaist_session.session_id));
+  for (const auto& session : sessions) {
+    EXPECT_EQ(true, session_manager_.IsExistSessionId(session.session_id));
+  }
+}
+
+TEST_F(SessionManagerTest, DeleteUserSessions) {
+  const Session second_session = session_manager_.CreateSession(UU("kaist"));
+  EXPECT_EQ(2, session_manager_.DeleteUserSessions(UU("kaist")));
+  EXPECT_EQ(false,
+            session_manager_.IsExistSessionId(kaist_session.session_id));
+  EXPECT_EQ(false,
+            session_manager_.IsExistSessionId(second_session.session_id));
+  EXPECT_EQ(true, session_manager_.IsExistSessionId(wsp_session.session_id));
+  EXPECT_EQ(0, session_manager_.DeleteUserSessions(UU("kaist")));
+}
+
+TEST_F(SessionManagerTest, GetUserIDFromSessionId) {
+  string_t user_id;
+  EXPECT_EQ(true, session_manager_.GetUserIDFromSessionId(
+      wsp_session.session_id, &user_id));
+  EXPECT_EQ(UU("wsp"), user_id);
+  EXPECT_EQ(false, session_manager_.GetUserIDFromSessionId(UU("none"),
+                                                           &user_id));
+}
+
+TEST_F(SessionManagerTest, DeleteSession) {
+  EXPECT_EQ(true, session_manager_.DeleteSession(gsis_session.session_id));
+  EXPECT_EQ(false, session_manager_.IsExistSessionId(gsis_session.session_id));
+  EXPECT_EQ(false, session_manager_.DeleteSession(gsis_session.session_id));
+  EXPECT_EQ(false,
+            session_manager_.RenewLastActivityTime(gsis_session.session_id));
+  EXPECT_EQ(true,
+            session_manager_.RenewLastActivityTime(kaist_session.session_id));
+}
+
+TEST_F(SessionManagerTest, RenewLastActivityTime_Bytes) {
+  const string session_id = to_utf8string(gsis_session.session_id);
+  EXPECT_EQ(true, session_manager_.RenewLastActivityTime(session_id.data(),
+                                                         session_id.size()));
+  EXPECT_EQ(false, session_manager_.RenewLastActivityTime(
+      session_id.data(), session_id.size() - 1));
+  EXPECT_EQ(true, session_manager_.DeleteSession(gsis_session.session_id));
+  EXPECT_EQ(false, session_manager_.RenewLastActivityTime(session_id.data(),
+                                                          session_id.size()));
+}
+
+TEST_F(SessionManagerTest, CreateSession_AfterDelete) {
+  EXPECT_EQ(true, session_manager_.DeleteSession(kaist_session.session_id));
+  const Session new_session = session_manager_.CreateSession(UU("kaist"));
+  EXPECT_NE(kaist_session.session_id, new_session.session_id);
+  EXPECT_EQ(true, session_manager_.IsExistSessionId(new_session.session_id));
+}
+
+TEST_F(SessionManagerTest, CreateSession_ConcurrentUnique) {
+  const int kThreadCount = 4;
+  const int kUsersPerThread = 200;
+  vector<vector<Session>> thread_sessions(kThreadCount);
+  vector<thread> threads;
+  for (int t = 0; t < kThreadCount; ++t) {
+    threads.emplace_back([this, t, &thread_sessions] {
+      for (int i = 0; i < kUsersPerThread; ++i) {
+        thread_sessions[t].push_back(session_manager_.CreateSession(
+            conversions::to_string_t(
+                "user" + to_string(t * kUsersPerThread + i))));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  set<string_t> session_ids;
+  for (const auto& sessions : thread_sessions) {
+    for (const auto& session : sessions) {
+      EXPECT_EQ(32, session.session_id.size());
+      EXPECT_EQ(true, session_manager_.IsExistSessionId(session.session_id));
+      session_ids.insert(session.session_id);
+    }
+  }
+  EXPECT_EQ(kThreadCount * kUsersPerThread, session_ids.size());
+}
+
+// Session lookups of every authenticated request at 1-64 threads.
+// Run with --gtest_also_run_disabled_tests.
+TEST_F(SessionManagerTest, DISABLED_Benchmark_SessionContention) {
+  const size_t kSessionCount = 10000;
+  const auto kMeasureTime = milliseconds(500);
+  vector<string_t> session_ids;
+  for (size_t i = 0; i < kSessionCount; ++i) {
+    session_ids.push_back(session_manager_.CreateSession(
+        conversions::to_string_t("user" + to_string(i))).session_id);
+  }
+
+  for (size_t thread_count = 1; thread_count <= 64; thread_count *= 2) {
+    atomic<bool> running(true);
+    atomic<long long> request_count(0);
+    vector<thread> threads;
+    for (size_t i = 0; i < thread_count; ++i) {
+      threads.emplace_back([&, i] {
+        long long count = 0;
+        string_t user_id;
+        size_t index = i;
+        while (running) {
+          const string_t& session_id = session_ids[index % kSessionCount];
+          session_manager_.IsExistSessionId(session_id);
+          session_manager_.RenewLastActivityTime(session_id);
+          session_manager_.GetUserIDFromSessionId(session_id, &user_id);
+          index += 7919;
+          ++count;
+        }
+        request_count += count;
+      });
+    }
+    this_thread::sleep_for(kMeasureTime);
+    running = false;
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    spdlog::info("threads: {}, requests/s: {}", thread_count,
+                 request_count * 1000 / kMeasureTime.count());
+  }
+}
+
+TEST(SessionManagerSignedTokenTest, CreateSession_Verify) {
+  SessionManager session_manager(SessionManager::kSignedToken, "secret");
+  const Session session = session_manager.CreateSession(UU("kaist"));
+  string_t user_id;
+  EXPECT_EQ(true, session_manager.IsExistSessionId(session.session_id));
+  EXPECT_EQ(true, session_manager.RenewLastActivityTime(session.session_id));
+  EXPECT_EQ(true, session_manager.GetUserIDFromSessionId(session.session_id,
+                                                         &user_id));
+  EXPECT_EQ(UU("kaist"), user_id);
+
+  // Another server with the same secret accepts the token.
+  SessionManager other_server(SessionManager::kSignedToken, "secret");
+  EXPECT_EQ(true, other_server.IsExistSessionId(session.session_id));
+}
+
+TEST(SessionManagerSignedTokenTest, DeleteSession_Revoke) {
+  SessionManager session_manager(SessionManager::kSignedToken, "secret");
+  const Session session = session_manager.CreateSession(UU("kaist"));
+  EXPECT_EQ(true, session_manager.DeleteSession(session.session_id));
+  EXPECT_EQ(false, session_manager.IsExistSessionId(session.session_id));
+  EXPECT_EQ(false, session_manager.DeleteSession(session.session_id));
+}
+
+TEST(SessionManagerSignedTokenTest, DeleteUserSessions_RevokeUser) {
+  SessionManager session_manager(SessionManager::kSignedToken, "secret");
+  const Session session = session_manager.CreateSession(UU("kaist"));
+  const Session other_session = session_manager.CreateSession(UU("gsis"));
+  // Tokens are not counted.
+  EXPECT_EQ(0, session_manager.DeleteUserSessions(UU("kaist")));
+  EXPECT_EQ(false, session_manager.IsExistSessionId(session.session_id));
+  EXPECT_EQ(true, session_manager.IsExistSessionId(other_session.session_id));
+}
+
+TEST(SessionManagerSnapshotTest, EnableSessionSnapshot_Restore) {
+  string_t session_id;
+  {
+    SessionManager session_manager;
+    EXPECT_EQ(false, session_manager.EnableSessionSnapshot(
+        UU("session_manager_snapshot_test.bin")));
+    session_id = session_manager.CreateSession(UU("kaist")).session_id;
+    // The snapshot is saved when the manager is destroyed.
+  }
+
+  {
+    SessionManager restarted_manager;
+    EXPECT_EQ(true, restarted_manager.EnableSessionSnapshot(
+        UU("session_manager_snapshot_test.bin")));
+    string_t user_id;
+    EXPECT_EQ(true, restarted_manager.GetUserIDFromSessionId(session_id,
+                                                             &user_id));
+    EXPECT_EQ(UU("kaist"), user_id);
+    // The restored session is still a session of the user.
+    EXPECT_EQ(1, restarted_manager.DeleteUserSessions(UU("kaist")));
+    // The manager saves the snapshot again when it is destroyed.
+  }
+  EXPECT_EQ(0, remove("session_manager_snapshot_test.bin"));
+}
+
+TEST(SessionManagerSnapshotTest, EnableSessionSnapshot_DropExpired) {
+  vector<Session> sessions(2);
+  sessions[0].session_id = UU("0123456789ABCDEFGHIJKLMNOPQRSTUV");
+  sessions[0].user_id = UU("kaist");
+  sessions[0].last_activity_time = time(nullptr);
+  sessions[1].session_id = UU("abcdefghijklmnopqrstuvwxyz012345");
+  sessions[1].user_id = UU("wsp");
+  sessions[1].last_activity_time = time(nullptr) - 3600;
+  ASSERT_EQ(true, SessionSnapshot::Save(
+      UU("session_manager_snapshot_test.bin"), sessions));
+
+  {
+    SessionManager session_manager;
+    EXPECT_EQ(true, session_manager.EnableSessionSnapshot(
+        UU("session_manager_snapshot_test.bin")));
+    EXPECT_EQ(true, session_manager.IsExistSessionId(sessions[0].session_id));
+    EXPECT_EQ(false, session_manager.IsExistSessionId(sessions[1].session_id));
+  }
+  EXPECT_EQ(0, remove("session_manager_snapshot_test.bin"));
+}
+
+TEST(SessionManagerLazyExpiryTest, Lookup_DeleteExpired) {
+  SessionManager session_manager;
+  session_manager.EnableLazyExpiry();
+  const Session expired_session =
+      SessionManagerTestPeer::CreateSession(
+          &session_manager, UU("kaist"), time(nullptr) - 3600);
+  const Session session = session_manager.CreateSession(UU("wsp"));
+  EXPECT_EQ(false,
+            session_manager.IsExistSessionId(expired_session.session_id));
+  EXPECT_EQ(true, session_manager.IsExistSessionId(session.session_id));
+  // The lookup deleted the expired session.
+  EXPECT_EQ(0, session_manager.DeleteUserSessions(UU("kaist")));
+}
+
+TEST(SessionManagerLazyExpiryTest, CreateSession_Sweep) {
+  const size_t kExpiredSessionCount = 20;
+  SessionManager session_manager;
+  session_manager.EnableLazyExpiry();
+  for (size_t i = 0; i < kExpiredSessionCount; ++i) {
+    SessionManagerTestPeer::CreateSession(
+        &session_manager, conversions::to_string_t("user" + to_string(i)),
+        time(nullptr) - 3600);
+  }
+  // Each login sweeps part of one shard. The shards are small, so a few
+  // rounds over them sweep every session.
+  for (size_t i = 0; i < 64; ++i) {
+    session_manager.CreateSession(UU("kaist"));
+  }
+  for (size_t i = 0; i < kExpiredSessionCount; ++i) {
+    EXPECT_EQ(0, session_manager.DeleteUserSessions(
+        conversions::to_string_t("user" + to_string(i))));
+  }
+}
+
+// ToDo: Implement unit tests.
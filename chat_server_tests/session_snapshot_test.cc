@@ -0,0 +1,67 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include <cstdio>
+#include <fstream>
+
+#include "gtest/gtest.h"
+#include "session_snapshot.h"
+
+using namespace std;
+using namespace utility;
+using namespace chatserver;
+
+namespace {
+
+  Session MakeSession(const string_t& session_id, const string_t& user_id,
+                      time_t last_activity_time) {
+    Session session;
+    session.session_id = session_id;
+    session.user_id = user_id;
+    session.last_activity_time = last_activity_time;
+    return session;
+  }
+
+} // namespace
+
+TEST(SessionSnapshotTest, Save_Load) {
+  vector<Session> sessions;
+  sessions.push_back(MakeSession(UU("0123456789ABCDEFGHIJKLMNOPQRSTUV"),
+                                 UU("kaist"), 1000));
+  sessions.push_back(MakeSession(UU("abcdefghijklmnopqrstuvwxyz012345"),
+                                 UU("wsp"), 2000));
+  // Not a session key: skipped.
+  sessions.push_back(MakeSession(UU("short"), UU("gsis"), 3000));
+  ASSERT_EQ(true, SessionSnapshot::Save(UU("snapshot_test.bin"), sessions));
+
+  vector<Session> loaded_sessions;
+  ASSERT_EQ(true, SessionSnapshot::Load(UU("snapshot_test.bin"),
+                                        &loaded_sessions));
+  ASSERT_EQ(2, loaded_sessions.size());
+  EXPECT_EQ(sessions[0].session_id, loaded_sessions[0].session_id);
+  EXPECT_EQ(UU("kaist"), loaded_sessions[0].user_id);
+  EXPECT_EQ(1000, loaded_sessions[0].last_activity_time);
+  EXPECT_EQ(sessions[1].session_id, loaded_sessions[1].session_id);
+  EXPECT_EQ(UU("wsp"), loaded_sessions[1].user_id);
+  EXPECT_EQ(2000, loaded_sessions[1].last_activity_time);
+  EXPECT_EQ(0, remove("snapshot_test.bin"));
+}
+
+TEST(SessionSnapshotTest, Load_Fail) {
+  vector<Session> sessions;
+  EXPECT_EQ(false, SessionSnapshot::Load(UU("no_snapshot.bin"), &sessions));
+
+  sessions.push_back(MakeSession(UU("0123456789ABCDEFGHIJKLMNOPQRSTUV"),
+                                 UU("kaist"), 1000));
+  ASSERT_EQ(true, SessionSnapshot::Save(UU("snapshot_test.bin"), sessions));
+  // Damage the last byte of the user ID.
+  {
+    fstream file("snapshot_test.bin",
+                 ios::in | ios::out | ios::binary);
+    file.seekp(-1, ios::end);
+    file.put('x');
+  }
+  EXPECT_EQ(false, SessionSnapshot::Load(UU("snapshot_test.bin"), &sessions));
+  EXPECT_EQ(0, remove("snapshot_test.bin"));
+}
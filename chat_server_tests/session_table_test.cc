@@ -0,0 +1,138 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "session_table.h"
+
+using namespace std;
+using namespace utility;
+using namespace chatserver;
+
+namespace {
+
+  // Session key of a 32-character ID ending with the given number.
+  SessionKey MakeKey(int number) {
+    string id = to_string(number);
+    id.insert(0, SessionKey::kLength - id.size(), 'S');
+    SessionKey session_key;
+    SessionKey::FromString(conversions::to_string_t(id), &session_key);
+    return session_key;
+  }
+
+} // namespace
+
+TEST(SessionTableTest, Insert_Find) {
+  EpochReclaimer epoch_reclaimer;
+  SessionTable session_table(&epoch_reclaimer);
+  EXPECT_EQ(true, session_table.Insert(MakeKey(1), UU("kaist"), 100));
+  EXPECT_EQ(false, session_table.Insert(MakeKey(1), UU("wsp"), 100));
+  EXPECT_EQ(1, session_table.size());
+
+  string_t user_id;
+  EXPECT_EQ(true, session_table.Contains(MakeKey(1)));
+  EXPECT_EQ(true, session_table.GetUserId(MakeKey(1), &user_id));
+  EXPECT_EQ(UU("kaist"), user_id);
+  EXPECT_EQ(false, session_table.Contains(MakeKey(2)));
+  EXPECT_EQ(false, session_table.GetUserId(MakeKey(2), &user_id));
+}
+
+TEST(SessionTableTest, Touch) {
+  EpochReclaimer epoch_reclaimer;
+  SessionTable session_table(&epoch_reclaimer);
+  session_table.Insert(MakeKey(1), UU("kaist"), 100);
+  time_t last_activity_time = 0;
+  EXPECT_EQ(true, session_table.Touch(MakeKey(1), 130));
+  EXPECT_EQ(true, session_table.GetLastActivityTime(MakeKey(1),
+                                                    &last_activity_time));
+  EXPECT_EQ(130, last_activity_time);
+  EXPECT_EQ(false, session_table.Touch(MakeKey(2), 130));
+}
+
+TEST(SessionTableTest, Touch_KeepLaterTime) {
+  EpochReclaimer epoch_reclaimer;
+  SessionTable session_table(&epoch_reclaimer);
+  session_table.Insert(MakeKey(1), UU("kaist"), 100);
+  time_t last_activity_time;
+  EXPECT_EQ(true, session_table.Touch(MakeKey(1), 90));
+  EXPECT_EQ(true, session_table.GetLastActivityTime(MakeKey(1),
+                                                    &last_activity_time));
+  EXPECT_EQ(100, last_activity_time);
+}
+
+TEST(SessionTableTest, Erase) {
+  EpochReclaimer epoch_reclaimer;
+  SessionTable session_table(&epoch_reclaimer);
+  session_table.Insert(MakeKey(1), UU("kaist"), 100);
+  session_table.Insert(MakeKey(2), UU("wsp"), 100);
+  string_t user_id;
+  EXPECT_EQ(true, session_table.Erase(MakeKey(1), &user_id));
+  EXPECT_EQ(UU("kaist"), user_id);
+  EXPECT_EQ(false, session_table.Erase(MakeKey(1), &user_id));
+  EXPECT_EQ(false, session_table.Contains(MakeKey(1)));
+  EXPECT_EQ(true, session_table.Contains(MakeKey(2)));
+  // An erased ID can be inserted again.
+  EXPECT_EQ(true, session_table.Insert(MakeKey(1), UU("gsis"), 100));
+  EXPECT_EQ(true, session_table.GetUserId(MakeKey(1), &user_id));
+  EXPECT_EQ(UU("gsis"), user_id);
+}
+
+TEST(SessionTableTest, Insert_Grow) {
+  EpochReclaimer epoch_reclaimer;
+  SessionTable session_table(&epoch_reclaimer);
+  const int kSessionCount = 5000;
+  for (int i = 0; i < kSessionCount; ++i) {
+    ASSERT_EQ(true, session_table.Insert(MakeKey(i), UU("user"), 100));
+  }
+  // Erase half of them, leaving tombstones behind.
+  string_t user_id;
+  for (int i = 0; i < kSessionCount; i += 2) {
+    ASSERT_EQ(true, session_table.Erase(MakeKey(i), &user_id));
+  }
+  for (int i = 0; i < kSessionCount; ++i) {
+    EXPECT_EQ(i % 2 == 1, session_table.Contains(MakeKey(i)));
+  }
+  EXPECT_EQ(kSessionCount / 2, session_table.size());
+}
+
+// Readers keep finding a session while a writer inserts and erases others.
+TEST(SessionTableTest, ConcurrentReadWrite) {
+  EpochReclaimer epoch_reclaimer;
+  SessionTable session_table(&epoch_reclaimer);
+  const SessionKey stable_key = MakeKey(-1);
+  session_table.Insert(stable_key, UU("kaist"), 100);
+  atomic<bool> stop(false);
+  atomic<int> missing_count(0);
+
+  vector<thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&] {
+      string_t user_id;
+      while (!stop.load()) {
+        if (!session_table.GetUserId(stable_key, &user_id) ||
+            user_id != UU("kaist")) {
+          ++missing_count;
+        }
+        session_table.Touch(stable_key, 200);
+      }
+    });
+  }
+
+  string_t user_id;
+  for (int i = 0; i < 20000; ++i) {
+    session_table.Insert(MakeKey(i), UU("wsp"), 100);
+    if (i >= 100) {
+      session_table.Erase(MakeKey(i - 100), &user_id);
+    }
+  }
+  stop.store(true);
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(0, missing_count.load());
+  EXPECT_EQ(101, session_table.size());
+}
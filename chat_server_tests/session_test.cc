@@ -0,0 +1,64 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "gtest/gtest.h"
+#include "session.h"
+
+using namespace std;
+using namespace utility;
+using namespace chatserver;
+
+TEST(SessionKeyTest, FromString_ToString) {
+  const string_t session_id = UU("0123456789ABCDEFGHIJKLMNOPQRSTUV");
+  SessionKey session_key;
+  ASSERT_EQ(true, SessionKey::FromString(session_id, &session_key));
+  EXPECT_EQ(session_id, session_key.ToString());
+}
+
+TEST(SessionKeyTest, FromString_InvalidLength) {
+  SessionKey session_key;
+  EXPECT_EQ(false, SessionKey::FromString(UU(""), &session_key));
+  EXPECT_EQ(false, SessionKey::FromString(UU("0123456789"), &session_key));
+  EXPECT_EQ(false, SessionKey::FromString(
+      UU("0123456789ABCDEFGHIJKLMNOPQRSTUVW"), &session_key));
+}
+
+TEST(SessionKeyTest, FromBytes) {
+  const string bytes = "0123456789ABCDEFGHIJKLMNOPQRSTUV";
+  SessionKey session_key;
+  ASSERT_EQ(true,
+            SessionKey::FromBytes(bytes.data(), bytes.size(), &session_key));
+  EXPECT_EQ(UU("0123456789ABCDEFGHIJKLMNOPQRSTUV"), session_key.ToString());
+  EXPECT_EQ(false, SessionKey::FromBytes(bytes.data(), 10, &session_key));
+  const string non_ascii = "\xC3\xA9" + bytes.substr(2);
+  EXPECT_EQ(false, SessionKey::FromBytes(non_ascii.data(), non_ascii.size(),
+                                         &session_key));
+}
+
+TEST(SessionKeyTest, Equal) {
+  SessionKey key1;
+  SessionKey key2;
+  SessionKey key3;
+  SessionKey key4;
+  SessionKey::FromString(UU("0123456789ABCDEFGHIJKLMNOPQRSTUV"), &key1);
+  SessionKey::FromString(UU("0123456789ABCDEFGHIJKLMNOPQRSTUV"), &key2);
+  // Differ only in the first and in the last character.
+  SessionKey::FromString(UU("x123456789ABCDEFGHIJKLMNOPQRSTUV"), &key3);
+  SessionKey::FromString(UU("0123456789ABCDEFGHIJKLMNOPQRSTUx"), &key4);
+  EXPECT_EQ(true, key1 == key2);
+  EXPECT_EQ(key1.Hash(), key2.Hash());
+  EXPECT_EQ(true, key1 != key3);
+  EXPECT_EQ(true, key1 != key4);
+}
+
+TEST(SessionRecordTest, CacheLineAligned) {
+  SessionKey session_key;
+  SessionKey::FromString(UU("0123456789ABCDEFGHIJKLMNOPQRSTUV"), &session_key);
+  SessionRecord* record = new SessionRecord(session_key, session_key.Hash(),
+                                            UU("kaist"), 100);
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(record) % 64);
+  EXPECT_EQ(true, record->key == session_key);
+  EXPECT_EQ(UU("kaist"), record->user_id);
+  delete record;
+}
@@ -0,0 +1,59 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "gtest/gtest.h"
+#include "session_token.h"
+
+using namespace std;
+using namespace utility;
+using namespace chatserver;
+
+TEST(SessionTokenSignerTest, Issue_Verify) {
+  SessionTokenSigner token_signer("secret");
+  const string_t token = token_signer.Issue(UU("kaist"), 2000);
+  string_t user_id;
+  time_t expire_time = 0;
+  uint64_t token_mac = 0;
+  EXPECT_EQ(true, token_signer.Verify(token, 1000, &user_id, &expire_time,
+                                      &token_mac));
+  EXPECT_EQ(UU("kaist"), user_id);
+  EXPECT_EQ(2000, expire_time);
+  EXPECT_NE(0, token_mac);
+}
+
+TEST(SessionTokenSignerTest, Verify_Expired) {
+  SessionTokenSigner token_signer("secret");
+  const string_t token = token_signer.Issue(UU("kaist"), 2000);
+  EXPECT_EQ(false, token_signer.Verify(token, 2000, nullptr, nullptr,
+                                       nullptr));
+}
+
+TEST(SessionTokenSignerTest, Verify_SharedSecret) {
+  SessionTokenSigner token_signer("secret");
+  SessionTokenSigner same_signer("secret");
+  SessionTokenSigner other_signer("other secret");
+  const string_t token = token_signer.Issue(UU("kaist"), 2000);
+  EXPECT_EQ(true, same_signer.Verify(token, 1000, nullptr, nullptr,
+                                     nullptr));
+  EXPECT_EQ(false, other_signer.Verify(token, 1000, nullptr, nullptr,
+                                       nullptr));
+}
+
+TEST(SessionTokenSignerTest, Verify_Tampered) {
+  SessionTokenSigner token_signer("secret");
+  const string_t token = token_signer.Issue(UU("kaist"), 2000);
+  // Another user ID with the same MAC: hex("wsp") = 777370.
+  const string_t forged_user = UU("777370") + token.substr(token.find('.'));
+  // A later expire time with the same MAC.
+  string_t forged_expire = token;
+  forged_expire.replace(token.find('.') + 1, 4, UU("9999"));
+  EXPECT_EQ(false, token_signer.Verify(forged_user, 1000, nullptr, nullptr,
+                                       nullptr));
+  EXPECT_EQ(false, token_signer.Verify(forged_expire, 1000, nullptr, nullptr,
+                                       nullptr));
+  EXPECT_EQ(false, token_signer.Verify(UU("not a token"), 1000, nullptr,
+                                       nullptr, nullptr));
+  EXPECT_EQ(false, token_signer.Verify(UU(""), 1000, nullptr, nullptr,
+                                       nullptr));
+}
@@ -0,0 +1,105 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "subscriber_queue.h"
+
+using namespace std;
+using namespace utility;
+using namespace chatserver;
+
+namespace {
+
+  shared_ptr<const string> MakeMessage(uint64_t sequence) {
+    return make_shared<const string>("message " + to_string(sequence));
+  }
+
+} // namespace
+
+TEST(SubscriberQueueTest, PushAndPop) {
+  SubscriberQueue::Counters counters;
+  SubscriberQueue subscriber_queue(2, SubscriberQueue::kDisconnect,
+                                   &counters);
+  const auto message = MakeMessage(1);
+  EXPECT_EQ(true, subscriber_queue.Push(UU("a"), 1, message));
+  EXPECT_EQ(1, subscriber_queue.message_count());
+
+  SubscriberQueue::Item item;
+  EXPECT_EQ(true, subscriber_queue.Pop(&item));
+  EXPECT_EQ(SubscriberQueue::kMessageItem, item.type);
+  EXPECT_EQ(UU("a"), item.chat_room);
+  EXPECT_EQ(1, item.sequence);
+  // The shared message is queued without a copy.
+  EXPECT_EQ(message, item.message);
+  EXPECT_EQ(false, subscriber_queue.Pop(&item));
+}
+
+TEST(SubscriberQueueTest, Push_Disconnect) {
+  SubscriberQueue::Counters counters;
+  SubscriberQueue subscriber_queue(2, SubscriberQueue::kDisconnect,
+                                   &counters);
+  EXPECT_EQ(true, subscriber_queue.Push(UU("a"), 1, MakeMessage(1)));
+  EXPECT_EQ(true, subscriber_queue.Push(UU("a"), 2, MakeMessage(2)));
+  EXPECT_EQ(false, subscriber_queue.Push(UU("a"), 3, MakeMessage(3)));
+  EXPECT_EQ(1, counters.Load().disconnects);
+}
+
+TEST(SubscriberQueueTest, Push_DropOldest) {
+  SubscriberQueue::Counters counters;
+  SubscriberQueue subscriber_queue(2, SubscriberQueue::kDropOldest,
+                                   &counters);
+  for (uint64_t sequence = 1; sequence <= 5; ++sequence) {
+    EXPECT_EQ(true, subscriber_queue.Push(UU("a"), sequence,
+                                          MakeMessage(sequence)));
+  }
+  EXPECT_EQ(2, subscriber_queue.message_count());
+
+  // Messages 1 to 3 are dropped and reported by one gap item.
+  SubscriberQueue::Item item;
+  EXPECT_EQ(true, subscriber_queue.Pop(&item));
+  EXPECT_EQ(SubscriberQueue::kGapItem, item.type);
+  EXPECT_EQ(0, item.gap_begin);
+  EXPECT_EQ(3, item.sequence);
+  EXPECT_EQ(true, subscriber_queue.Pop(&item));
+  EXPECT_EQ(SubscriberQueue::kMessageItem, item.type);
+  EXPECT_EQ(4, item.sequence);
+  EXPECT_EQ(true, subscriber_queue.Pop(&item));
+  EXPECT_EQ(5, item.sequence);
+
+  const SubscriberQueue::Metrics metrics = counters.Load();
+  EXPECT_EQ(3, metrics.dropped_messages);
+  EXPECT_EQ(1, metrics.gap_notices);
+}
+
+TEST(SubscriberQueueTest, Push_Resync) {
+  SubscriberQueue::Counters counters;
+  SubscriberQueue subscriber_queue(2, SubscriberQueue::kResync, &counters);
+  EXPECT_EQ(true, subscriber_queue.Push(UU("a"), 4, MakeMessage(4)));
+  EXPECT_EQ(true, subscriber_queue.Push(UU("b"), 7, MakeMessage(7)));
+  // The queue is full: both rooms are read again, so the new message of
+  // room a is dropped too.
+  EXPECT_EQ(true, subscriber_queue.Push(UU("a"), 5, MakeMessage(5)));
+  EXPECT_EQ(0, subscriber_queue.message_count());
+
+  SubscriberQueue::Item item;
+  EXPECT_EQ(true, subscriber_queue.Pop(&item));
+  EXPECT_EQ(SubscriberQueue::kResyncItem, item.type);
+  EXPECT_EQ(UU("a"), item.chat_room);
+  EXPECT_EQ(3, item.sequence);
+  EXPECT_EQ(true, subscriber_queue.Pop(&item));
+  EXPECT_EQ(SubscriberQueue::kResyncItem, item.type);
+  EXPECT_EQ(UU("b"), item.chat_room);
+  EXPECT_EQ(6, item.sequence);
+
+  // Once the resync item is taken, messages are queued again.
+  EXPECT_EQ(true, subscriber_queue.Push(UU("a"), 6, MakeMessage(6)));
+  EXPECT_EQ(1, subscriber_queue.message_count());
+
+  const SubscriberQueue::Metrics metrics = counters.Load();
+  EXPECT_EQ(3, metrics.dropped_messages);
+  EXPECT_EQ(2, metrics.resync_notices);
+}
@@ -0,0 +1,76 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "gtest/gtest.h"
+#include "timing_wheel.h"
+
+using namespace std;
+using namespace utility;
+using namespace chatserver;
+
+namespace {
+
+  // Session key of kLength copies of the character.
+  SessionKey MakeKey(char character) {
+    SessionKey session_key;
+    SessionKey::FromString(string_t(SessionKey::kLength, character),
+                           &session_key);
+    return session_key;
+  }
+
+} // namespace
+
+TEST(TimingWheelTest, Advance_Expire) {
+  TimingWheel timing_wheel(1000);
+  timing_wheel.Schedule(MakeKey('a'), 1010);
+  timing_wheel.Schedule(MakeKey('b'), 1030);
+  vector<SessionKey> expired_keys;
+
+  timing_wheel.Advance(1009, &expired_keys);
+  EXPECT_EQ(0, expired_keys.size());
+  timing_wheel.Advance(1010, &expired_keys);
+  ASSERT_EQ(1, expired_keys.size());
+  EXPECT_EQ(MakeKey('a'), expired_keys[0]);
+  EXPECT_EQ(1, timing_wheel.size());
+}
+
+TEST(TimingWheelTest, Schedule_Reschedule) {
+  TimingWheel timing_wheel(1000);
+  timing_wheel.Schedule(MakeKey('a'), 1010);
+  // Renewed before the expire time.
+  timing_wheel.Schedule(MakeKey('a'), 1040);
+  vector<SessionKey> expired_keys;
+  timing_wheel.Advance(1039, &expired_keys);
+  EXPECT_EQ(0, expired_keys.size());
+  timing_wheel.Advance(1040, &expired_keys);
+  EXPECT_EQ(1, expired_keys.size());
+}
+
+TEST(TimingWheelTest, Cancel) {
+  TimingWheel timing_wheel(1000);
+  timing_wheel.Schedule(MakeKey('a'), 1010);
+  timing_wheel.Cancel(MakeKey('a'));
+  vector<SessionKey> expired_keys;
+  timing_wheel.Advance(1100, &expired_keys);
+  EXPECT_EQ(0, expired_keys.size());
+  EXPECT_EQ(0, timing_wheel.size());
+}
+
+TEST(TimingWheelTest, Advance_Cascade) {
+  // Expire times on the higher levels and beyond the wheel span.
+  const vector<time_t> expire_times = { 1064, 1100, 5000, 5096, 300000 };
+  TimingWheel timing_wheel(1000);
+  for (size_t i = 0; i < expire_times.size(); ++i) {
+    timing_wheel.Schedule(MakeKey(static_cast<char>('A' + i)),
+                          expire_times[i]);
+  }
+  for (size_t i = 0; i < expire_times.size(); ++i) {
+    vector<SessionKey> expired_keys;
+    timing_wheel.Advance(expire_times[i] - 1, &expired_keys);
+    EXPECT_EQ(0, expired_keys.size());
+    timing_wheel.Advance(expire_times[i], &expired_keys);
+    ASSERT_EQ(1, expired_keys.size());
+    EXPECT_EQ(MakeKey(static_cast<char>('A' + i)), expired_keys[0]);
+  }
+}
@@ -0,0 +1,30 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include "gtest/gtest.h"
+#include "token_revocation_set.h"
+
+using namespace std;
+using namespace chatserver;
+
+TEST(TokenRevocationSetTest, Revoke) {
+  TokenRevocationSet token_revocation_set;
+  EXPECT_EQ(false, token_revocation_set.IsRevoked(1));
+  EXPECT_EQ(true, token_revocation_set.Revoke(1, 2000, 1000));
+  EXPECT_EQ(false, token_revocation_set.Revoke(1, 2000, 1000));
+  EXPECT_EQ(true, token_revocation_set.IsRevoked(1));
+  EXPECT_EQ(false, token_revocation_set.IsRevoked(2));
+}
+
+TEST(TokenRevocationSetTest, Revoke_DropExpired) {
+  TokenRevocationSet token_revocation_set;
+  token_revocation_set.Revoke(1, 2000, 1000);
+  token_revocation_set.Revoke(2, 3000, 1000);
+  EXPECT_EQ(2, token_revocation_set.size());
+  // Token 1 has expired when token 3 is revoked.
+  token_revocation_set.Revoke(3, 4000, 2500);
+  EXPECT_EQ(2, token_revocation_set.size());
+  EXPECT_EQ(false, token_revocation_set.IsRevoked(1));
+  EXPECT_EQ(true, token_revocation_set.IsRevoked(2));
+}
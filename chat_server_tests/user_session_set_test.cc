@@ -0,0 +1,56 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include <string>
+
+#include "cpprest/asyncrt_utils.h"
+#include "gtest/gtest.h"
+#include "user_session_set.h"
+
+using namespace std;
+using namespace utility;
+using namespace chatserver;
+
+namespace {
+
+  // Session key of a 32-character ID ending with the given number.
+  SessionKey MakeKey(int number) {
+    string id = to_string(number);
+    id.insert(0, SessionKey::kLength - id.size(), 'S');
+    SessionKey session_key;
+    SessionKey::FromString(conversions::to_string_t(id), &session_key);
+    return session_key;
+  }
+
+} // namespace
+
+TEST(UserSessionSetTest, Add) {
+  UserSessionSet user_sessions;
+  EXPECT_EQ(true, user_sessions.empty());
+  EXPECT_EQ(true, user_sessions.Add(MakeKey(1)));
+  EXPECT_EQ(false, user_sessions.Add(MakeKey(1)));
+  EXPECT_EQ(true, user_sessions.Add(MakeKey(2)));
+  EXPECT_EQ(2, user_sessions.size());
+  EXPECT_EQ(true, user_sessions.Contains(MakeKey(2)));
+  EXPECT_EQ(false, user_sessions.Contains(MakeKey(3)));
+}
+
+TEST(UserSessionSetTest, Remove_KeepOrder) {
+  UserSessionSet user_sessions;
+  // Past the inline keys.
+  for (int i = 0; i < 5; ++i) {
+    user_sessions.Add(MakeKey(i));
+  }
+  EXPECT_EQ(true, user_sessions.Remove(MakeKey(1)));
+  EXPECT_EQ(false, user_sessions.Remove(MakeKey(1)));
+  ASSERT_EQ(4, user_sessions.size());
+  EXPECT_EQ(MakeKey(0), user_sessions[0]);
+  EXPECT_EQ(MakeKey(2), user_sessions[1]);
+  EXPECT_EQ(MakeKey(3), user_sessions[2]);
+  EXPECT_EQ(MakeKey(4), user_sessions[3]);
+  for (int i = 0; i < 5; ++i) {
+    user_sessions.Remove(MakeKey(i));
+  }
+  EXPECT_EQ(true, user_sessions.empty());
+}
@@ -0,0 +1,118 @@
+// Code review content development project.
+// Code style follows Google C++ Style Guide.
+// (https://google.github.io/styleguide/cppguide.html)
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "websocket_protocol.h"
+
+using namespace std;
+using namespace chatserver;
+
+namespace {
+
+  // Masked client frame of the payload.
+  string EncodeClientFrame(WebSocketProtocol::Opcode opcode,
+                           const string& payload) {
+    const unsigned char mask[4] = {0x37, 0xFA, 0x21, 0x3D};
+    string frame = WebSocketProtocol::EncodeFrame(opcode, payload);
+    const size_t header_size = frame.size() - payload.size();
+    frame[1] = static_cast<char>(frame[1] | 0x80);
+    frame.insert(header_size, reinterpret_cast<const char*>(mask), 4);
+    for (size_t i = 0; i < payload.size(); ++i) {
+      frame[header_size + 4 + i] =
+          static_cast<char>(payload[i] ^ mask[i % 4]);
+    }
+    return frame;
+  }
+
+} // namespace
+
+TEST(WebSocketProtocolTest, ComputeAcceptKey) {
+  // Example of RFC 6455 section 1.3.
+  EXPECT_EQ("s3pPLMBiTxaQ9kYGzzhZRbK+xOo=",
+            WebSocketProtocol::ComputeAcceptKey("dGhlIHNhbXBsZSBub25jZQ=="));
+}
+
+TEST(WebSocketProtocolTest, ParseHandshake_Success) {
+  const string request =
+      "GET /chatstream?session_id=abc HTTP/1.1\r\n"
+      "Host: localhost:34569\r\n"
+      "upgrade: WebSocket\r\n"
+      "Connection: keep-alive, Upgrade\r\n"
+      "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+      "Sec-WebSocket-Version: 13\r\n\r\n";
+  WebSocketProtocol::Handshake handshake;
+  EXPECT_EQ(true, WebSocketProtocol::ParseHandshake(request, &handshake));
+  EXPECT_EQ("/chatstream", handshake.path);
+  EXPECT_EQ("session_id=abc", handshake.query);
+  EXPECT_EQ("dGhlIHNhbXBsZSBub25jZQ==", handshake.key);
+}
+
+TEST(WebSocketProtocolTest, ParseHandshake_NotUpgrade) {
+  const string request =
+      "GET /chatstream HTTP/1.1\r\n"
+      "Host: localhost:34569\r\n"
+      "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+      "Sec-WebSocket-Version: 13\r\n\r\n";
+  WebSocketProtocol::Handshake handshake;
+  EXPECT_EQ(false, WebSocketProtocol::ParseHandshake(request, &handshake));
+}
+
+TEST(WebSocketProtocolTest, DecodeFrame_Success) {
+  const string payload(300, 'a');
+  const string frame = EncodeClientFrame(WebSocketProtocol::kText, payload) +
+                       EncodeClientFrame(WebSocketProtocol::kPing, "hi");
+  WebSocketProtocol::Frame decoded_frame;
+  size_t frame_size = 0;
+  EXPECT_EQ(WebSocketProtocol::kFrameDecoded,
+            WebSocketProtocol::DecodeFrame(frame.data(), frame.size(),
+                                           &decoded_frame, &frame_size));
+  EXPECT_EQ(WebSocketProtocol::kText, decoded_frame.opcode);
+  EXPECT_EQ(payload, decoded_frame.payload);
+
+  EXPECT_EQ(WebSocketProtocol::kFrameDecoded,
+            WebSocketProtocol::DecodeFrame(frame.data() + frame_size,
+                                           frame.size() - frame_size,
+                                           &decoded_frame, &frame_size));
+  EXPECT_EQ(WebSocketProtocol::kPing, decoded_frame.opcode);
+  EXPECT_EQ("hi", decoded_frame.payload);
+}
+
+TEST(WebSocketProtocolTest, DecodeFrame_Incomplete) {
+  const string frame = EncodeClientFrame(WebSocketProtocol::kText, "hello");
+  WebSocketProtocol::Frame decoded_frame;
+  size_t frame_size = 0;
+  for (size_t size = 0; size < frame.size(); ++size) {
+    EXPECT_EQ(WebSocketProtocol::kFrameIncomplete,
+              WebSocketProtocol::DecodeFrame(frame.data(), size,
+                                             &decoded_frame, &frame_size));
+  }
+}
+
+TEST(WebSocketProtocolTest, DecodeFrame_Error) {
+  WebSocketProtocol::Frame decoded_frame;
+  size_t frame_size = 0;
+  // Client frames must be masked.
+  const string unmasked_frame =
+      WebSocketProtocol::EncodeFrame(WebSocketProtocol::kText, "hello");
+  EXPECT_EQ(WebSocketProtocol::kFrameError,
+            WebSocketProtocol::DecodeFrame(unmasked_frame.data(),
+                                           unmasked_frame.size(),
+                                           &decoded_frame, &frame_size));
+  // Fragmented frames are not supported.
+  string fragment = EncodeClientFrame(WebSocketProtocol::kText, "hello");
+  fragment[0] = static_cast<char>(fragment[0] & 0x7F);
+  EXPECT_EQ(WebSocketProtocol::kFrameError,
+            WebSocketProtocol::DecodeFrame(fragment.data(), fragment.size(),
+                                           &decoded_frame, &frame_size));
+  // Payload over the limit.
+  const string large_frame = EncodeClientFrame(
+      WebSocketProtocol::kText,
+      string(WebSocketProtocol::kMaxPayloadSize + 1, 'a'));
+  EXPECT_EQ(WebSocketProtocol::kFrameError,
+            WebSocketProtocol::DecodeFrame(large_frame.data(),
+                                           large_frame.size(),
+                                           &decoded_frame, &frame_size));
+}